@@ -2,6 +2,7 @@
 layout(local_size_x = 1, local_size_y = 1) in;
 layout(rgba32f, binding = 0) uniform image2D img_output;
 
+// cell value | floor kind << 8 | door open fraction * 255 << 16
 layout(std430, binding = 1) buffer WorldMapArray {
     int worldMap[];
 };
@@ -10,7 +11,126 @@ layout(std430, binding = 2) buffer DatasArray {
     float datas[];
 };
 
-layout(binding = 3, rgba32f) readonly uniform image2D wall_output;
+// every surface texture as one layer of an array of 8 bit palette
+// indices, colours in the palette buffer
+layout(binding = 3, r8ui) readonly uniform uimage2DArray wall_output;
+
+layout(std430, binding = 5) buffer PaletteArray {
+    vec4 palette[];
+};
+
+// TextureTable: by cell value the wall layer and material | alpha << 8 |
+// thin wall axis << 16 | thin wall offset * 255 << 24, by floor kind the
+// floor and ceiling layer
+layout(std430, binding = 6) buffer SurfaceArray {
+    ivec2 wallSurfaces[256];
+    ivec2 floorSurfaces[256];
+};
+
+const int MATERIAL_OPAQUE = 0;
+const int MATERIAL_MASKED = 1;
+const int THIN_NONE = 0;
+const int THIN_X = 1;
+// see-through walls kept per column, CpuRenderer::maxLayers
+const int MAX_LAYERS = 4;
+
+vec4 wallTexel(ivec2 p, int layer) {
+    return palette[imageLoad(wall_output, ivec3(p, layer)).r];
+}
+
+// baked light levels (LightMap::exportPacked), 4 per uint: floor texels
+// (LIGHTMAP_RES per cell side) then 4 faces per cell. Empty means unlit.
+layout(std430, binding = 4) buffer LightArray {
+    uint lightLevels[];
+};
+
+const int MAP_W = 10;
+const int MAP_H = 10;
+const int LIGHTMAP_RES = 4;
+
+float lightLevel(int i) {
+    return float((lightLevels[i >> 2] >> uint((i & 3) * 8)) & 255u) / 255.0;
+}
+
+float floorLight(vec2 p) {
+    ivec2 t = ivec2(p * float(LIGHTMAP_RES));
+    if (lightLevels.length() == 0 || t.x < 0 || t.y < 0 || t.x >= MAP_W * LIGHTMAP_RES || t.y >= MAP_H * LIGHTMAP_RES)
+        return 1.0;
+    return lightLevel(t.x * MAP_H * LIGHTMAP_RES + t.y);
+}
+
+float faceLight(int mapX, int mapY, int face) {
+    if (lightLevels.length() == 0)
+        return 1.0;
+    return lightLevel(MAP_W * MAP_H * LIGHTMAP_RES * LIGHTMAP_RES + (mapX * MAP_H + mapY) * 4 + face);
+}
+
+// 0 before fogStart, 1 at maxDist and beyond
+float fogFactor(float dist, float fogStart, float maxDist) {
+    return clamp((dist - fogStart) / max(maxDist - fogStart, 1e-6), 0.0, 1.0);
+}
+
+float doorOpen(int cell) {
+    return float((worldMap[cell] >> 16) & 255) / 255.0;
+}
+
+// WorldMap::thinWallHit: distance to the plane of a thin wall cell when the
+// ray meets its closed part between enter and exit, -1 otherwise
+float thinWallHit(int mapX, int mapY, int wallFlags, vec2 pos, vec2 rayDir, float enter, float exit) {
+    float offset = float((wallFlags >> 24) & 255) / 255.0;
+    float dist, along;
+    if(((wallFlags >> 16) & 255) == THIN_X)
+    {
+        if(rayDir.x == 0) return -1.0;
+        dist = (mapX + offset - pos.x) / rayDir.x;
+        along = pos.y + dist * rayDir.y - mapY;
+    }
+    else
+    {
+        if(rayDir.y == 0) return -1.0;
+        dist = (mapY + offset - pos.y) / rayDir.y;
+        along = pos.x + dist * rayDir.x - mapX;
+    }
+    if(dist < enter || dist > exit || along < doorOpen(mapX * MAP_H + mapY)) return -1.0;
+    return dist;
+}
+
+// one masked or translucent wall column over what is already drawn, key
+// colour texels (maskKey) are holes for both
+void drawLayer(uint x, int h, vec2 pos, vec2 rayDir, ivec3 layer, float dist, float fogStart, float maxDist, vec3 fogColor) {
+    ivec2 surface = wallSurfaces[worldMap[layer.x * MAP_H + layer.y] & 255];
+    bool masked = (surface.y & 255) == MATERIAL_MASKED;
+    float alpha = float((surface.y >> 8) & 255) / 255.0;
+    int side = layer.z;
+    ivec2 texSize = imageSize(wall_output).xy;
+
+    dist = max(dist, 1e-4);
+    int lineHeight = int(h / dist);
+    int drawStart = max(-lineHeight / 2 + h / 2, 0);
+    int drawEnd = min(lineHeight / 2 + h / 2, h - 1);
+
+    float wallX = side == 0 ? pos.y + dist * rayDir.y : pos.x + dist * rayDir.x;
+    wallX -= floor(wallX);
+    if(((surface.y >> 16) & 255) != THIN_NONE) wallX -= doorOpen(layer.x * MAP_H + layer.y);
+    int texX = int(wallX * float(texSize.x));
+    if(side == 0 && rayDir.x > 0) texX = texSize.x - texX - 1;
+    if(side == 1 && rayDir.y < 0) texX = texSize.x - texX - 1;
+
+    float fog = fogFactor(dist, fogStart, maxDist);
+    float light = faceLight(layer.x, layer.y, side * 2 + ((side == 0 ? rayDir.x : rayDir.y) >= 0 ? 0 : 1));
+    float step = 1.0 * texSize.y / lineHeight;
+    float texPos = (drawStart - h / 2 + lineHeight / 2) * step;
+    for(int y = drawStart; y < drawEnd; y++)
+    {
+        int texY = int(texPos) & (texSize.y - 1);
+        texPos += step;
+        vec3 t = wallTexel(ivec2(texX, texY), surface.x).rgb;
+        if(t.r >= 240.0 / 255.0 && t.g <= 16.0 / 255.0 && t.b >= 240.0 / 255.0) continue;
+        vec3 color = mix(t * light, fogColor, fog);
+        if(!masked) color = mix(imageLoad(img_output, ivec2(x, y)).rgb, color, alpha);
+        imageStore(img_output, ivec2(x, y), vec4(color, 1.0));
+    }
+}
 
 void main() {
 
@@ -22,6 +142,9 @@ void main() {
     vec2 pos = vec2(datas[0], datas[1]);
     vec2 dir = vec2(datas[2], datas[3]);
     vec2 plane = vec2(datas[4], datas[5]);
+    float maxDist = datas[6];
+    float fogStart = datas[7];
+    vec3 fogColor = vec3(datas[8], datas[9], datas[10]);
 
     float cameraX = 2 * x / float(w) - 1; //x-coordinate in camera space
     float rayDirX = dir.x + plane.x * cameraX;
@@ -55,7 +178,7 @@ void main() {
     int stepY;
 
     int hit = 0; //was there a wall hit?
-    int side; //was a NS or a EW wall hit?
+    int side = 0; //was a NS or a EW wall hit?
     //calculate step and initial sideDist
     if(rayDirX < 0)
     {
@@ -77,9 +200,18 @@ void main() {
         stepY = 1;
         sideDistY = (mapY + 1.0 - pos.y) * deltaDistY;
     }
-    //perform DDA
+    // masked and translucent walls the ray passes, drawn after the floor
+    ivec3 layerCell[MAX_LAYERS]; // mapX, mapY, side
+    float layerDist[MAX_LAYERS];
+    int layerCount = 0;
+
+    //perform DDA, give up once the next cell is further than maxDist
+    bool reached = true;
+    bool thinHit = false; // hit the plane of a thin wall cell at thinDist
+    float thinDist;
     while(hit == 0)
     {
+        if(min(sideDistX, sideDistY) > maxDist) { reached = false; break; }
 
         //jump to next map square, either in x-direction, or in y-direction
         if(sideDistX < sideDistY)
@@ -94,8 +226,38 @@ void main() {
         mapY += stepY;
         side = 1;
         }
-        //Check if ray has hit a wall
-        if(worldMap[mapX * 10 + mapY] > 0) hit = 1;
+        //Check if ray has hit a wall, leaving the map counts as a miss
+        // per axis: past the y edge the linear index wraps into the next column
+        if(mapX < 0 || mapY < 0 || mapX >= MAP_W || mapY >= MAP_H) { reached = false; break; }
+        int cell = mapX * MAP_H + mapY;
+        int value = worldMap[cell] & 255;
+        if(value > 0)
+        {
+            int wallFlags = wallSurfaces[value].y;
+            float dist = side == 0 ? sideDistX - deltaDistX : sideDistY - deltaDistY;
+            int hitSide = side;
+            bool thin = ((wallFlags >> 16) & 255) != THIN_NONE;
+            if(thin)
+            {
+                // doors and thin walls: only the closed part of their plane
+                dist = thinWallHit(mapX, mapY, wallFlags, pos, vec2(rayDirX, rayDirY), dist, min(sideDistX, sideDistY));
+                if(dist < 0) continue;
+                hitSide = ((wallFlags >> 16) & 255) == THIN_X ? 0 : 1;
+            }
+            if((wallFlags & 255) != MATERIAL_OPAQUE && layerCount < MAX_LAYERS)
+            {
+                layerCell[layerCount] = ivec3(mapX, mapY, hitSide);
+                layerDist[layerCount] = dist;
+                layerCount++;
+            }
+            else
+            {
+                hit = 1;
+                side = hitSide;
+                thinHit = thin;
+                thinDist = dist;
+            }
+        }
     }
     //Calculate distance projected on camera direction. This is the shortest distance from the point where the wall is
     //hit to the camera plane. Euclidean to center camera point would give fisheye effect!
@@ -103,7 +265,9 @@ void main() {
     //for size == 1, but can be simplified to the code below thanks to how sideDist and deltaDist are computed:
     //because they were left scaled to |rayDir|. sideDist is the entire length of the ray above after the multiple
     //steps, but we subtract deltaDist once because one step more into the wall was taken above.
-    if(side == 0) perpWallDist = (sideDistX - deltaDistX);
+    if(!reached)  perpWallDist = maxDist;
+    else if(thinHit) perpWallDist = thinDist;
+    else if(side == 0) perpWallDist = (sideDistX - deltaDistX);
     else          perpWallDist = (sideDistY - deltaDistY);
 
     //Calculate height of line to draw on screen
@@ -116,7 +280,8 @@ void main() {
     if(drawEnd >= h) drawEnd = h - 1;
 
     // TEXTURE
-    ivec2 imgSize = imageSize(wall_output);
+    ivec2 imgSize = imageSize(wall_output).xy;
+    int wallLayer = reached ? wallSurfaces[worldMap[mapX * MAP_H + mapY] & 255].x : 0;
     int texWidth = imgSize.x;
     int texHeight = imgSize.y;
 
@@ -126,25 +291,29 @@ void main() {
     else           wallX = pos.x + perpWallDist * rayDirX;
     wallX -= floor((wallX));
 
-    //x coordinate on the texture
-    int texX = int(wallX * float(texWidth));
+    //x coordinate on the texture, a door's texture slides with it
+    int texX = int((thinHit ? wallX - doorOpen(mapX * MAP_H + mapY) : wallX) * float(texWidth));
     if(side == 0 && rayDirX > 0) texX = texWidth - texX - 1;
     if(side == 1 && rayDirY < 0) texX = texWidth - texX - 1;
 
     vec4 texture[1024];
     for (int i = 0; i < texHeight; i++) {
-        texture[i] = imageLoad(wall_output, ivec2(texX, i));
+        texture[i] = wallTexel(ivec2(texX, i), wallLayer);
     }
 
     float step = 1.0 * texHeight / lineHeight;
     // Starting texture coordinate
     float texPos = (drawStart - h / 2 + lineHeight / 2) * step;
+    // the list ran out on a see-through wall: fog behind it, drawn as a layer
+    bool backLayer = reached && (wallSurfaces[worldMap[mapX * MAP_H + mapY] & 255].y & 255) != MATERIAL_OPAQUE;
+    float wallFog = reached && !backLayer ? fogFactor(perpWallDist, fogStart, maxDist) : 1.0;
+    float wallLight = reached ? faceLight(mapX, mapY, side * 2 + ((side == 0 ? rayDirX : rayDirY) >= 0 ? 0 : 1)) : 1.0;
     for(int y = drawStart; y < drawEnd; y++)
     {
         // Cast the texture coordinate to integer, and mask with (texHeight - 1) in case of overflow
         int texY = int(texPos) & (texHeight - 1);
         texPos += step;
-        vec3 color = texture[texY].rgb;
+        vec3 color = mix(texture[texY].rgb * wallLight, fogColor, wallFog);
         imageStore(img_output, ivec2(x, y), vec4(color, 1.0));
     }
 
@@ -170,8 +339,13 @@ void main() {
     //FLOOR CASTING (vertical version, directly after drawing the vertical wall stripe for the current x)
     float floorXWall, floorYWall; //x, y position of the floor texel at the bottom of the wall
 
-    //4 different wall directions possible
-    if(side == 0 && rayDirX > 0)
+    //4 different wall directions possible, or the hit point itself on a miss or a thin wall
+    if(!reached || thinHit)
+    {
+        floorXWall = pos.x + perpWallDist * rayDirX;
+        floorYWall = pos.y + perpWallDist * rayDirY;
+    }
+    else if(side == 0 && rayDirX > 0)
     {
         floorXWall = mapX;
         floorYWall = mapY + wallX;
@@ -212,10 +386,22 @@ void main() {
         floorTexX = int(currentFloorX * texWidth) % texWidth;
         floorTexY = int(currentFloorY * texHeight) % texHeight;
 
-        vec3 fcolor = imageLoad(wall_output, ivec2(floorTexX, floorTexY)).rgb;
-        imageStore(img_output, ivec2(x, y), vec4(fcolor, 1.0));
+        ivec2 floorCell = clamp(ivec2(currentFloorX, currentFloorY), ivec2(0), ivec2(MAP_W - 1, MAP_H - 1));
+        ivec2 surface = floorSurfaces[(worldMap[floorCell.x * MAP_H + floorCell.y] >> 8) & 255];
+        float light = floorLight(vec2(currentFloorX, currentFloorY));
+        vec3 fcolor = wallTexel(ivec2(floorTexX, floorTexY), surface.x).rgb * light;
+        vec3 ccolor = wallTexel(ivec2(floorTexX, floorTexY), surface.y).rgb * light;
+        float floorFog = fogFactor(currentDist, fogStart, maxDist);
+        imageStore(img_output, ivec2(x, y), vec4(mix(fcolor, fogColor, floorFog), 1.0));
 
-        imageStore(img_output, ivec2(x, h - y), vec4(fcolor * 0.8, 1.0));
+        imageStore(img_output, ivec2(x, h - y), vec4(mix(ccolor * 0.8, fogColor, floorFog), 1.0));
     }
 
+    // see-through walls over everything behind them, farthest first
+    vec2 rayDir = vec2(rayDirX, rayDirY);
+    if(backLayer)
+        drawLayer(x, h, pos, rayDir, ivec3(mapX, mapY, side), perpWallDist, fogStart, maxDist, fogColor);
+    for(int i = layerCount - 1; i >= 0; i--)
+        drawLayer(x, h, pos, rayDir, layerCell[i], layerDist[i], fogStart, maxDist, fogColor);
+
 }
@@ -0,0 +1,21 @@
+#version 450 core
+layout(local_size_x = 64) in;
+
+// cell value | floor kind << 8 | door open fraction * 255 << 16, as in compute.glsl
+layout(std430, binding = 1) buffer WorldMapArray {
+    int worldMap[];
+};
+
+// MapEdits::scatter, cell index and new value
+layout(std430, binding = 7) readonly buffer EditArray {
+    ivec2 edits[];
+};
+
+layout(location = 0) uniform int editCount;
+
+void main() {
+    uint i = gl_GlobalInvocationID.x;
+    if (i >= uint(editCount))
+        return;
+    worldMap[edits[i].x] = edits[i].y;
+}
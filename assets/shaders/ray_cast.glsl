@@ -0,0 +1,294 @@
+#version 450 core
+// First pass of the split dispatch: one ray per lane, 64 columns per
+// workgroup. The DDA of compute.glsl, then everything ray_shade.glsl needs
+// to colour the column goes into the column buffer.
+layout(local_size_x = 64) in;
+layout(rgba32f, binding = 0) writeonly uniform image2D img_output; // for its size
+
+// cell value | floor kind << 8 | door open fraction * 255 << 16, as in compute.glsl
+layout(std430, binding = 1) readonly buffer WorldMapArray {
+    int worldMap[];
+};
+
+layout(std430, binding = 2) readonly buffer DatasArray {
+    float datas[];
+};
+
+layout(binding = 3, r8ui) readonly uniform uimage2DArray wall_output;
+
+layout(std430, binding = 4) readonly buffer LightArray {
+    uint lightLevels[];
+};
+
+layout(std430, binding = 6) readonly buffer SurfaceArray {
+    ivec2 wallSurfaces[256];
+    ivec2 floorSurfaces[256];
+};
+
+const int MATERIAL_OPAQUE = 0;
+const int MATERIAL_MASKED = 1;
+const int THIN_NONE = 0;
+const int THIN_X = 1;
+const int MAX_LAYERS = 4;
+
+// one per image column, the same struct in ray_shade.glsl. A stripe is a
+// textured wall span: drawStart, drawEnd, texX and texture layer |
+// material << 16 | alpha << 24, then texture step, texPos at drawStart,
+// light and fog.
+struct Column {
+    ivec4 wall;
+    vec4 shade;
+    vec4 floorHit;  // floorXWall, floorYWall, perpWallDist
+    ivec4 counts;   // first floor row, see-through layers
+    ivec4 layerWall[MAX_LAYERS + 1]; // stripes in draw order, farthest first
+    vec4 layerShade[MAX_LAYERS + 1];
+};
+
+layout(std430, binding = 8) writeonly buffer ColumnArray {
+    Column columns[];
+};
+
+const int MAP_W = 10;
+const int MAP_H = 10;
+const int LIGHTMAP_RES = 4;
+
+float lightLevel(int i) {
+    return float((lightLevels[i >> 2] >> uint((i & 3) * 8)) & 255u) / 255.0;
+}
+
+float faceLight(int mapX, int mapY, int face) {
+    if (lightLevels.length() == 0)
+        return 1.0;
+    return lightLevel(MAP_W * MAP_H * LIGHTMAP_RES * LIGHTMAP_RES + (mapX * MAP_H + mapY) * 4 + face);
+}
+
+float fogFactor(float dist, float fogStart, float maxDist) {
+    return clamp((dist - fogStart) / max(maxDist - fogStart, 1e-6), 0.0, 1.0);
+}
+
+float doorOpen(int cell) {
+    return float((worldMap[cell] >> 16) & 255) / 255.0;
+}
+
+float thinWallHit(int mapX, int mapY, int wallFlags, vec2 pos, vec2 rayDir, float enter, float exit) {
+    float offset = float((wallFlags >> 24) & 255) / 255.0;
+    float dist, along;
+    if(((wallFlags >> 16) & 255) == THIN_X)
+    {
+        if(rayDir.x == 0) return -1.0;
+        dist = (mapX + offset - pos.x) / rayDir.x;
+        along = pos.y + dist * rayDir.y - mapY;
+    }
+    else
+    {
+        if(rayDir.y == 0) return -1.0;
+        dist = (mapY + offset - pos.y) / rayDir.y;
+        along = pos.x + dist * rayDir.x - mapX;
+    }
+    if(dist < enter || dist > exit || along < doorOpen(mapX * MAP_H + mapY)) return -1.0;
+    return dist;
+}
+
+// compute.glsl's drawLayer up to its pixel loop
+void layerStripe(int h, vec2 pos, vec2 rayDir, ivec3 layer, float dist, float fogStart, float maxDist, out ivec4 stripe, out vec4 shade) {
+    ivec2 surface = wallSurfaces[worldMap[layer.x * MAP_H + layer.y] & 255];
+    int side = layer.z;
+    ivec2 texSize = imageSize(wall_output).xy;
+
+    dist = max(dist, 1e-4);
+    int lineHeight = int(h / dist);
+    int drawStart = max(-lineHeight / 2 + h / 2, 0);
+    int drawEnd = min(lineHeight / 2 + h / 2, h - 1);
+
+    float wallX = side == 0 ? pos.y + dist * rayDir.y : pos.x + dist * rayDir.x;
+    wallX -= floor(wallX);
+    if(((surface.y >> 16) & 255) != THIN_NONE) wallX -= doorOpen(layer.x * MAP_H + layer.y);
+    int texX = int(wallX * float(texSize.x));
+    if(side == 0 && rayDir.x > 0) texX = texSize.x - texX - 1;
+    if(side == 1 && rayDir.y < 0) texX = texSize.x - texX - 1;
+
+    float fog = fogFactor(dist, fogStart, maxDist);
+    float light = faceLight(layer.x, layer.y, side * 2 + ((side == 0 ? rayDir.x : rayDir.y) >= 0 ? 0 : 1));
+    float step = 1.0 * texSize.y / lineHeight;
+    float texPos = (drawStart - h / 2 + lineHeight / 2) * step;
+    stripe = ivec4(drawStart, drawEnd, texX, surface.x | (surface.y & 0xFFFF) << 16);
+    shade = vec4(step, texPos, light, fog);
+}
+
+void main() {
+    ivec2 size = imageSize(img_output);
+    int w = size.x;
+    int h = size.y;
+    int x = int(gl_GlobalInvocationID.x);
+    if(x >= w) return;
+
+    vec2 pos = vec2(datas[0], datas[1]);
+    vec2 dir = vec2(datas[2], datas[3]);
+    vec2 plane = vec2(datas[4], datas[5]);
+    float maxDist = datas[6];
+    float fogStart = datas[7];
+
+    float cameraX = 2 * x / float(w) - 1;
+    float rayDirX = dir.x + plane.x * cameraX;
+    float rayDirY = dir.y + plane.y * cameraX;
+    int mapX = int(pos.x);
+    int mapY = int(pos.y);
+
+    float sideDistX;
+    float sideDistY;
+    float deltaDistX = (rayDirX == 0) ? 1e30 : abs(1 / rayDirX);
+    float deltaDistY = (rayDirY == 0) ? 1e30 : abs(1 / rayDirY);
+    float perpWallDist;
+    int stepX;
+    int stepY;
+    int hit = 0;
+    int side = 0;
+    if(rayDirX < 0)
+    {
+        stepX = -1;
+        sideDistX = (pos.x - mapX) * deltaDistX;
+    }
+    else
+    {
+        stepX = 1;
+        sideDistX = (mapX + 1.0 - pos.x) * deltaDistX;
+    }
+    if(rayDirY < 0)
+    {
+        stepY = -1;
+        sideDistY = (pos.y - mapY) * deltaDistY;
+    }
+    else
+    {
+        stepY = 1;
+        sideDistY = (mapY + 1.0 - pos.y) * deltaDistY;
+    }
+    ivec3 layerCell[MAX_LAYERS];
+    float layerDist[MAX_LAYERS];
+    int layerCount = 0;
+
+    bool reached = true;
+    bool thinHit = false;
+    float thinDist;
+    while(hit == 0)
+    {
+        if(min(sideDistX, sideDistY) > maxDist) { reached = false; break; }
+
+        if(sideDistX < sideDistY)
+        {
+            sideDistX += deltaDistX;
+            mapX += stepX;
+            side = 0;
+        }
+        else
+        {
+            sideDistY += deltaDistY;
+            mapY += stepY;
+            side = 1;
+        }
+        // per axis: past the y edge the linear index wraps into the next column
+        if(mapX < 0 || mapY < 0 || mapX >= MAP_W || mapY >= MAP_H) { reached = false; break; }
+        int cell = mapX * MAP_H + mapY;
+        int value = worldMap[cell] & 255;
+        if(value > 0)
+        {
+            int wallFlags = wallSurfaces[value].y;
+            float dist = side == 0 ? sideDistX - deltaDistX : sideDistY - deltaDistY;
+            int hitSide = side;
+            bool thin = ((wallFlags >> 16) & 255) != THIN_NONE;
+            if(thin)
+            {
+                dist = thinWallHit(mapX, mapY, wallFlags, pos, vec2(rayDirX, rayDirY), dist, min(sideDistX, sideDistY));
+                if(dist < 0) continue;
+                hitSide = ((wallFlags >> 16) & 255) == THIN_X ? 0 : 1;
+            }
+            if((wallFlags & 255) != MATERIAL_OPAQUE && layerCount < MAX_LAYERS)
+            {
+                layerCell[layerCount] = ivec3(mapX, mapY, hitSide);
+                layerDist[layerCount] = dist;
+                layerCount++;
+            }
+            else
+            {
+                hit = 1;
+                side = hitSide;
+                thinHit = thin;
+                thinDist = dist;
+            }
+        }
+    }
+    if(!reached)  perpWallDist = maxDist;
+    else if(thinHit) perpWallDist = thinDist;
+    else if(side == 0) perpWallDist = (sideDistX - deltaDistX);
+    else          perpWallDist = (sideDistY - deltaDistY);
+
+    int lineHeight = int(h / perpWallDist);
+    int drawStart = -lineHeight / 2 + h / 2;
+    if(drawStart < 0) drawStart = 0;
+    int drawEnd = lineHeight / 2 + h / 2;
+    if(drawEnd >= h) drawEnd = h - 1;
+
+    ivec2 imgSize = imageSize(wall_output).xy;
+    int wallLayer = reached ? wallSurfaces[worldMap[mapX * MAP_H + mapY] & 255].x : 0;
+    int texWidth = imgSize.x;
+    int texHeight = imgSize.y;
+
+    float wallX;
+    if (side == 0) wallX = pos.y + perpWallDist * rayDirY;
+    else           wallX = pos.x + perpWallDist * rayDirX;
+    wallX -= floor((wallX));
+
+    int texX = int((thinHit ? wallX - doorOpen(mapX * MAP_H + mapY) : wallX) * float(texWidth));
+    if(side == 0 && rayDirX > 0) texX = texWidth - texX - 1;
+    if(side == 1 && rayDirY < 0) texX = texWidth - texX - 1;
+
+    float step = 1.0 * texHeight / lineHeight;
+    float texPos = (drawStart - h / 2 + lineHeight / 2) * step;
+    bool backLayer = reached && (wallSurfaces[worldMap[mapX * MAP_H + mapY] & 255].y & 255) != MATERIAL_OPAQUE;
+    float wallFog = reached && !backLayer ? fogFactor(perpWallDist, fogStart, maxDist) : 1.0;
+    float wallLight = reached ? faceLight(mapX, mapY, side * 2 + ((side == 0 ? rayDirX : rayDirY) >= 0 ? 0 : 1)) : 1.0;
+
+    float floorXWall, floorYWall;
+    if(!reached || thinHit)
+    {
+        floorXWall = pos.x + perpWallDist * rayDirX;
+        floorYWall = pos.y + perpWallDist * rayDirY;
+    }
+    else if(side == 0 && rayDirX > 0)
+    {
+        floorXWall = mapX;
+        floorYWall = mapY + wallX;
+    }
+    else if(side == 0 && rayDirX < 0)
+    {
+        floorXWall = mapX + 1.0;
+        floorYWall = mapY + wallX;
+    }
+    else if(side == 1 && rayDirY > 0)
+    {
+        floorXWall = mapX + wallX;
+        floorYWall = mapY;
+    }
+    else
+    {
+        floorXWall = mapX + wallX;
+        floorYWall = mapY + 1.0;
+    }
+    int floorStart = drawEnd < 0 ? h : drawEnd; // drawEnd < 0 when the integer overflows
+
+    Column c;
+    c.wall = ivec4(drawStart, drawEnd, texX, wallLayer);
+    c.shade = vec4(step, texPos, wallLight, wallFog);
+    c.floorHit = vec4(floorXWall, floorYWall, perpWallDist, 0.0);
+    int count = 0;
+    vec2 rayDir = vec2(rayDirX, rayDirY);
+    if(backLayer)
+    {
+        layerStripe(h, pos, rayDir, ivec3(mapX, mapY, side), perpWallDist, fogStart, maxDist, c.layerWall[0], c.layerShade[0]);
+        count++;
+    }
+    for(int i = layerCount - 1; i >= 0; i--, count++)
+        layerStripe(h, pos, rayDir, layerCell[i], layerDist[i], fogStart, maxDist, c.layerWall[count], c.layerShade[count]);
+    c.counts = ivec4(floorStart, count, 0, 0);
+    columns[x] = c;
+}
@@ -0,0 +1,140 @@
+#version 450 core
+// Second pass of the split dispatch: one invocation per pixel in 8 x 8
+// tiles, colouring it from its column (ray_cast.glsl). Every pixel ends up
+// as compute.glsl's column loops leave it, written once, so the image
+// needs no clear: wall, then floor and ceiling where the floor loop would
+// overwrite it, then the see-through layers blended on top.
+layout(local_size_x = 8, local_size_y = 8) in;
+layout(rgba32f, binding = 0) writeonly uniform image2D img_output;
+
+// cell value | floor kind << 8 | door open fraction * 255 << 16, as in compute.glsl
+layout(std430, binding = 1) readonly buffer WorldMapArray {
+    int worldMap[];
+};
+
+layout(std430, binding = 2) readonly buffer DatasArray {
+    float datas[];
+};
+
+layout(binding = 3, r8ui) readonly uniform uimage2DArray wall_output;
+
+layout(std430, binding = 4) readonly buffer LightArray {
+    uint lightLevels[];
+};
+
+layout(std430, binding = 5) readonly buffer PaletteArray {
+    vec4 palette[];
+};
+
+layout(std430, binding = 6) readonly buffer SurfaceArray {
+    ivec2 wallSurfaces[256];
+    ivec2 floorSurfaces[256];
+};
+
+const int MATERIAL_MASKED = 1;
+const int MAX_LAYERS = 4;
+
+// see ray_cast.glsl
+struct Column {
+    ivec4 wall;
+    vec4 shade;
+    vec4 floorHit;
+    ivec4 counts;
+    ivec4 layerWall[MAX_LAYERS + 1];
+    vec4 layerShade[MAX_LAYERS + 1];
+};
+
+layout(std430, binding = 8) readonly buffer ColumnArray {
+    Column columns[];
+};
+
+const int MAP_W = 10;
+const int MAP_H = 10;
+const int LIGHTMAP_RES = 4;
+
+vec4 wallTexel(ivec2 p, int layer) {
+    return palette[imageLoad(wall_output, ivec3(p, layer)).r];
+}
+
+float lightLevel(int i) {
+    return float((lightLevels[i >> 2] >> uint((i & 3) * 8)) & 255u) / 255.0;
+}
+
+float floorLight(vec2 p) {
+    ivec2 t = ivec2(p * float(LIGHTMAP_RES));
+    if (lightLevels.length() == 0 || t.x < 0 || t.y < 0 || t.x >= MAP_W * LIGHTMAP_RES || t.y >= MAP_H * LIGHTMAP_RES)
+        return 1.0;
+    return lightLevel(t.x * MAP_H * LIGHTMAP_RES + t.y);
+}
+
+float fogFactor(float dist, float fogStart, float maxDist) {
+    return clamp((dist - fogStart) / max(maxDist - fogStart, 1e-6), 0.0, 1.0);
+}
+
+void main() {
+    ivec2 size = imageSize(img_output);
+    int w = size.x;
+    int h = size.y;
+    int x = int(gl_GlobalInvocationID.x);
+    int y = int(gl_GlobalInvocationID.y);
+    if(x >= w || y >= h) return;
+
+    vec2 pos = vec2(datas[0], datas[1]);
+    float maxDist = datas[6];
+    float fogStart = datas[7];
+    vec3 fogColor = vec3(datas[8], datas[9], datas[10]);
+    ivec2 texSize = imageSize(wall_output).xy;
+
+    vec4 pixel = vec4(0.0); // what the clear leaves
+    ivec4 wall = columns[x].wall;
+    if(y >= wall.x && y < wall.y)
+    {
+        vec4 shade = columns[x].shade;
+        float texPos = shade.y + float(y - wall.x) * shade.x;
+        int texY = int(texPos) & (texSize.y - 1);
+        vec3 t = wallTexel(ivec2(wall.z, texY), wall.w).rgb;
+        pixel = vec4(mix(t * shade.z, fogColor, shade.w), 1.0);
+    }
+
+    // the floor loop writes row fy and its ceiling row h - fy, the later
+    // iteration wins and the ceiling goes second within one
+    ivec4 counts = columns[x].counts;
+    int floorStart = counts.x;
+    bool floorRow = y >= floorStart;
+    bool ceilingRow = y >= 1 && h - y >= floorStart;
+    if(floorRow || ceilingRow)
+    {
+        bool ceiling = ceilingRow && !(floorRow && y > h - y);
+        int fy = ceiling ? h - y : y;
+        float currentDist = h / (2.0 * fy - h);
+        vec4 floorHit = columns[x].floorHit;
+        float weight = currentDist / floorHit.z;
+        float currentFloorX = weight * floorHit.x + (1.0 - weight) * pos.x;
+        float currentFloorY = weight * floorHit.y + (1.0 - weight) * pos.y;
+
+        int floorTexX = int(currentFloorX * texSize.x) % texSize.x;
+        int floorTexY = int(currentFloorY * texSize.y) % texSize.y;
+        ivec2 floorCell = clamp(ivec2(currentFloorX, currentFloorY), ivec2(0), ivec2(MAP_W - 1, MAP_H - 1));
+        ivec2 surface = floorSurfaces[(worldMap[floorCell.x * MAP_H + floorCell.y] >> 8) & 255];
+        float light = floorLight(vec2(currentFloorX, currentFloorY));
+        float floorFog = fogFactor(currentDist, fogStart, maxDist);
+        vec3 color = wallTexel(ivec2(floorTexX, floorTexY), ceiling ? surface.y : surface.x).rgb * light;
+        pixel = vec4(mix(ceiling ? color * 0.8 : color, fogColor, floorFog), 1.0);
+    }
+
+    // see-through stripes, masked ones replace, translucent ones blend
+    for(int i = 0; i < counts.y; i++)
+    {
+        ivec4 stripe = columns[x].layerWall[i];
+        if(y < stripe.x || y >= stripe.y) continue;
+        vec4 shade = columns[x].layerShade[i];
+        int texY = int(shade.y + float(y - stripe.x) * shade.x) & (texSize.y - 1);
+        vec3 t = wallTexel(ivec2(stripe.z, texY), stripe.w & 0xFFFF).rgb;
+        if(t.r >= 240.0 / 255.0 && t.g <= 16.0 / 255.0 && t.b >= 240.0 / 255.0) continue;
+        vec3 color = mix(t * shade.z, fogColor, shade.w);
+        if(((stripe.w >> 16) & 255) != MATERIAL_MASKED) color = mix(pixel.rgb, color, float((stripe.w >> 24) & 255) / 255.0);
+        pixel = vec4(color, 1.0);
+    }
+
+    imageStore(img_output, ivec2(x, y), pixel);
+}
@@ -0,0 +1,22 @@
+#pragma once
+
+#include <cstdint>
+
+// xorshift32 shared by the benches. Each bench seeds it at the start of
+// main (and wherever it wants a sequence repeated) so every run builds the
+// same maps and rays.
+
+static uint32_t benchRng = 12345;
+
+static inline void seedRand(uint32_t seed)
+{
+    benchRng = seed;
+}
+
+static inline uint32_t nextRand()
+{
+    benchRng ^= benchRng << 13;
+    benchRng ^= benchRng >> 17;
+    benchRng ^= benchRng << 5;
+    return benchRng;
+}
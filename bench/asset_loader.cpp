@@ -0,0 +1,210 @@
+// Time to first frame with 500 textures (128 x 128 PNGs, resampled to a
+// 64 x 64 atlas): loading everything before the first frame, on one thread
+// and on the decode threads, against AssetLoader streaming them in while
+// frames are drawn with placeholders. The PNGs are made in memory first
+// (huffman coded literals, so inflate does real work) and are not timed.
+// usage: bench_asset_loader [textures] [decode threads]
+
+#include <iostream>
+#include <iomanip>
+#include <chrono>
+#include <cstdlib>
+
+#define STB_IMAGE_IMPLEMENTATION
+#include "AssetLoader.h"
+
+struct BitWriter
+{
+    std::vector<unsigned char> out;
+    uint32_t acc = 0;
+    int bits = 0;
+
+    void put(uint32_t v, int n) // lsb first
+    {
+        acc |= v << bits;
+        bits += n;
+        while (bits >= 8)
+        {
+            out.push_back((unsigned char)acc);
+            acc >>= 8;
+            bits -= 8;
+        }
+    }
+    void huffman(uint32_t code, int n) // msb first
+    {
+        for (int i = n - 1; i >= 0; i--)
+            put((code >> i) & 1, 1);
+    }
+};
+
+static uint32_t crc32(const unsigned char *p, size_t n, uint32_t crc = 0)
+{
+    crc = ~crc;
+    for (size_t i = 0; i < n; i++)
+    {
+        crc ^= p[i];
+        for (int k = 0; k < 8; k++)
+            crc = (crc >> 1) ^ (0xEDB88320u & (0u - (crc & 1)));
+    }
+    return ~crc;
+}
+
+static void chunk(std::vector<unsigned char> &png, const char *type, const std::vector<unsigned char> &data)
+{
+    uint32_t n = (uint32_t)data.size();
+    unsigned char len[4] = {(unsigned char)(n >> 24), (unsigned char)(n >> 16), (unsigned char)(n >> 8), (unsigned char)n};
+    png.insert(png.end(), len, len + 4);
+    std::vector<unsigned char> body(type, type + 4);
+    body.insert(body.end(), data.begin(), data.end());
+    png.insert(png.end(), body.begin(), body.end());
+    uint32_t crc = crc32(body.data(), body.size());
+    unsigned char c[4] = {(unsigned char)(crc >> 24), (unsigned char)(crc >> 16), (unsigned char)(crc >> 8), (unsigned char)crc};
+    png.insert(png.end(), c, c + 4);
+}
+
+// RGB8 PNG, one fixed huffman deflate block of literals
+static std::vector<unsigned char> encodePng(const std::vector<unsigned char> &rgb, int w, int h)
+{
+    BitWriter bw;
+    bw.put(0x78, 8);
+    bw.put(0x01, 8);
+    bw.put(1, 1); // final block
+    bw.put(1, 2); // fixed codes
+    uint32_t a = 1, b = 0;
+    for (int y = 0; y < h; y++)
+        for (int x = -1; x < w * 3; x++)
+        {
+            unsigned v = x < 0 ? 0 : rgb[(size_t)y * w * 3 + x]; // filter byte, then the row
+            if (v < 144)
+                bw.huffman(0x30 + v, 8);
+            else
+                bw.huffman(0x190 + v - 144, 9);
+            a = (a + v) % 65521;
+            b = (b + a) % 65521;
+        }
+    bw.huffman(0, 7);
+    if (bw.bits)
+        bw.put(0, 8 - bw.bits);
+    uint32_t adler = (b << 16) | a;
+    for (int s = 24; s >= 0; s -= 8)
+        bw.out.push_back((unsigned char)(adler >> s));
+
+    std::vector<unsigned char> png = {0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n'};
+    std::vector<unsigned char> ihdr = {0, 0, (unsigned char)(w >> 8), (unsigned char)w, 0, 0, (unsigned char)(h >> 8), (unsigned char)h, 8, 2, 0, 0, 0};
+    chunk(png, "IHDR", ihdr);
+    chunk(png, "IDAT", bw.out);
+    chunk(png, "IEND", std::vector<unsigned char>());
+    return png;
+}
+
+static double msSince(std::chrono::steady_clock::time_point t)
+{
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t).count();
+}
+
+int main(int argc, char **argv)
+{
+    int count = argc > 1 ? atoi(argv[1]) : 500;
+    int threads = argc > 2 ? atoi(argv[2]) : 0;
+    const int size = 128;
+
+    std::vector<std::vector<unsigned char>> pngs(count);
+    std::vector<unsigned char> rgb((size_t)size * size * 3);
+    for (int t = 0; t < count; t++)
+    {
+        for (int y = 0; y < size; y++)
+            for (int x = 0; x < size; x++)
+            {
+                unsigned char *p = &rgb[((size_t)y * size + x) * 3];
+                unsigned n = (x * 7919u + y * 104729u + t * 31337u) * 2654435761u >> 27;
+                p[0] = (unsigned char)((x * 2 + t * 13) & 255);
+                p[1] = (unsigned char)((y * 2 + t * 29) & 255);
+                p[2] = (unsigned char)(((x ^ y) * 4 + n) & 255);
+            }
+        pngs[t] = encodePng(rgb, size, size);
+    }
+
+    // palette from the first texture, a 64 x 64 map using layers 1..255
+    int w0, h0, c0;
+    unsigned char *first = stbi_load_from_memory(pngs[0].data(), (int)pngs[0].size(), &w0, &h0, &c0, 3);
+    Palette palette;
+    std::vector<uint8_t> indices;
+    quantizeTexture(first, w0, h0, 3, palette, indices);
+    stbi_image_free(first);
+
+    WorldMap world(64, 64);
+    TextureTable table;
+    for (int x = 0; x < 64; x++)
+        for (int y = 0; y < 64; y++)
+        {
+            bool edge = x == 0 || y == 0 || x == 63 || y == 63;
+            uint32_t hsh = (x * 73856093u) ^ (y * 19349663u);
+            world.set(x, y, edge || hsh % 7 == 0 ? (uint8_t)(1 + hsh % 255) : 0);
+        }
+    for (int c = 1; c < 256; c++)
+        table.setWall((uint8_t)c, (uint16_t)(c % count + 1));
+
+    ThreadPool pool;
+    CpuRenderer cpu(&pool);
+    cpu.resize(640, 480);
+    RenderSettings settings;
+    std::vector<unsigned char> checker(64 * 64 * 3, 128);
+    Camera cam = {32.5f, 32.5f, 1.f, 0.f, 0.f, 0.66f};
+
+    std::cout << std::fixed << std::setprecision(1);
+    std::cout << count << " textures of " << size << " x " << size << ", " << pngs[0].size() / 1024 << " KB each" << std::endl;
+
+    // 0: everything loaded before the first frame on one thread, 1: the
+    // same on the decode threads, 2: streamed behind placeholders
+    const char *modes[3] = {"blocking, 1 thread  ", "blocking, threads   ", "streamed, threads   "};
+    for (int mode = 0; mode < 3; mode++)
+    {
+        cpu.setTexture(checker.data(), 64, 64, 3);
+        cpu.reserveLayers(count + 1);
+        cpu.setTextureTable(table);
+
+        auto start = std::chrono::steady_clock::now();
+        AssetLoader loader(mode == 0 ? 1 : threads);
+        loader.palette = palette;
+        if (mode < 2)
+            loader.uploadBudget = (size_t)-1;
+        std::vector<std::shared_future<int>> futures;
+        for (int t = 0; t < count; t++)
+            futures.push_back(loader.request("tex" + std::to_string(t), t + 1, pngs[t]));
+        AssetLoader::Upload upload = [&](const AssetLoader::Texture &t) {
+            cpu.setLayer(t.layer, t.texels.data(), t.indices.data(), t.mask.data());
+        };
+
+        double firstFrame = -1, allIn = -1, worstFrame = 0;
+        int frames = 0, framesBefore = 0;
+        if (mode < 2) {
+            while (loader.pending() > 0)
+                if (!loader.uploadSlice(upload))
+                    std::this_thread::yield();
+        }
+        while (allIn < 0 || frames < 5)
+        {
+            auto f = std::chrono::steady_clock::now();
+            loader.uploadSlice(upload);
+            cpu.render(world, cam, settings);
+            worstFrame = std::max(worstFrame, msSince(f));
+            frames++;
+            if (firstFrame < 0)
+                firstFrame = msSince(start);
+            if (allIn < 0 && loader.pending() == 0) {
+                allIn = msSince(start);
+                framesBefore = frames;
+            }
+        }
+        bool resolved = true;
+        for (auto &f : futures)
+            resolved &= f.wait_for(std::chrono::seconds(0)) == std::future_status::ready && f.get() > 0;
+
+        std::cout << "  " << modes[mode] << std::setw(2) << loader.threadCount()
+                  << "  first frame " << std::setw(7) << firstFrame << " ms  all resident " << std::setw(7) << allIn
+                  << " ms  frames drawn by then " << std::setw(4) << framesBefore << "  worst frame " << std::setw(6) << worstFrame
+                  << " ms  decode " << std::setw(6) << loader.decodeMicros / 1000.0 / count << " ms/texture  futures "
+                  << (resolved ? "ok" : "MISSING") << std::endl;
+    }
+    return 0;
+}
@@ -0,0 +1,126 @@
+// Chunk streaming over a 1M x 1M generated city: the camera drives down the
+// streets at a few speeds while every frame is rendered from the streamed
+// view. Reports the residency hit rate (view chunks present when drawn),
+// stalls (chunks missing within nearChunks of the camera, drawn as the
+// fallback), loads, evictions and the cost of update() itself, with and
+// without the lookahead band, under a tight memory budget and with a
+// simulated 10 ms load latency (disk instead of the generator). After each
+// run the loads are drained and any view chunk still drawn as the fallback
+// fails the bench.
+// usage: bench_chunk_stream [frames] [seed]
+
+#include <iostream>
+#include <iomanip>
+#include <chrono>
+#include <cstdlib>
+#include <string>
+
+#include "ChunkStream.h"
+#include "MapGenerator.h"
+#include "CpuRenderer.h"
+
+struct Run
+{
+    float speed; // cells per frame
+    int lookahead, threads;
+    size_t budget;
+    int latencyUs; // added to every load
+};
+
+int main(int argc, char **argv)
+{
+    int frames = argc > 1 ? atoi(argv[1]) : 400;
+    uint32_t seed = argc > 2 ? (uint32_t)atoi(argv[2]) : 1;
+    const int64_t size = 1 << 20;
+    const int w = 640, h = 480;
+
+    MapGenerator gen(MAP_STYLE_CITY, seed, (int)size, (int)size);
+    ThreadPool pool;
+    CpuRenderer cpu(&pool);
+    cpu.resize(w, h);
+    std::vector<unsigned char> tex(64 * 64 * 3, 128);
+    cpu.setTexture(tex.data(), 64, 64, 3);
+    RenderSettings settings;
+    settings.maxDistance = 400.f;
+    settings.fogStart = 200.f;
+
+    Run runs[] = {
+        {1.f, 0, 1, 32 << 20, 0}, {1.f, 4, 1, 32 << 20, 0},
+        {4.f, 0, 1, 32 << 20, 0}, {4.f, 4, 1, 32 << 20, 0}, {4.f, 4, 2, 32 << 20, 0},
+        {16.f, 0, 2, 32 << 20, 0}, {16.f, 4, 2, 32 << 20, 0}, {16.f, 8, 4, 32 << 20, 0},
+        {4.f, 4, 2, 2 << 20, 0},
+        {16.f, 0, 2, 32 << 20, 10000}, {16.f, 8, 2, 32 << 20, 10000}, {16.f, 8, 8, 32 << 20, 10000},
+    };
+
+    bool failed = false;
+    std::cout << std::fixed << std::setprecision(2);
+    std::cout << "1M x 1M city, view 16 x 16 chunks of " << STREAM_CHUNK << ", " << frames << " frames" << std::endl;
+    for (const Run &run : runs)
+    {
+        ChunkStream stream([&](int64_t cx, int64_t cy, uint8_t *out) {
+            gen.fillChunk((int)(cx * STREAM_CHUNK), (int)(cy * STREAM_CHUNK), STREAM_CHUNK, STREAM_CHUNK, out);
+            if (run.latencyUs)
+                std::this_thread::sleep_for(std::chrono::microseconds(run.latencyUs));
+        }, size, size, run.threads);
+        stream.lookahead = run.lookahead;
+        stream.budgetBytes = run.budget;
+
+        // a street crossing in the middle of the world, loaded before timing
+        WorldPos pos(size / 2 + 1, size / 2 + 1, 0.5f, 0.5f);
+        float dirX = 1, dirY = 0;
+        stream.update(pos, dirX, dirY);
+        while (stream.inFlight() > 0 || stream.frameMisses > 0)
+        {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            stream.update(pos, dirX, dirY);
+        }
+        uint64_t loads0 = stream.loads, hits0 = stream.hits, lookups0 = stream.lookups;
+        stream.stalls = stream.evictions = 0;
+
+        // legs of 1024 cells along the streets, turning left and right
+        double updateMs = 0, frameMs = 0, leg = 0;
+        int turn = 0;
+        for (int f = 0; f < frames; f++)
+        {
+            auto start = std::chrono::steady_clock::now();
+            stream.update(pos, dirX, dirY);
+            auto mid = std::chrono::steady_clock::now();
+            Camera cam = {stream.viewX(pos), stream.viewY(pos), dirX, dirY, -dirY * 0.66f, dirX * 0.66f};
+            cpu.render(stream.view, cam, settings);
+            auto end = std::chrono::steady_clock::now();
+            updateMs += std::chrono::duration<double, std::milli>(mid - start).count();
+            frameMs += std::chrono::duration<double, std::milli>(end - start).count();
+
+            pos.move(dirX * run.speed, dirY * run.speed);
+            leg += run.speed;
+            if (leg >= 1024) {
+                leg = 0;
+                float t = dirX;
+                dirX = (turn & 1) ? dirY : -dirY;
+                dirY = (turn & 1) ? -t : t;
+                turn++;
+            }
+        }
+        uint64_t lookups = stream.lookups - lookups0;
+        uint64_t hits = stream.hits - hits0, loads = stream.loads - loads0;
+
+        // once the loads drain every view chunk inside the world is resident
+        do
+        {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            stream.update(pos, dirX, dirY);
+        } while (stream.inFlight() > 0 || stream.frameMisses > 0);
+        int leftOver = stream.fallbackChunks();
+        if (leftOver)
+            failed = true;
+
+        std::cout << "  speed " << std::setw(5) << run.speed << "  lookahead " << run.lookahead << "  threads " << run.threads
+                  << "  budget " << std::setw(2) << (run.budget >> 20) << " MB  latency " << run.latencyUs / 1000 << " ms  hit " << std::setw(6)
+                  << 100.0 * hits / (lookups ? lookups : 1) << "%  stalls " << std::setw(4) << stream.stalls
+                  << "  loads " << std::setw(5) << loads << "  evictions " << std::setw(5) << stream.evictions
+                  << "  resident " << std::setw(5) << stream.residentBytes() / 1048576.0 << " MB  update " << std::setw(5)
+                  << updateMs / frames << " ms  frame " << std::setw(5) << frameMs / frames << " ms"
+                  << (leftOver ? "  FALLBACK CHUNKS LEFT " + std::to_string(leftOver) : std::string()) << std::endl;
+    }
+    return failed ? 1 : 0;
+}
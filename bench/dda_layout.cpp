@@ -0,0 +1,76 @@
+// DDA step cost per ray direction for the row, tiled and morton map layouts.
+// usage: bench_dda_layout [size ...]   (default 4096 65536)
+
+#include <iostream>
+#include <iomanip>
+#include <chrono>
+#include <cstdlib>
+#include <vector>
+
+#include "Dda.h"
+#include "BenchUtil.h"
+
+// sparse pillars so rays run for a few hundred cells
+void fillMap(WorldMap &world, int size)
+{
+    seedRand(12345);
+    for (int x = 0; x < size; x++)
+        for (int y = 0; y < size; y++)
+            if (x == 0 || y == 0 || x == size - 1 || y == size - 1 || nextRand() % 512 == 0)
+                world.set(x, y, 1);
+}
+
+int main(int argc, char **argv)
+{
+    seedRand(12345);
+    std::vector<int> sizes;
+    for (int i = 1; i < argc; i++)
+        sizes.push_back(atoi(argv[i]));
+    if (sizes.empty())
+        sizes = {4096, 65536};
+
+    const char *names[] = {"row", "tiled", "morton"};
+    const int angles = 16;
+    const int rays = 50000;
+
+    for (int size : sizes)
+    {
+        std::cout << "map " << size << "x" << size << " (ns/step)" << std::endl;
+        std::cout << std::setw(8) << "angle";
+        for (int l = 0; l < 3; l++)
+            std::cout << std::setw(10) << names[l];
+        std::cout << std::endl;
+
+        std::vector<double> results(angles * 3);
+        for (int l = 0; l < 3; l++)
+        {
+            WorldMap world(size, size, (MapLayout)l);
+            fillMap(world, size);
+            for (int a = 0; a < angles; a++)
+            {
+                float angle = a * 6.2831853f / angles + 0.01f;
+                float dirX = cosf(angle), dirY = sinf(angle);
+                seedRand(777 + a);
+                long long steps = 0;
+                auto start = std::chrono::steady_clock::now();
+                for (int r = 0; r < rays; r++)
+                {
+                    float px = 1.5f + nextRand() % (size - 3);
+                    float py = 1.5f + nextRand() % (size - 3);
+                    steps += castRay(world, px, py, dirX, dirY).steps;
+                }
+                double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+                results[a * 3 + l] = ns / steps;
+            }
+        }
+
+        for (int a = 0; a < angles; a++)
+        {
+            std::cout << std::setw(8) << std::fixed << std::setprecision(1) << a * 360.0 / angles;
+            for (int l = 0; l < 3; l++)
+                std::cout << std::setw(10) << std::setprecision(2) << results[a * 3 + l];
+            std::cout << std::endl;
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,69 @@
+// Byte material grid DDA against the 1 bit occupancy plane DDA.
+// usage: bench_dda_occupancy [size ...]   (default 4096 16384)
+
+#include <iostream>
+#include <iomanip>
+#include <chrono>
+#include <cstdlib>
+#include <vector>
+
+#include "Dda.h"
+#include "BenchUtil.h"
+
+int main(int argc, char **argv)
+{
+    seedRand(12345);
+    std::vector<int> sizes;
+    for (int i = 1; i < argc; i++)
+        sizes.push_back(atoi(argv[i]));
+    if (sizes.empty())
+        sizes = {4096, 16384};
+
+    const int rays = 400000;
+    for (int size : sizes)
+    {
+        WorldMap world(size, size);
+        seedRand(12345);
+        for (int x = 0; x < size; x++)
+            for (int y = 0; y < size; y++)
+                if (x == 0 || y == 0 || x == size - 1 || y == size - 1 || nextRand() % 512 == 0)
+                    world.set(x, y, 1 + nextRand() % 3);
+
+        std::vector<float> ray(rays * 4);
+        seedRand(99);
+        for (int r = 0; r < rays; r++)
+        {
+            float angle = (nextRand() % 36000) * 6.2831853f / 36000;
+            ray[r * 4 + 0] = 1.5f + nextRand() % (size - 3);
+            ray[r * 4 + 1] = 1.5f + nextRand() % (size - 3);
+            ray[r * 4 + 2] = cosf(angle);
+            ray[r * 4 + 3] = sinf(angle);
+        }
+
+        long long steps = 0, mismatches = 0;
+        std::vector<RayHit> ref(rays);
+        auto start = std::chrono::steady_clock::now();
+        for (int r = 0; r < rays; r++)
+        {
+            ref[r] = castRay(world, ray[r * 4], ray[r * 4 + 1], ray[r * 4 + 2], ray[r * 4 + 3]);
+            steps += ref[r].steps;
+        }
+        double byteNs = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+
+        start = std::chrono::steady_clock::now();
+        for (int r = 0; r < rays; r++)
+        {
+            RayHit hit = castRayOccupancy(world, ray[r * 4], ray[r * 4 + 1], ray[r * 4 + 2], ray[r * 4 + 3]);
+            if (hit.mapX != ref[r].mapX || hit.mapY != ref[r].mapY || hit.cell != ref[r].cell || hit.perpWallDist != ref[r].perpWallDist)
+                mismatches++;
+        }
+        double bitNs = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+
+        std::cout << "map " << size << "x" << size << std::fixed << std::setprecision(2)
+                  << "  grid " << world.cells.size() / (1024.0 * 1024.0) << " MB"
+                  << "  plane " << world.occupancy.size() * 8 / (1024.0 * 1024.0) << " MB" << std::endl;
+        std::cout << "  byte grid  " << byteNs / steps << " ns/step" << std::endl;
+        std::cout << "  bit plane  " << bitNs / steps << " ns/step  (" << mismatches << " mismatches)" << std::endl;
+    }
+    return 0;
+}
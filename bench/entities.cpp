@@ -0,0 +1,64 @@
+// Entity store tick time against entity count, checked against the scalar
+// slideMove() rule that Game::move uses.
+// usage: bench_entities [threads]
+
+#include <iostream>
+#include <iomanip>
+#include <chrono>
+#include <cstdlib>
+
+#include "Entities.h"
+#include "BenchUtil.h"
+
+float randUnit() { return (nextRand() % 20001) / 10000.f - 1.f; }
+
+int main(int argc, char **argv)
+{
+    seedRand(12345);
+    int threads = argc > 1 ? atoi(argv[1]) : 0;
+    const int size = 4096, ticks = 50;
+    const float dt = 1.f / 60.f;
+
+    WorldMap world(size, size);
+    for (int x = 0; x < size; x++)
+        for (int y = 0; y < size; y++)
+            if (x == 0 || y == 0 || x == size - 1 || y == size - 1 || nextRand() % 16 == 0)
+                world.set(x, y, 1);
+
+    ThreadPool pool(threads);
+    int counts[] = {10000, 100000, 1000000};
+    std::cout << pool.size() << " threads" << std::endl;
+    for (int count : counts)
+    {
+        EntityStore store;
+        for (int i = 0; i < count; i++)
+            store.add(1.5f + nextRand() % (size - 3), 1.5f + nextRand() % (size - 3), 1, 0, randUnit() * 4, randUnit() * 4, 0.2f);
+        EntityStore ref = store;
+
+        double ms = 0;
+        for (int t = 0; t < ticks; t++)
+        {
+            auto start = std::chrono::steady_clock::now();
+            store.update(world, dt, &pool);
+            ms += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        }
+
+        // scalar reference
+        int mismatches = 0;
+        for (int t = 0; t < ticks; t++)
+            for (int i = 0; i < count; i++)
+            {
+                int blocked = slideMove(world, ref.posX[i], ref.posY[i], ref.velX[i] * dt, ref.velY[i] * dt, ref.radius[i]);
+                if (blocked & 1) ref.velX[i] = 0;
+                if (blocked & 2) ref.velY[i] = 0;
+            }
+        for (int i = 0; i < count; i++)
+            if (ref.posX[i] != store.posX[i] || ref.posY[i] != store.posY[i])
+                mismatches++;
+
+        std::cout << std::setw(8) << count << " entities  " << std::fixed << std::setprecision(3)
+                  << ms / ticks << " ms/tick  " << ms / ticks * 1e6 / count << " ns/entity  "
+                  << mismatches << " mismatches" << std::endl;
+    }
+    return 0;
+}
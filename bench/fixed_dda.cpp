@@ -0,0 +1,78 @@
+// Float against 16.16 fixed point CPU rendering. Prints ns/column for both
+// paths and a hash of the fixed point frame, which must be the same for every
+// thread count and on every machine.
+// usage: bench_fixed_dda [threads]
+
+#include <iostream>
+#include <iomanip>
+#include <chrono>
+#include <cstdlib>
+
+#include "CpuRenderer.h"
+#include "BenchUtil.h"
+
+uint64_t hashFrame(const std::vector<uint32_t> &fb)
+{
+    uint64_t hash = 1469598103934665603ull;
+    for (uint32_t p : fb)
+        hash = (hash ^ p) * 1099511628211ull;
+    return hash;
+}
+
+int main(int argc, char **argv)
+{
+    seedRand(12345);
+    int threads = argc > 1 ? atoi(argv[1]) : 0;
+    const int size = 1024, w = 640, h = 480, frames = 200;
+
+    WorldMap world(size, size);
+    for (int x = 0; x < size; x++)
+        for (int y = 0; y < size; y++)
+            if (x == 0 || y == 0 || x == size - 1 || y == size - 1 || nextRand() % 64 == 0)
+                world.set(x, y, 1);
+
+    std::vector<unsigned char> tex(64 * 64 * 3);
+    for (size_t i = 0; i < tex.size(); i++)
+        tex[i] = (unsigned char)(i * 7);
+
+    ThreadPool single(1), pool(threads);
+    CpuRenderer one(&single), many(&pool);
+    one.resize(w, h);
+    many.resize(w, h);
+    one.setTexture(tex.data(), 64, 64, 3);
+    many.setTexture(tex.data(), 64, 64, 3);
+
+    // no distance limit, same image as compute.glsl
+    RenderSettings settings;
+    settings.maxDistance = 1e30f;
+    settings.fogStart = 1e30f;
+
+    for (int mode = 0; mode < 2; mode++)
+    {
+        many.fixedPoint = mode == 1;
+        one.fixedPoint = mode == 1;
+        uint64_t hash = 0;
+        bool same = true;
+        double ns = 0;
+        for (int f = 0; f < frames; f++)
+        {
+            float angle = f * 0.0314f;
+            Camera cam = {size / 2 + 0.37f, size / 2 + 0.61f, cosf(angle), sinf(angle), -sinf(angle) * 0.85f, cosf(angle) * 0.85f};
+            auto start = std::chrono::steady_clock::now();
+            many.render(world, cam, settings);
+            ns += std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+            if (mode == 1)
+            {
+                one.render(world, cam, settings);
+                same = same && one.framebuffer == many.framebuffer;
+                hash ^= hashFrame(many.framebuffer) + f;
+            }
+        }
+        std::cout << (mode ? "fixed" : "float") << "  " << std::fixed << std::setprecision(1)
+                  << ns / ((double)frames * w) << " ns/column (" << pool.size() << " threads)";
+        if (mode == 1)
+            std::cout << "  hash " << std::hex << hash << std::dec << (same ? "  1 thread == N threads" : "  THREAD MISMATCH");
+        std::cout << std::endl;
+    }
+    return 0;
+}
@@ -0,0 +1,104 @@
+// Hierarchical flow fields on a 4k x 4k map: build, goal solve, per tick
+// steering of 10k agents, and incremental repair after a cell edit.
+// usage: bench_flow_field [size] [agents]
+
+#include <iostream>
+#include <iomanip>
+#include <chrono>
+#include <cstdlib>
+
+#include "FlowField.h"
+#include "BenchUtil.h"
+
+double msSince(std::chrono::steady_clock::time_point start)
+{
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+int main(int argc, char **argv)
+{
+    seedRand(12345);
+    int size = argc > 1 ? atoi(argv[1]) : 4096;
+    int agents = argc > 2 ? atoi(argv[2]) : 10000;
+    const int goalCount = 4, ticks = 100;
+
+    WorldMap world(size, size);
+    for (int x = 0; x < size; x++)
+        for (int y = 0; y < size; y++)
+            if (x == 0 || y == 0 || x == size - 1 || y == size - 1 || nextRand() % 10 == 0)
+                world.set(x, y, 1);
+
+    ThreadPool pool;
+    FlowFields flow;
+    auto start = std::chrono::steady_clock::now();
+    flow.build(world, &pool);
+    std::cout << "map " << size << "x" << size << "  " << pool.size() << " threads  build " << std::fixed << std::setprecision(2)
+              << msSince(start) << " ms  " << flow.nodes() << " portal nodes" << std::endl;
+
+    int gx[goalCount], gy[goalCount];
+    FlowGoalId ids[goalCount];
+    for (int g = 0; g < goalCount; g++)
+    {
+        do {
+            gx[g] = 1 + nextRand() % (size - 2);
+            gy[g] = 1 + nextRand() % (size - 2);
+        } while (world.solid(gx[g], gy[g]));
+    }
+
+    start = std::chrono::steady_clock::now();
+    for (int g = 0; g < goalCount; g++)
+        ids[g] = flow.goal(gx[g], gy[g]);
+    std::cout << "  solve " << goalCount << " goals  " << msSince(start) << " ms" << std::endl;
+
+    std::vector<int> ax(agents), ay(agents), ag(agents);
+    for (int i = 0; i < agents; i++)
+    {
+        do {
+            ax[i] = 1 + nextRand() % (size - 2);
+            ay[i] = 1 + nextRand() % (size - 2);
+        } while (world.solid(ax[i], ay[i]));
+        ag[i] = i % goalCount;
+    }
+
+    double firstTick = 0, total = 0;
+    int arrived = 0;
+    for (int t = 0; t < ticks; t++)
+    {
+        start = std::chrono::steady_clock::now();
+        for (int i = 0; i < agents; i++)
+        {
+            int dx, dy;
+            flowVector(flow.direction(ids[ag[i]], ax[i], ay[i]), dx, dy);
+            ax[i] += dx;
+            ay[i] += dy;
+        }
+        double ms = msSince(start);
+        if (t == 0)
+            firstTick = ms;
+        total += ms;
+    }
+    for (int i = 0; i < agents; i++)
+        arrived += ax[i] == gx[ag[i]] && ay[i] == gy[ag[i]];
+    std::cout << "  " << agents << " agents  first tick " << firstTick << " ms  avg tick "
+              << total / ticks << " ms  " << flow.chunkFlowsBuilt << " chunk flows  "
+              << flow.cachedBytes() / (1024.0 * 1024.0) << " MB cached  " << arrived << " arrived" << std::endl;
+
+    // a door closing in the middle of the map
+    int ex = size / 2, ey = size / 2;
+    int built = flow.chunkFlowsBuilt;
+    start = std::chrono::steady_clock::now();
+    world.set(ex, ey, world.solid(ex, ey) ? 0 : 1);
+    flow.onCellsChanged(ex, ey, ex, ey);
+    double repair = msSince(start);
+    start = std::chrono::steady_clock::now();
+    for (int i = 0; i < agents; i++)
+        flow.direction(ids[ag[i]], ax[i], ay[i]);
+    double refill = msSince(start);
+    std::cout << "  cell edit: repair " << repair << " ms, next tick " << refill << " ms, "
+              << flow.chunkFlowsBuilt - built << " chunk flows rebuilt" << std::endl;
+
+    start = std::chrono::steady_clock::now();
+    flow.build(world, &pool);
+    std::cout << "  full rebuild for comparison " << msSince(start) << " ms" << std::endl;
+    return 0;
+}
@@ -0,0 +1,204 @@
+#pragma once
+
+#include <glad/glad.h>
+
+#include <cstdint>
+#include <vector>
+
+#include "Assets.h"
+#include "WorldMap.h"
+#include "LightMap.h"
+#include "TextureAtlas.h"
+#include "Palette.h"
+#include "ThreadPool.h"
+#include "RenderSettings.h"
+
+// The scene Game::init builds (the 10 x 10 map with its floors, grate,
+// glass and door, two lights, wall.png and its tinted copies), uploaded
+// and bound to the same units, so a bench can dispatch the game's compute
+// kernels headless and read the frame back.
+
+#define SCENE_DATAS_COUNT 11
+
+class GpuScene
+{
+private:
+    ThreadPool pool;
+
+public:
+    int w = 640, h = 480;
+    WorldMap world;
+    LightMap lights;
+    TextureAtlas atlas;
+    TextureTable surfaces;
+    RenderSettings settings;
+    GLuint image = 0, map = 0, datas = 0, light = 0, palette = 0, surface = 0, textures = 0;
+
+    GpuScene() : pool(1) {}
+    void init(); // with a current context
+    void uploadMap(); // after changing world
+    void setView(float posX, float posY, float dirX, float dirY, float planeX, float planeY);
+    void clear();
+    std::vector<float> read(); // RGBA32F, rows bottom up
+};
+
+static const int scene_map[10][10] = {
+    {1, 1, 1, 1, 1, 1, 1, 1, 1, 1},
+    {1, 0, 0, 0, 0, 0, 0, 0, 0, 1},
+    {1, 0, 0, 0, 2, 2, 0, 0, 0, 1},
+    {1, 0, 0, 0, 0, 0, 0, 0, 0, 1},
+    {1, 0, 0, 0, 2, 2, 0, 0, 0, 1},
+    {1, 0, 0, 0, 0, 0, 0, 0, 0, 1},
+    {1, 0, 0, 0, 3, 3, 3, 0, 0, 1},
+    {1, 0, 0, 3, 3, 0, 3, 0, 0, 1},
+    {1, 0, 0, 0, 0, 0, 0, 0, 0, 1},
+    {1, 1, 1, 1, 1, 1, 1, 1, 1, 1},
+};
+
+void GpuScene::init()
+{
+    world.load(&scene_map[0][0], 10, 10);
+    for (int x = 7; x < 9; x++)
+        for (int y = 1; y < 9; y++)
+            world.setFloor(x, y, 4);
+    world.set(6, 5, 5);
+    world.set(7, 4, 6);
+    world.setThin(7, THIN_X);
+    world.set(8, 5, 7);
+    lights.addLight({2.5f, 2.5f, 6.f});
+    lights.addLight({7.5f, 7.5f, 6.f});
+    lights.build(world, &pool);
+
+    // wall.png, or a checker when the assets are not around
+    ImageAsset wall;
+    std::vector<unsigned char> checker;
+    if (!loadImageAsset("wall.png", wall)) {
+        checker.resize(64 * 64 * 3);
+        for (int i = 0; i < 64 * 64; i++)
+            for (int c = 0; c < 3; c++)
+                checker[i * 3 + c] = ((i % 64 / 8 + i / 64 / 8) & 1) ? 200 : 60 + c * 40;
+        wall.pixels = checker.data();
+        wall.w = wall.h = 64;
+        wall.channels = 3;
+    }
+    const unsigned char *wallData = wall.pixels;
+    int tw = wall.w, th = wall.h, tnumC = wall.channels;
+    atlas.add(wallData, tw, th, tnumC);
+    std::vector<unsigned char> tinted((size_t)tw * th * 3);
+    const float tints[3][3] = {{1.f, .55f, .5f}, {.5f, .7f, 1.f}, {.6f, .6f, .6f}};
+    for (int t = 0; t < 3; t++)
+    {
+        for (size_t i = 0; i < (size_t)tw * th; i++)
+            for (int c = 0; c < 3; c++)
+                tinted[i * 3 + c] = (unsigned char)(wallData[i * tnumC + c] * tints[t][c]);
+        atlas.add(tinted.data(), tw, th, 3);
+    }
+    for (int y = 0; y < th; y++)
+        for (int x = 0; x < tw; x++)
+        {
+            size_t i = (size_t)y * tw + x;
+            bool bar = (x * 8 / tw) % 2 == 0 || y * 8 / th == 0 || y * 8 / th == 7;
+            for (int c = 0; c < 3; c++)
+                tinted[i * 3 + c] = bar ? wallData[i * tnumC + c] : (c == 1 ? 0 : 255);
+        }
+    atlas.add(tinted.data(), tw, th, 3);
+    surfaces.setWall(1, 0);
+    surfaces.setWall(2, 1);
+    surfaces.setWall(3, 2);
+    surfaces.setWall(4, 0);
+    surfaces.setWall(5, 4, MATERIAL_MASKED);
+    surfaces.setWall(6, 2, MATERIAL_TRANSLUCENT, 110);
+    surfaces.setWall(7, 3);
+    surfaces.setFloor(4, 3, 3);
+
+    glGenBuffers(1, &map);
+    uploadMap();
+
+    glGenBuffers(1, &datas);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, datas);
+    glBufferData(GL_SHADER_STORAGE_BUFFER, sizeof(float) * SCENE_DATAS_COUNT, NULL, GL_DYNAMIC_DRAW);
+    setView(3.f, 3.f, -1.f, 0.f, 0.f, 0.85f);
+
+    std::vector<uint32_t> lightLevels = lights.exportPacked();
+    glGenBuffers(1, &light);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, light);
+    glBufferData(GL_SHADER_STORAGE_BUFFER, lightLevels.size() * sizeof(uint32_t), lightLevels.data(), GL_STATIC_DRAW);
+
+    Palette atlasPalette;
+    std::vector<uint8_t> atlasIndices;
+    quantizeTexture(atlas.rgb.data(), atlas.w, atlas.h * atlas.layers, 3, atlasPalette, atlasIndices);
+    glGenTextures(1, &textures);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, textures);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    glTexImage3D(GL_TEXTURE_2D_ARRAY, 0, GL_R8UI, atlas.w, atlas.h, atlas.layers, 0, GL_RED_INTEGER, GL_UNSIGNED_BYTE, atlasIndices.data());
+
+    float paletteColors[256 * 4];
+    for (int i = 0; i < 256; i++)
+    {
+        paletteColors[i * 4 + 0] = (atlasPalette.colors[i] & 0xFF) / 255.f;
+        paletteColors[i * 4 + 1] = ((atlasPalette.colors[i] >> 8) & 0xFF) / 255.f;
+        paletteColors[i * 4 + 2] = ((atlasPalette.colors[i] >> 16) & 0xFF) / 255.f;
+        paletteColors[i * 4 + 3] = 1.f;
+    }
+    glGenBuffers(1, &palette);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, palette);
+    glBufferData(GL_SHADER_STORAGE_BUFFER, sizeof(paletteColors), paletteColors, GL_STATIC_DRAW);
+
+    // wall surfaces by cell value, then floor surfaces by floor kind
+    int surfaceLayers[256 * 4];
+    for (int i = 0; i < 256; i++)
+    {
+        surfaceLayers[i * 2 + 0] = surfaces.walls[i].layer;
+        surfaceLayers[i * 2 + 1] = surfaces.walls[i].material | surfaces.walls[i].alpha << 8 |
+                                   world.thin[i].axis << 16 | int(world.thin[i].offset * 255.f + 0.5f) << 24;
+        surfaceLayers[512 + i * 2 + 0] = surfaces.floors[i].floor;
+        surfaceLayers[512 + i * 2 + 1] = surfaces.floors[i].ceiling;
+    }
+    glGenBuffers(1, &surface);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, surface);
+    glBufferData(GL_SHADER_STORAGE_BUFFER, sizeof(surfaceLayers), surfaceLayers, GL_STATIC_DRAW);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+
+    glGenTextures(1, &image);
+    glBindTexture(GL_TEXTURE_2D, image);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA32F, w, h, 0, GL_RGBA, GL_FLOAT, NULL);
+
+    glBindImageTexture(0, image, 0, GL_FALSE, 0, GL_READ_WRITE, GL_RGBA32F);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, map);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 2, datas);
+    glBindImageTexture(3, textures, 0, GL_TRUE, 0, GL_READ_ONLY, GL_R8UI);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 4, light);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 5, palette);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 6, surface);
+}
+
+void GpuScene::uploadMap()
+{
+    std::vector<int> gpuMap = world.exportRowMajor();
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, map);
+    glBufferData(GL_SHADER_STORAGE_BUFFER, gpuMap.size() * sizeof(int), gpuMap.data(), GL_DYNAMIC_DRAW);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+}
+
+void GpuScene::setView(float posX, float posY, float dirX, float dirY, float planeX, float planeY)
+{
+    float d[SCENE_DATAS_COUNT] = {posX, posY, dirX, dirY, planeX, planeY, settings.maxDistance, settings.fogStart,
+                                  settings.fogColor[0], settings.fogColor[1], settings.fogColor[2]};
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, datas);
+    glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, sizeof(d), d);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+}
+
+void GpuScene::clear()
+{
+    glClearTexImage(image, 0, GL_RGBA, GL_FLOAT, NULL);
+}
+
+std::vector<float> GpuScene::read()
+{
+    std::vector<float> pixels((size_t)w * h * 4);
+    glMemoryBarrier(GL_TEXTURE_UPDATE_BARRIER_BIT);
+    glBindTexture(GL_TEXTURE_2D, image);
+    glGetTexImage(GL_TEXTURE_2D, 0, GL_RGBA, GL_FLOAT, pixels.data());
+    return pixels;
+}
@@ -0,0 +1,197 @@
+// Startup cost of the game's three programs (quad, ray, scatter) under the
+// driver in use, headless: compiled one after another, all started before
+// the first is waited on (ShaderCache::begin/finish, parallel where the
+// driver has KHR_parallel_shader_compile), and loaded from the program
+// binary cache. "ready" is until finish() returned all three, "first
+// frame" adds one dispatch of the ray kernel over the game's scene, since
+// some drivers (llvmpipe among them) finish code generation on first use.
+// Then the misses: a cache file corrupted on disk, which the driver must
+// refuse so the program is rebuilt from source, and one shader edited, whose
+// new binary must replace the old one on disk instead of piling up.
+// Mesa offers program binaries only with its own shader cache on, which
+// would also turn every cold compile after the first into a hit: the cold
+// runs get sources with a unique comment appended, and Mesa's cache goes
+// to a scratch directory (unless MESA_SHADER_CACHE_DIR is set). Under
+// llvmpipe the binary holds the linked IR, not machine code, so a warm
+// first frame still depends on Mesa's cache for the JIT.
+// usage: bench_shader_cache [rounds], from the build directory
+
+#include <iostream>
+#include <iomanip>
+#include <chrono>
+#include <cstdlib>
+#include <algorithm>
+#include <filesystem>
+
+#define STB_IMAGE_IMPLEMENTATION
+#include "HeadlessContext.h"
+#include "GpuScene.h"
+#include "ShaderCache.h"
+
+static std::string str_computeShader, str_vertexShader, str_fragmentShader, str_scatterShader;
+
+struct Startup
+{
+    double ready, firstFrame; // ms
+    int loaded, compiled, rejected;
+    bool parallel, binaries;
+    GLuint ray;
+};
+
+static double ms(std::chrono::steady_clock::time_point a, std::chrono::steady_clock::time_point b)
+{
+    return std::chrono::duration<double, std::milli>(b - a).count();
+}
+
+// suffix goes after every source, edit after the compute shader only
+static Startup startup(GpuScene &scene, const std::string &dir, bool overlap, const std::string &suffix,
+                       const std::string &edit = "")
+{
+    std::string vertex = str_vertexShader + suffix, fragment = str_fragmentShader + suffix;
+    std::string compute = str_computeShader + suffix + edit, scatter = str_scatterShader + suffix;
+
+    auto start = std::chrono::steady_clock::now();
+    ShaderCache cache;
+    cache.init(dir, (void *(*)(const char *))eglGetProcAddress);
+    std::vector<std::vector<ShaderCache::Stage>> programs = {
+        {{GL_VERTEX_SHADER, &vertex}, {GL_FRAGMENT_SHADER, &fragment}},
+        {{GL_COMPUTE_SHADER, &compute}},
+        {{GL_COMPUTE_SHADER, &scatter}},
+    };
+    const char *names[3] = {"quad", "ray", "scatter"};
+    GLuint made[3];
+    if (overlap) {
+        int tickets[3];
+        for (int i = 0; i < 3; i++)
+            tickets[i] = cache.begin(names[i], programs[i]);
+        for (int i = 0; i < 3; i++)
+            made[i] = cache.finish(tickets[i]);
+    } else {
+        for (int i = 0; i < 3; i++)
+            made[i] = cache.finish(cache.begin(names[i], programs[i]));
+    }
+    auto ready = std::chrono::steady_clock::now();
+
+    scene.clear();
+    glUseProgram(made[1]);
+    glDispatchCompute((GLuint)scene.w, 1, 1);
+    glFinish();
+    auto first = std::chrono::steady_clock::now();
+
+    glDeleteProgram(made[0]);
+    glDeleteProgram(made[2]);
+    return {ms(start, ready), ms(start, first), cache.loaded, cache.compiled, cache.rejected, cache.parallel,
+            cache.binaries, made[1]};
+}
+
+// largest channel difference between two read backs
+static float frameDiff(const std::vector<float> &a, const std::vector<float> &b)
+{
+    float d = 0.f;
+    for (size_t i = 0; i < a.size(); i++)
+        d = std::max(d, std::abs(a[i] - b[i]));
+    return d;
+}
+
+int main(int argc, char **argv)
+{
+    int rounds = argc > 1 ? atoi(argv[1]) : 5;
+    const std::string mesaCache = "bench_shader_cache.mesa.tmp";
+    bool ownMesaCache = !getenv("MESA_SHADER_CACHE_DIR");
+    if (ownMesaCache) {
+        std::filesystem::remove_all(mesaCache);
+        setenv("MESA_SHADER_CACHE_DIR", mesaCache.c_str(), 1);
+    }
+
+    HeadlessContext context;
+    if (!context.init())
+        return 1;
+    std::cout << context.description() << std::endl;
+
+    // from the build directory (assets are copied there) or RAYCASTER_ASSETS
+    if (!loadTextAsset("shaders/compute.glsl", str_computeShader) || !loadTextAsset("shaders/vertex.glsl", str_vertexShader) ||
+        !loadTextAsset("shaders/fragment.glsl", str_fragmentShader) ||
+        !loadTextAsset("shaders/map_scatter.glsl", str_scatterShader))
+        return 1;
+
+    GpuScene scene;
+    scene.init();
+
+    const std::string dir = "bench_shader_cache.tmp";
+    const char *labels[] = {"serial, no cache", "overlapped, no cache", "overlapped, cache cold", "cache warm",
+                            "ray binary corrupted", "compute shader edited"};
+    const int runs = 6;
+    std::vector<std::vector<Startup>> results(runs);
+    float binaryDiff = 0.f;
+    int nonce = 0, staleBinaries = 0;
+    auto unique = [&] { return "\n// run " + std::to_string(nonce++) + "\n"; };
+    for (int r = 0; r < rounds; r++)
+    {
+        std::filesystem::remove_all(dir);
+        std::vector<Startup> round;
+        round.push_back(startup(scene, "", false, unique()));
+        round.push_back(startup(scene, "", true, unique()));
+        std::string filled = unique();
+        round.push_back(startup(scene, dir, true, filled));
+        std::vector<float> compiledFrame = scene.read();
+        round.push_back(startup(scene, dir, true, filled));
+        binaryDiff = std::max(binaryDiff, frameDiff(compiledFrame, scene.read()));
+
+        // flip bytes in the middle of every cached ray binary
+        std::error_code ec;
+        for (auto &entry : std::filesystem::directory_iterator(dir, ec))
+        {
+            std::string name = entry.path().filename().string();
+            if (name.compare(0, 4, "ray-") != 0)
+                continue;
+            std::fstream file(entry.path(), std::ios::in | std::ios::out | std::ios::binary);
+            file.seekg(0, std::ios::end);
+            std::streamoff size = file.tellg();
+            for (std::streamoff at = size / 2; at < size / 2 + 64 && at < size; at++)
+            {
+                file.seekg(at);
+                char c = (char)file.get();
+                file.seekp(at);
+                file.put((char)~c);
+            }
+        }
+        round.push_back(startup(scene, dir, true, filled));
+        // the program rebuilt after the corruption draws like the original
+        binaryDiff = std::max(binaryDiff, frameDiff(compiledFrame, scene.read()));
+
+        round.push_back(startup(scene, dir, true, filled, unique()));
+        int rayBinaries = 0;
+        for (auto &entry : std::filesystem::directory_iterator(dir, ec))
+            rayBinaries += entry.path().filename().string().compare(0, 4, "ray-") == 0;
+        staleBinaries = std::max(staleBinaries, rayBinaries - 1);
+
+        for (int i = 0; i < runs; i++)
+        {
+            glDeleteProgram(round[i].ray);
+            results[i].push_back(round[i]);
+        }
+    }
+    std::filesystem::remove_all(dir);
+    if (ownMesaCache)
+        std::filesystem::remove_all(mesaCache);
+
+    std::cout << "parallel compile: " << (results[0][0].parallel ? "yes" : "no") << ", program binaries: "
+              << (results[2][0].binaries ? "yes" : "no") << ", " << rounds << " rounds, medians" << std::endl;
+    std::cout << std::left << std::setw(24) << "" << std::right << std::setw(12) << "ready ms" << std::setw(16)
+              << "first frame ms" << std::setw(8) << "loaded" << std::setw(10) << "compiled" << std::setw(10)
+              << "rejected" << std::endl;
+    for (int i = 0; i < runs; i++)
+    {
+        std::vector<Startup> &v = results[i];
+        std::sort(v.begin(), v.end(), [](const Startup &a, const Startup &b) { return a.ready < b.ready; });
+        double ready = v[v.size() / 2].ready;
+        std::sort(v.begin(), v.end(), [](const Startup &a, const Startup &b) { return a.firstFrame < b.firstFrame; });
+        const Startup &m = v[v.size() / 2];
+        std::cout << std::left << std::setw(24) << labels[i] << std::right << std::fixed << std::setprecision(1)
+                  << std::setw(12) << ready << std::setw(16) << m.firstFrame << std::setw(8) << m.loaded << std::setw(10)
+                  << m.compiled << std::setw(10) << m.rejected << std::endl;
+    }
+    std::cout << "largest difference, cached and rebuilt frames against the compiled one: " << binaryDiff << std::endl;
+    std::cout << "stale ray binaries left after the edit: " << std::max(staleBinaries, 0) << std::endl;
+    return 0;
+}
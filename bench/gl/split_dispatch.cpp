@@ -0,0 +1,189 @@
+// The game's ray kernel (compute.glsl, one invocation per column in
+// workgroups of 1, after a clear) against the split dispatch: ray_cast.glsl
+// with 64 rays per workgroup into the column buffer, then ray_shade.glsl
+// with one invocation per pixel in 8 x 8 tiles. Timed with GL_TIME_ELAPSED
+// (and GL_TIMESTAMP) queries over views all around the game's map (door part open, so the
+// grate, glass and door layers are in), and every view's frame compared
+// against the old kernel's.
+// usage: bench_split_dispatch [frames per view], from the build directory
+
+#include <iostream>
+#include <iomanip>
+#include <cstdlib>
+#include <cmath>
+#include <algorithm>
+#include <functional>
+#include <string>
+
+#define STB_IMAGE_IMPLEMENTATION
+#include "HeadlessContext.h"
+#include "GpuScene.h"
+#include "ShaderCache.h"
+
+#define COLUMN_BYTES 224 // struct Column in ray_cast.glsl
+
+struct View
+{
+    float posX, posY, dirX, dirY, planeX, planeY;
+};
+
+int main(int argc, char **argv)
+{
+    int frames = argc > 1 ? atoi(argv[1]) : 3;
+
+    HeadlessContext context;
+    if (!context.init())
+        return 1;
+    std::cout << context.description() << std::endl;
+
+    std::string computeSource, castSource, shadeSource;
+    if (!loadTextAsset("shaders/compute.glsl", computeSource) || !loadTextAsset("shaders/ray_cast.glsl", castSource) ||
+        !loadTextAsset("shaders/ray_shade.glsl", shadeSource))
+        return 1;
+    ShaderCache shaders;
+    shaders.init("", NULL);
+    int rayTicket = shaders.begin("ray", {{GL_COMPUTE_SHADER, &computeSource}});
+    int castTicket = shaders.begin("cast", {{GL_COMPUTE_SHADER, &castSource}});
+    int shadeTicket = shaders.begin("shade", {{GL_COMPUTE_SHADER, &shadeSource}});
+    GLuint ray = shaders.finish(rayTicket), cast = shaders.finish(castTicket), shade = shaders.finish(shadeTicket);
+
+    GpuScene scene;
+    scene.init();
+    scene.world.setOpen(8, 5, 0.4f);
+    scene.uploadMap();
+
+    GLuint columns;
+    glGenBuffers(1, &columns);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, columns);
+    glBufferData(GL_SHADER_STORAGE_BUFFER, (GLsizeiptr)scene.w * COLUMN_BYTES, NULL, GL_DYNAMIC_DRAW);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 8, columns);
+
+    // 8 headings from every open cell centre and from a few off-centre spots
+    std::vector<View> views;
+    for (int x = 1; x < 9; x++)
+        for (int y = 1; y < 9; y++)
+        {
+            if (scene.world.get(x, y) != 0)
+                continue;
+            for (int a = 0; a < 8; a++)
+            {
+                float angle = a * 0.785398f + (x * 7 + y) * 0.1f;
+                float px = x + ((x + y) % 3 == 0 ? 0.2f : 0.5f), py = y + 0.5f;
+                float dx = cosf(angle), dy = sinf(angle);
+                views.push_back({px, py, dx, dy, -dy * 0.85f, dx * 0.85f});
+            }
+        }
+
+    auto drawOld = [&]() {
+        scene.clear();
+        glUseProgram(ray);
+        glDispatchCompute((GLuint)scene.w, 1, 1);
+        glMemoryBarrier(GL_SHADER_IMAGE_ACCESS_BARRIER_BIT);
+    };
+    auto drawCast = [&]() {
+        glUseProgram(cast);
+        glDispatchCompute((GLuint)(scene.w + 63) / 64, 1, 1);
+        glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+    };
+    auto drawShade = [&]() {
+        glUseProgram(shade);
+        glDispatchCompute((GLuint)(scene.w + 7) / 8, (GLuint)(scene.h + 7) / 8, 1);
+        glMemoryBarrier(GL_SHADER_IMAGE_ACCESS_BARRIER_BIT);
+    };
+
+    // compare every view, which also gets the JIT out of the way
+    long long differing = 0, visible = 0;
+    float worst = 0.f;
+    int worstView = 0;
+    for (size_t v = 0; v < views.size(); v++)
+    {
+        const View &view = views[v];
+        scene.setView(view.posX, view.posY, view.dirX, view.dirY, view.planeX, view.planeY);
+        drawOld();
+        std::vector<float> before = scene.read();
+        // stale pixels would hide a missed write: the split path must not need the clear
+        float nan = NAN;
+        glClearTexImage(scene.image, 0, GL_RGBA, GL_FLOAT, &nan);
+        drawCast();
+        drawShade();
+        std::vector<float> after = scene.read();
+        for (size_t i = 0; i < before.size(); i += 4)
+        {
+            float d = 0.f;
+            for (int c = 0; c < 4; c++)
+            {
+                float e = std::fabs(before[i + c] - after[i + c]);
+                d = std::max(d, e == e ? e : 1.f);
+            }
+            differing += d > 0.f;
+            visible += d > 0.5f / 255.f;
+            if (d > worst) {
+                worst = d;
+                worstView = (int)v;
+            }
+        }
+    }
+    long long pixels = (long long)views.size() * scene.w * scene.h;
+    std::cout << views.size() << " views, " << scene.w << " x " << scene.h << std::endl;
+    std::cout << "pixels differing from compute.glsl: " << differing << " of " << pixels << " ("
+              << std::setprecision(3) << 100.0 * differing / pixels << "%), over half a step of 8 bit: " << visible
+              << ", largest difference " << worst << " (view " << worstView << ")" << std::endl;
+
+    // GL_TIME_ELAPSED around each pass, and a GL_TIMESTAMP either side of
+    // it: llvmpipe (Mesa 22) leaves compute work out of TIME_ELAPSED, the
+    // timestamps still see it
+    struct Pass
+    {
+        GLuint elapsed, before, after;
+        double elapsedMs = 0, stampMs = 0;
+    };
+    Pass passes[3];
+    for (Pass &p : passes)
+    {
+        glGenQueries(1, &p.elapsed);
+        glGenQueries(1, &p.before);
+        glGenQueries(1, &p.after);
+    }
+    auto timed = [](Pass &p, const std::function<void()> &draw) {
+        glQueryCounter(p.before, GL_TIMESTAMP);
+        glBeginQuery(GL_TIME_ELAPSED, p.elapsed);
+        draw();
+        glEndQuery(GL_TIME_ELAPSED);
+        glQueryCounter(p.after, GL_TIMESTAMP);
+    };
+    auto collect = [](Pass &p) {
+        GLuint64 ns = 0, before = 0, after = 0;
+        glGetQueryObjectui64v(p.elapsed, GL_QUERY_RESULT, &ns);
+        glGetQueryObjectui64v(p.before, GL_QUERY_RESULT, &before);
+        glGetQueryObjectui64v(p.after, GL_QUERY_RESULT, &after);
+        p.elapsedMs += ns / 1e6;
+        p.stampMs += (after - before) / 1e6;
+    };
+    for (int f = 0; f < frames; f++)
+        for (const View &view : views)
+        {
+            scene.setView(view.posX, view.posY, view.dirX, view.dirY, view.planeX, view.planeY);
+            timed(passes[0], drawOld);
+            timed(passes[1], drawCast);
+            timed(passes[2], drawShade);
+            for (Pass &p : passes)
+                collect(p);
+        }
+    double n = (double)frames * views.size();
+    std::cout << std::fixed << std::setprecision(3) << "ms per frame, " << frames << " frames per view" << std::endl;
+    std::cout << std::left << std::setw(24) << "" << std::right << std::setw(14) << "TIME_ELAPSED" << std::setw(12)
+              << "TIMESTAMP" << std::endl;
+    const char *labels[3] = {"clear + column kernel", "cast (64 per group)", "shade (8 x 8 tiles)"};
+    for (int i = 0; i < 3; i++)
+        std::cout << std::left << std::setw(24) << labels[i] << std::right << std::setw(14) << passes[i].elapsedMs / n
+                  << std::setw(12) << passes[i].stampMs / n << std::endl;
+    double elapsedSplit = passes[1].elapsedMs + passes[2].elapsedMs, stampSplit = passes[1].stampMs + passes[2].stampMs;
+    std::cout << std::left << std::setw(24) << "cast + shade" << std::right << std::setw(14) << elapsedSplit / n
+              << std::setw(12) << stampSplit / n << std::endl;
+    // under a microsecond a frame: the driver did not time the dispatches
+    bool elapsedValid = elapsedSplit / n > 1e-3;
+    std::cout << std::left << std::setw(24) << "speedup" << std::right << std::setw(14)
+              << (elapsedValid ? std::to_string(passes[0].elapsedMs / elapsedSplit) : std::string("n/a")) << std::setw(12)
+              << passes[0].stampMs / stampSplit << std::endl;
+    return 0;
+}
@@ -0,0 +1,100 @@
+// Variable heights path: frame cost, cells per column and pixel writes per
+// frame, on a flat map (compared with the unit wall path) and on a map of
+// low walls, steps and lowered ceilings that rays see past.
+// usage: bench_heights [size]
+
+#include <iostream>
+#include <iomanip>
+#include <chrono>
+#include <cstdlib>
+
+#include "CpuRenderer.h"
+#include "BenchUtil.h"
+
+int main(int argc, char **argv)
+{
+    seedRand(4242);
+    int size = argc > 1 ? atoi(argv[1]) : 256;
+    const int w = 640, h = 480, frames = 20;
+
+    WorldMap world(size, size);
+    for (int x = 0; x < size; x++)
+        for (int y = 0; y < size; y++)
+            if (x == 0 || y == 0 || x == size - 1 || y == size - 1 || nextRand() % 16 == 0)
+                world.set(x, y, 1);
+
+    std::vector<unsigned char> tex(64 * 64 * 3);
+    for (size_t i = 0; i < tex.size(); i++)
+        tex[i] = (unsigned char)(nextRand() & 0xFF);
+
+    ThreadPool pool;
+    CpuRenderer cpu(&pool);
+    cpu.resize(w, h);
+    cpu.setTexture(tex.data(), 64, 64, 3);
+    RenderSettings settings;
+    settings.maxDistance = 48.f;
+    settings.fogStart = 32.f;
+
+    HeightField flat;
+    flat.fromWorld(world);
+
+    HeightField stepped;
+    stepped.fromWorld(world);
+    for (int x = 1; x < size - 1; x++)
+        for (int y = 1; y < size - 1; y++)
+        {
+            uint32_t r = nextRand() % 100;
+            if (world.solid(x, y)) {
+                if (r < 60)
+                    stepped.setWall(x, y, 0.25f + (nextRand() % 3) * 0.25f);
+            } else if (r < 10) {
+                stepped.setFloor(x, y, 0.125f * (1 + nextRand() % 3));
+            } else if (r < 20) {
+                stepped.setCeiling(x, y, 0.75f + 0.0625f * (nextRand() % 4));
+            }
+        }
+    // keep the camera's own cell flat
+    stepped.setFloor(size / 2, size / 2, 0.f);
+    stepped.setCeiling(size / 2, size / 2, 1.f);
+
+    std::cout << std::fixed << std::setprecision(3);
+    std::cout << "map " << size << "x" << size << "  " << pool.size() << " threads" << std::endl;
+
+    std::vector<uint32_t> reference;
+    const char *names[3] = {"unit walls  ", "heights flat", "heights mix "};
+    const HeightField *fields[3] = {NULL, &flat, &stepped};
+    for (int mode = 0; mode < 3; mode++)
+    {
+        cpu.heights = fields[mode];
+        double total = 0;
+        long long cells = 0, writes = 0;
+        int worstCells = 0;
+        long long differ = 0;
+        for (int f = 0; f < frames; f++)
+        {
+            float angle = f * 6.2831853f / frames;
+            Camera cam = {size / 2 + 0.5f, size / 2 + 0.5f, cosf(angle), sinf(angle), -sinf(angle) * 0.85f, cosf(angle) * 0.85f};
+            auto start = std::chrono::steady_clock::now();
+            cpu.render(world, cam, settings);
+            total += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+            if (cpu.heights) {
+                cells += cpu.heightStats.cellsVisited;
+                writes += cpu.heightStats.pixelsWritten;
+                worstCells = std::max(worstCells, cpu.heightStats.maxColumnCells);
+            }
+            if (mode == 0 && f == 0)
+                reference = cpu.framebuffer;
+            if (mode == 1 && f == 0)
+                for (size_t i = 0; i < reference.size(); i++)
+                    differ += reference[i] != cpu.framebuffer[i];
+        }
+        std::cout << "  " << names[mode] << "  avg " << std::setw(7) << total / frames << " ms";
+        if (mode > 0)
+            std::cout << "  cells/column " << std::setprecision(1) << double(cells) / frames / w << " (max " << worstCells << ")"
+                      << "  writes/pixel " << std::setprecision(3) << double(writes) / frames / (w * h);
+        if (mode == 1)
+            std::cout << "  " << std::setprecision(2) << 100.0 * differ / reference.size() << "% pixels differ from unit walls";
+        std::cout << std::endl;
+    }
+    return 0;
+}
@@ -0,0 +1,113 @@
+// Baked light maps: full bake, incremental relight after single cell edits
+// and after a batch of edit rects (checked against a full rebake), and CPU
+// frame cost with lighting on.
+// usage: bench_light_map [size] [lights] [edits]
+
+#include <iostream>
+#include <iomanip>
+#include <chrono>
+#include <cstdlib>
+
+#include "CpuRenderer.h"
+#include "BenchUtil.h"
+
+double msSince(std::chrono::steady_clock::time_point start)
+{
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+int main(int argc, char **argv)
+{
+    seedRand(2024);
+    int size = argc > 1 ? atoi(argv[1]) : 512;
+    int lightCount = argc > 2 ? atoi(argv[2]) : 2000;
+    int edits = argc > 3 ? atoi(argv[3]) : 200;
+
+    WorldMap world(size, size);
+    for (int x = 0; x < size; x++)
+        for (int y = 0; y < size; y++)
+            if (x == 0 || y == 0 || x == size - 1 || y == size - 1 || nextRand() % 8 == 0)
+                world.set(x, y, 1);
+
+    ThreadPool pool;
+    LightMap lights;
+    for (int i = 0; i < lightCount; i++)
+        lights.addLight({1 + (nextRand() % ((size - 2) * 16)) / 16.f, 1 + (nextRand() % ((size - 2) * 16)) / 16.f, 4.f + nextRand() % 8});
+
+    auto start = std::chrono::steady_clock::now();
+    lights.build(world, &pool);
+    double bake = msSince(start);
+    std::cout << std::fixed << std::setprecision(3);
+    std::cout << "map " << size << "x" << size << "  " << lightCount << " lights  " << pool.size() << " threads" << std::endl;
+    std::cout << "  full bake " << bake << " ms" << std::endl;
+
+    double total = 0, worst = 0;
+    long rebaked = 0;
+    for (int e = 0; e < edits; e++)
+    {
+        int x = 1 + nextRand() % (size - 2), y = 1 + nextRand() % (size - 2);
+        world.set(x, y, world.solid(x, y) ? 0 : 1);
+        start = std::chrono::steady_clock::now();
+        lights.onCellsChanged(x, y, x, y);
+        double ms = msSince(start);
+        total += ms;
+        worst = ms > worst ? ms : worst;
+        rebaked += lights.relit;
+    }
+    std::cout << "  cell edit avg " << total / edits << " ms  worst " << worst << " ms  "
+              << double(rebaked) / edits << " lights rebaked per edit" << std::endl;
+
+    // a frame's worth of edits in one call: each light is rebaked once,
+    // however many of the batch's rects it covers
+    MapEdits batch;
+    for (int e = 0; e < 64; e++)
+    {
+        int x = 1 + nextRand() % (size / 4), y = 1 + nextRand() % (size / 4);
+        batch.set(x, y, world.solid(x, y) ? 0 : 1);
+    }
+    batch.apply(world);
+    int perRect = 0;
+    start = std::chrono::steady_clock::now();
+    for (const MapEdits::Rect &r : batch.rects)
+    {
+        lights.onCellsChanged(r.x0, r.y0, r.x1, r.y1);
+        perRect += lights.relit;
+    }
+    double rectMs = msSince(start);
+    start = std::chrono::steady_clock::now();
+    lights.onCellsChanged(batch.rects);
+    double batchMs = msSince(start);
+    std::cout << "  batch of " << batch.rects.size() << " rects " << batchMs << " ms  " << lights.relit
+              << " lights rebaked (one rect at a time " << rectMs << " ms  " << perRect << ")" << std::endl;
+
+    // the incremental tables must match a bake from scratch
+    std::vector<uint8_t> floorLight = lights.floorLight, faceLight = lights.faceLight;
+    lights.build(world, &pool);
+    bool same = floorLight == lights.floorLight && faceLight == lights.faceLight;
+    std::cout << "  incremental " << (same ? "matches" : "DIFFERS FROM") << " full bake" << std::endl;
+
+    const int w = 640, h = 480, frames = 20;
+    std::vector<unsigned char> tex(64 * 64 * 3);
+    for (size_t i = 0; i < tex.size(); i++)
+        tex[i] = (unsigned char)(nextRand() & 0xFF);
+    CpuRenderer cpu(&pool);
+    cpu.resize(w, h);
+    cpu.setTexture(tex.data(), 64, 64, 3);
+    RenderSettings settings;
+
+    for (int lit = 0; lit < 2; lit++)
+    {
+        cpu.lightMap = lit ? &lights : NULL;
+        double frameTotal = 0;
+        for (int f = 0; f < frames; f++)
+        {
+            float angle = f * 6.2831853f / frames;
+            Camera cam = {size / 2 + 0.5f, size / 2 + 0.5f, cosf(angle), sinf(angle), -sinf(angle) * 0.85f, cosf(angle) * 0.85f};
+            start = std::chrono::steady_clock::now();
+            cpu.render(world, cam, settings);
+            frameTotal += msSince(start);
+        }
+        std::cout << "  frame " << (lit ? "lit  " : "unlit") << " avg " << frameTotal / frames << " ms" << std::endl;
+    }
+    return 0;
+}
@@ -0,0 +1,57 @@
+// Batch line of sight throughput for short and long query segments.
+// usage: bench_line_of_sight [threads]
+
+#include <iostream>
+#include <iomanip>
+#include <chrono>
+#include <cstdlib>
+#include <bitset>
+
+#include "LineOfSight.h"
+#include "BenchUtil.h"
+
+int main(int argc, char **argv)
+{
+    seedRand(12345);
+    int threads = argc > 1 ? atoi(argv[1]) : 0;
+    const int size = 4096, count = 4000000;
+
+    WorldMap world(size, size);
+    for (int x = 0; x < size; x++)
+        for (int y = 0; y < size; y++)
+            if (x == 0 || y == 0 || x == size - 1 || y == size - 1 || nextRand() % 32 == 0)
+                world.set(x, y, 1);
+
+    ThreadPool pool(threads);
+    std::vector<Segment> segments(count);
+    std::vector<uint64_t> visible((count + 63) / 64);
+    std::vector<float> hitDist(count);
+
+    int ranges[] = {8, 32, 128};
+    std::cout << pool.size() << " threads" << std::endl;
+    for (int range : ranges)
+    {
+        for (Segment &s : segments)
+        {
+            s.fromX = range + 0.5f + nextRand() % (size - 2 * range);
+            s.fromY = range + 0.5f + nextRand() % (size - 2 * range);
+            s.toX = s.fromX + (int)(nextRand() % (2 * range)) - range + 0.25f;
+            s.toY = s.fromY + (int)(nextRand() % (2 * range)) - range + 0.25f;
+        }
+
+        for (int withDist = 0; withDist < 2; withDist++)
+        {
+            auto start = std::chrono::steady_clock::now();
+            lineOfSightBatch(world, segments.data(), count, visible.data(), withDist ? hitDist.data() : NULL, &pool);
+            double s = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+            long long clear = 0;
+            for (uint64_t word : visible)
+                clear += std::bitset<64>(word).count();
+            std::cout << "  range " << std::setw(4) << range << (withDist ? "  mask+dist " : "  mask      ")
+                      << std::fixed << std::setprecision(2) << count / s / 1e6 << " Mq/s  "
+                      << count / s / 1e6 / pool.size() << " Mq/s/core  " << 100.0 * clear / count << "% clear" << std::endl;
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,76 @@
+// Map edit batches: time to apply a frame's edits to the CPU map store and
+// coalesce them into GPU buffer ranges (or scatter pairs past maxRanges),
+// the number of buffer uploads and bytes that would be sent against a full
+// re-upload. Both are replayed into a mirror of the GPU buffer and checked
+// against the map.
+// usage: bench_map_edits [size]
+
+#include <iostream>
+#include <iomanip>
+#include <chrono>
+#include <cstdlib>
+
+#include "MapEdits.h"
+#include "BenchUtil.h"
+
+int main(int argc, char **argv)
+{
+    seedRand(2024);
+    int size = argc > 1 ? atoi(argv[1]) : 4096;
+    const int frames = 20;
+
+    WorldMap world(size, size);
+    for (int x = 0; x < size; x++)
+        for (int y = 0; y < size; y++)
+            if (nextRand() % 8 == 0)
+                world.set(x, y, 1);
+    std::vector<int> gpu = world.exportRowMajor();
+
+    MapEdits edits;
+    std::cout << std::fixed << std::setprecision(3);
+    std::cout << "map " << size << "x" << size << "  full upload " << gpu.size() * sizeof(int) / 1024 << " KB" << std::endl;
+
+    const int counts[3] = {1000, 10000, 100000};
+    for (int clustered = 0; clustered < 2; clustered++)
+        for (int c = 0; c < 3; c++)
+        {
+            double total = 0;
+            size_t calls = 0, cells = 0, rects = 0;
+            for (int f = 0; f < frames; f++)
+            {
+                // scattered edits anywhere, or a brush stroke: a square block at a random spot
+                int side = 1;
+                while (side * side < counts[c])
+                    side++;
+                int bx = nextRand() % (size - side), by = nextRand() % (size - side);
+                for (int i = 0; i < counts[c]; i++)
+                {
+                    int x = clustered ? bx + i / side : (int)(nextRand() % size);
+                    int y = clustered ? by + i % side : (int)(nextRand() % size);
+                    if (i % 4 == 3)
+                        edits.setFloor(x, y, (uint8_t)(nextRand() & 3));
+                    else
+                        edits.set(x, y, (uint8_t)(nextRand() % 3));
+                }
+                auto start = std::chrono::steady_clock::now();
+                edits.apply(world);
+                total += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+                calls += edits.scatter.empty() ? edits.ranges.size() : 1;
+                cells += edits.uploadCells() + edits.scatter.size();
+                rects += edits.rects.size();
+
+                for (size_t r = 0; r < edits.ranges.size(); r++)
+                    for (size_t i = edits.ranges[r].first; i < edits.ranges[r].first + edits.ranges[r].count; i++)
+                        gpu[i] = world.exportCell(int(i / size), int(i % size));
+                for (size_t i = 0; i < edits.scatter.size(); i += 2)
+                    gpu[edits.scatter[i]] = edits.scatter[i + 1];
+            }
+            std::cout << "  " << (clustered ? "block    " : "scattered") << std::setw(7) << counts[c] << " edits  apply "
+                      << std::setw(7) << total / frames << " ms  " << std::setw(6) << calls / frames << " uploads  "
+                      << std::setw(8) << std::setprecision(1) << double(cells) * sizeof(int) / frames / 1024 << " KB  "
+                      << std::setw(6) << rects / frames << " rects" << std::setprecision(3) << std::endl;
+        }
+
+    std::cout << "  gpu mirror " << (gpu == world.exportRowMajor() ? "matches" : "DIFFERS from") << " the map" << std::endl;
+    return 0;
+}
@@ -0,0 +1,108 @@
+// Generated maps: generation time per style and size, then the CPU frame
+// cost over a sweep of map size and occlusion density (same seed, so runs
+// are comparable), and lazy chunk generation on a 1M x 1M world, checked
+// against the whole map generation.
+// usage: bench_map_generator [max size] [seed]
+
+#include <iostream>
+#include <iomanip>
+#include <chrono>
+#include <cstdlib>
+
+#include "MapGenerator.h"
+#include "CpuRenderer.h"
+
+static const char *styleNames[4] = {"maze ", "rooms", "arena", "city "};
+
+// nearest open cell to the map centre
+static void openSpot(const WorldMap &world, float &x, float &y)
+{
+    int cx = world.w / 2, cy = world.h / 2;
+    for (int r = 0; r < world.w / 2; r++)
+        for (int dx = -r; dx <= r; dx++)
+            for (int dy = -r; dy <= r; dy++)
+                if (!world.solid(cx + dx, cy + dy)) {
+                    x = cx + dx + 0.5f;
+                    y = cy + dy + 0.5f;
+                    return;
+                }
+    x = cx + 0.5f;
+    y = cy + 0.5f;
+}
+
+int main(int argc, char **argv)
+{
+    int maxSize = argc > 1 ? atoi(argv[1]) : 4096;
+    uint32_t seed = argc > 2 ? (uint32_t)atoi(argv[2]) : 1;
+    const int w = 640, h = 480, frames = 20;
+
+    ThreadPool pool;
+    CpuRenderer cpu(&pool);
+    cpu.resize(w, h);
+    std::vector<unsigned char> tex(64 * 64 * 3, 128);
+    cpu.setTexture(tex.data(), 64, 64, 3);
+    RenderSettings settings;
+    settings.maxDistance = 1e30f;
+    settings.fogStart = 1e30f;
+
+    std::cout << std::fixed << std::setprecision(2);
+    std::cout << "seed " << seed << "  " << pool.size() << " threads" << std::endl;
+
+    WorldMap world;
+    for (int s = 0; s < 4; s++)
+        for (int size = 64; size <= maxSize; size *= 4)
+            for (int d = 0; d < 3; d++)
+            {
+                float density = 0.2f + 0.3f * d;
+                MapGenerator gen((MapStyle)s, seed, size, size, density);
+                auto start = std::chrono::steady_clock::now();
+                gen.generate(world, &pool);
+                double genMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+                size_t solid = 0;
+                for (int x = 0; x < size; x++)
+                    for (int y = 0; y < size; y++)
+                        solid += world.solid(x, y);
+
+                float px, py;
+                openSpot(world, px, py);
+                double total = 0;
+                long long steps = 0;
+                for (int f = 0; f < frames; f++)
+                {
+                    float angle = f * 6.2831853f / frames;
+                    Camera cam = {px, py, cosf(angle), sinf(angle), -sinf(angle) * 0.85f, cosf(angle) * 0.85f};
+                    start = std::chrono::steady_clock::now();
+                    cpu.render(world, cam, settings);
+                    total += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+                    steps += castRayOccupancy(world, px, py, cam.dirX, cam.dirY).steps;
+                }
+                std::cout << "  " << styleNames[s] << " " << std::setw(5) << size << "  density " << density
+                          << "  gen " << std::setw(8) << genMs << " ms  solid " << std::setw(5) << 100.0 * solid / ((double)size * size)
+                          << "%  frame " << std::setw(6) << total / frames << " ms  centre ray " << std::setw(5) << steps / frames
+                          << " steps" << std::endl;
+            }
+
+    // lazy chunks of a huge world, then the same chunk out of a whole map
+    const int huge = 1 << 20, chunk = 64;
+    std::vector<uint8_t> cells((size_t)chunk * chunk), again((size_t)chunk * chunk);
+    for (int s = 0; s < 4; s++)
+    {
+        MapGenerator gen((MapStyle)s, seed, huge, huge);
+        auto start = std::chrono::steady_clock::now();
+        const int chunks = 256;
+        for (int c = 0; c < chunks; c++)
+            gen.fillChunk((c * 7919 % 16384) * chunk, (c * 104729 % 16384) * chunk, chunk, chunk, cells.data());
+        double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+
+        MapGenerator small((MapStyle)s, seed, 1024, 1024);
+        small.generate(world, &pool);
+        bool same = true;
+        small.fillChunk(320, 448, chunk, chunk, again.data());
+        for (int x = 0; x < chunk; x++)
+            for (int y = 0; y < chunk; y++)
+                same &= again[(size_t)x * chunk + y] == world.get(320 + x, 448 + y);
+        std::cout << "  " << styleNames[s] << " 1M x 1M chunks " << std::setw(6) << ns / chunks / 1000 << " us/chunk  "
+                  << std::setw(5) << ns / chunks / (chunk * chunk) << " ns/cell  chunk == whole map: " << (same ? "yes" : "NO") << std::endl;
+    }
+    return 0;
+}
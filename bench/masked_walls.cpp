@@ -0,0 +1,86 @@
+// Frame cost of masked and translucent walls against the same map drawn
+// opaque: rays pass up to maxLayers see-through walls per column and the
+// column is composited back to front.
+// usage: bench_masked_walls [size] [percent of walls see-through]
+
+#include <iostream>
+#include <iomanip>
+#include <chrono>
+#include <cstdlib>
+
+#include "CpuRenderer.h"
+#include "BenchUtil.h"
+
+int main(int argc, char **argv)
+{
+    seedRand(777);
+    int size = argc > 1 ? atoi(argv[1]) : 256;
+    int percent = argc > 2 ? atoi(argv[2]) : 30;
+    const int w = 640, h = 480, frames = 40, texSize = 64;
+
+    // cell 1 opaque, 2 masked, 3 translucent
+    WorldMap world(size, size);
+    for (int x = 0; x < size; x++)
+        for (int y = 0; y < size; y++)
+            if (x == 0 || y == 0 || x == size - 1 || y == size - 1)
+                world.set(x, y, 1);
+            else if (nextRand() % 12 == 0)
+                world.set(x, y, (int)(nextRand() % 100) < percent ? (uint8_t)(2 + nextRand() % 2) : 1);
+
+    TextureAtlas atlas;
+    std::vector<unsigned char> tex((size_t)texSize * texSize * 3);
+    for (int l = 0; l < 2; l++)
+    {
+        for (int i = 0; i < texSize * texSize; i++)
+        {
+            bool hole = l == 1 && (i % texSize) % 8 >= 3;
+            tex[i * 3 + 0] = hole ? 255 : (unsigned char)(nextRand() & 0x7F);
+            tex[i * 3 + 1] = hole ? 0 : (unsigned char)(nextRand() & 0x7F);
+            tex[i * 3 + 2] = hole ? 255 : (unsigned char)(nextRand() & 0x7F);
+        }
+        atlas.add(tex.data(), texSize, texSize, 3);
+    }
+    TextureTable opaque, layered;
+    opaque.setWall(2, 1);
+    layered.setWall(2, 1, MATERIAL_MASKED);
+    layered.setWall(3, 0, MATERIAL_TRANSLUCENT, 128);
+
+    ThreadPool pool;
+    CpuRenderer cpu(&pool);
+    cpu.resize(w, h);
+    cpu.setTextures(atlas, opaque);
+    RenderSettings settings;
+    settings.maxDistance = 64.f;
+    settings.fogStart = 32.f;
+
+    std::cout << std::fixed << std::setprecision(3);
+    std::cout << "map " << size << "x" << size << "  " << percent << "% of walls see-through  "
+              << pool.size() << " threads" << std::endl;
+
+    double opaqueMs = 0;
+    for (int mode = 0; mode < 4; mode++)
+    {
+        cpu.setTextureTable(mode == 0 ? opaque : layered);
+        cpu.maxLayers = mode == 1 ? 1 : (mode == 2 ? 4 : 8);
+        double total = 0;
+        long long layers = 0;
+        for (int f = 0; f < frames; f++)
+        {
+            float angle = f * 6.2831853f / frames;
+            Camera cam = {size / 2 + 0.5f, size / 2 + 0.5f, cosf(angle), sinf(angle), -sinf(angle) * 0.85f, cosf(angle) * 0.85f};
+            auto start = std::chrono::steady_clock::now();
+            cpu.render(world, cam, settings);
+            total += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+            layers += cpu.layersDrawn;
+        }
+        if (mode == 0) {
+            opaqueMs = total / frames;
+            std::cout << "  opaque           avg " << opaqueMs << " ms/frame" << std::endl;
+        } else {
+            std::cout << "  layers up to " << cpu.maxLayers << (cpu.maxLayers < 10 ? " " : "") << " avg " << total / frames << " ms/frame  "
+                      << std::setprecision(2) << double(layers) / frames / w << " layers/column  +"
+                      << std::setprecision(1) << 100.0 * (total / frames - opaqueMs) / opaqueMs << "%" << std::setprecision(3) << std::endl;
+        }
+    }
+    return 0;
+}
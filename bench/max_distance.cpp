@@ -0,0 +1,66 @@
+// Frame cost on a huge open map with and without a ray distance limit.
+// usage: bench_max_distance [size] [threads]   (default 16384)
+
+#include <iostream>
+#include <iomanip>
+#include <chrono>
+#include <cstdlib>
+
+#include "CpuRenderer.h"
+
+int main(int argc, char **argv)
+{
+    int size = argc > 1 ? atoi(argv[1]) : 16384;
+    int threads = argc > 2 ? atoi(argv[2]) : 0;
+    const int w = 640, h = 480, frames = 20;
+
+    // walls only on the border, nothing in between to stop the rays
+    WorldMap world(size, size);
+    for (int i = 0; i < size; i++)
+    {
+        world.set(i, 0, 1);
+        world.set(i, size - 1, 1);
+        world.set(0, i, 1);
+        world.set(size - 1, i, 1);
+    }
+
+    std::vector<unsigned char> tex(64 * 64 * 3, 128);
+    ThreadPool pool(threads);
+    CpuRenderer cpu(&pool);
+    cpu.resize(w, h);
+    cpu.setTexture(tex.data(), 64, 64, 3);
+
+    float limits[] = {1e30f, 1024.f, 256.f, 64.f, 16.f};
+    std::cout << "open map " << size << "x" << size << ", " << pool.size() << " threads" << std::endl;
+    for (float limit : limits)
+    {
+        RenderSettings settings;
+        settings.maxDistance = limit;
+        settings.fogStart = limit * 0.75f;
+
+        double total = 0, worst = 0;
+        for (int f = 0; f < frames; f++)
+        {
+            float angle = f * 6.2831853f / frames;
+            Camera cam = {size / 2 + 0.5f, size / 2 + 0.5f, cosf(angle), sinf(angle), -sinf(angle) * 0.85f, cosf(angle) * 0.85f};
+            auto start = std::chrono::steady_clock::now();
+            cpu.render(world, cam, settings);
+            double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+            total += ms;
+            if (ms > worst)
+                worst = ms;
+        }
+
+        std::cout << std::fixed << std::setprecision(2);
+        if (limit > 1e20f)
+            std::cout << "  unlimited ";
+        else
+            std::cout << "  max " << std::setw(6) << (int)limit;
+        // |rayDirX| + |rayDirY| <= sqrt(2) * |dir + plane| = 1.86 for this camera
+        std::cout << "  avg " << std::setw(8) << total / frames << " ms  worst " << std::setw(8) << worst << " ms";
+        if (limit < 1e20f)
+            std::cout << "  step bound/ray " << (int)(limit * 1.86f) + 2;
+        std::cout << std::endl;
+    }
+    return 0;
+}
@@ -0,0 +1,135 @@
+// Float precision far from the world origin. Rays from positions around
+// 2^10 .. 2^24 cells on a generated arena are traced three ways: a double
+// reference, the float traversal on absolute coordinates, and the engine's
+// own float traversal (castRayOccupancy) on a streamed view, with the
+// camera as a WorldPos rebased to the view origin. Reports the worst wall
+// distance and wallX error against the reference, and how many rays land
+// on another cell or another texel column (64 wide texture).
+// usage: bench_origin_rebase [rays per magnitude] [seed]
+
+#include <iostream>
+#include <iomanip>
+#include <cmath>
+#include <cstdlib>
+#include <random>
+
+#include "ChunkStream.h"
+#include "MapGenerator.h"
+#include "Dda.h"
+
+struct Trace
+{
+    double dist, wallX; // wallX in [0, 1)
+    int64_t mapX, mapY;
+    bool hit;
+};
+
+// the float engine's DDA, in T, on absolute coordinates
+template <typename T>
+static Trace trace(const MapGenerator &gen, T posX, T posY, T dirX, T dirY)
+{
+    Trace t = {0, 0, 0, 0, false};
+    int64_t mapX = (int64_t)std::floor(posX), mapY = (int64_t)std::floor(posY);
+    T deltaX = dirX == 0 ? T(1e30) : std::fabs(1 / dirX);
+    T deltaY = dirY == 0 ? T(1e30) : std::fabs(1 / dirY);
+    int stepX = dirX < 0 ? -1 : 1, stepY = dirY < 0 ? -1 : 1;
+    T sideX = dirX < 0 ? (posX - (T)mapX) * deltaX : ((T)mapX + 1 - posX) * deltaX;
+    T sideY = dirY < 0 ? (posY - (T)mapY) * deltaY : ((T)mapY + 1 - posY) * deltaY;
+    int side = 0;
+    for (int i = 0; i < 400; i++)
+    {
+        if (sideX < sideY) {
+            sideX += deltaX;
+            mapX += stepX;
+            side = 0;
+        } else {
+            sideY += deltaY;
+            mapY += stepY;
+            side = 1;
+        }
+        if (gen.cell((int)mapX, (int)mapY)) {
+            T dist = side == 0 ? sideX - deltaX : sideY - deltaY;
+            T wallX = side == 0 ? posY + dist * dirY : posX + dist * dirX;
+            t.dist = dist;
+            t.wallX = wallX - std::floor(wallX);
+            t.mapX = mapX;
+            t.mapY = mapY;
+            t.hit = true;
+            break;
+        }
+    }
+    return t;
+}
+
+struct Errors
+{
+    double dist = 0, wallX = 0;
+    int cells = 0, texels = 0, rays = 0;
+
+    void add(const Trace &ref, const Trace &t)
+    {
+        rays++;
+        if (!t.hit || t.mapX != ref.mapX || t.mapY != ref.mapY) {
+            cells++;
+            return;
+        }
+        dist = std::max(dist, std::fabs(t.dist - ref.dist));
+        wallX = std::max(wallX, std::fabs(t.wallX - ref.wallX));
+        texels += int(t.wallX * 64) != int(ref.wallX * 64);
+    }
+};
+
+int main(int argc, char **argv)
+{
+    int rays = argc > 1 ? atoi(argv[1]) : 2000;
+    uint32_t seed = argc > 2 ? (uint32_t)atoi(argv[2]) : 1;
+    const int size = (1 << 25) + 1024;
+    MapGenerator gen(MAP_STYLE_ARENA, seed, size, size, 0.6f);
+    std::mt19937 rng(seed);
+    std::uniform_real_distribution<double> unit(0.0, 1.0);
+
+    std::cout << std::scientific << std::setprecision(2);
+    for (int e = 10; e <= 24; e += 2)
+    {
+        int64_t centre = (int64_t)1 << e;
+        ChunkStream stream([&](int64_t cx, int64_t cy, uint8_t *out) {
+            gen.fillChunk((int)(cx * STREAM_CHUNK), (int)(cy * STREAM_CHUNK), STREAM_CHUNK, STREAM_CHUNK, out);
+        }, size, size);
+        stream.update(centre, centre, 0.f, 0.f);
+        while (stream.inFlight() > 0 || stream.frameMisses > 0)
+        {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            stream.update(centre, centre, 0.f, 0.f);
+        }
+
+        Errors absolute, rebased;
+        while (rebased.rays < rays)
+        {
+            // open start cells within 200 of the centre, the view reaches 512
+            int64_t cx = centre - 200 + (int64_t)(unit(rng) * 400), cy = centre - 200 + (int64_t)(unit(rng) * 400);
+            if (gen.cell((int)cx, (int)cy))
+                continue;
+            double fx = unit(rng), fy = unit(rng), angle = unit(rng) * 6.283185307179586;
+            double dirX = std::cos(angle), dirY = std::sin(angle);
+
+            Trace ref = trace<double>(gen, (double)cx + fx, (double)cy + fy, dirX, dirY);
+            if (!ref.hit)
+                continue;
+            absolute.add(ref, trace<float>(gen, (float)((double)cx + fx), (float)((double)cy + fy), (float)dirX, (float)dirY));
+
+            WorldPos pos(cx, cy, (float)fx, (float)fy);
+            float px = stream.viewX(pos), py = stream.viewY(pos);
+            RayHit hit = castRayOccupancy(stream.view, px, py, (float)dirX, (float)dirY);
+            float wallX = hit.side == 0 ? py + hit.perpWallDist * (float)dirY : px + hit.perpWallDist * (float)dirX;
+            Trace t = {hit.perpWallDist, wallX - floorf(wallX), hit.mapX + stream.viewCellX(), hit.mapY + stream.viewCellY(), hit.cell != 0};
+            rebased.add(ref, t);
+        }
+        std::cout << "  2^" << std::setw(2) << e << "  absolute float: dist " << absolute.dist << "  wallX " << absolute.wallX
+                  << std::fixed << std::setprecision(2) << "  wrong cell " << std::setw(6) << 100.0 * absolute.cells / absolute.rays
+                  << "%  wrong texel " << std::setw(6) << 100.0 * absolute.texels / absolute.rays << "%" << std::scientific
+                  << "   rebased: dist " << rebased.dist << "  wallX " << rebased.wallX << std::fixed
+                  << "  wrong cell " << std::setw(5) << 100.0 * rebased.cells / rebased.rays << "%  wrong texel " << std::setw(5)
+                  << 100.0 * rebased.texels / rebased.rays << "%" << std::scientific << std::endl;
+    }
+    return 0;
+}
@@ -0,0 +1,92 @@
+// RGBA vs palette + colormap shading on the CPU engine, with fog and light
+// maps on so every pixel goes through both shading steps.
+// usage: bench_palette [size] [texture size]
+
+#include <iostream>
+#include <iomanip>
+#include <chrono>
+#include <cstdlib>
+
+#include "CpuRenderer.h"
+#include "BenchUtil.h"
+
+double msSince(std::chrono::steady_clock::time_point start)
+{
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+int main(int argc, char **argv)
+{
+    seedRand(77);
+    int size = argc > 1 ? atoi(argv[1]) : 256;
+    int texSize = argc > 2 ? atoi(argv[2]) : 256;
+    const int w = 640, h = 480, frames = 40;
+
+    WorldMap world(size, size);
+    for (int x = 0; x < size; x++)
+        for (int y = 0; y < size; y++)
+            if (x == 0 || y == 0 || x == size - 1 || y == size - 1 || nextRand() % 12 == 0)
+                world.set(x, y, 1);
+
+    // smooth gradients plus noise, so the quantizer has real work to do
+    std::vector<unsigned char> tex((size_t)texSize * texSize * 3);
+    for (int y = 0; y < texSize; y++)
+        for (int x = 0; x < texSize; x++)
+        {
+            unsigned char *p = &tex[((size_t)y * texSize + x) * 3];
+            p[0] = (unsigned char)(x * 255 / texSize);
+            p[1] = (unsigned char)(y * 255 / texSize);
+            p[2] = (unsigned char)(128 + (nextRand() & 63));
+        }
+
+    ThreadPool pool;
+    LightMap lights;
+    for (int i = 0; i < size * size / 64; i++)
+        lights.addLight({1 + (nextRand() % (size - 2)) + 0.5f, 1 + (nextRand() % (size - 2)) + 0.5f, 6.f});
+    lights.build(world, &pool);
+
+    CpuRenderer cpu(&pool);
+    cpu.resize(w, h);
+    auto start = std::chrono::steady_clock::now();
+    cpu.setTexture(tex.data(), texSize, texSize, 3);
+    double load = msSince(start);
+    cpu.lightMap = &lights;
+
+    RenderSettings settings;
+    settings.maxDistance = 24.f;
+    settings.fogStart = 4.f;
+    settings.fogColor[0] = 0.3f;
+
+    std::cout << std::fixed << std::setprecision(3);
+    std::cout << "texture " << texSize << "x" << texSize << "  " << cpu.palette.count << " palette colours  quantize+load "
+              << load << " ms" << std::endl;
+    std::cout << "  texel memory: RGBA32F " << (size_t)texSize * texSize * 16 / 1024 << " KB  RGBA8 "
+              << cpu.texture.size() * 4 / 1024 << " KB  indexed " << cpu.textureIndexed.size() / 1024 << " KB" << std::endl;
+
+    double rgbaTotal = 0;
+    for (int mode = 0; mode < 2; mode++)
+    {
+        cpu.paletted = mode == 1;
+        if (cpu.paletted) {
+            start = std::chrono::steady_clock::now();
+            cpu.render(world, {1.5f, 1.5f, 1, 0, 0, 0.85f}, settings);
+            std::cout << "  colormap " << COLORMAP_LIGHTS << "x" << COLORMAP_FOGS << " levels, first frame with build "
+                      << msSince(start) << " ms" << std::endl;
+        }
+        double total = 0;
+        for (int f = 0; f < frames; f++)
+        {
+            float angle = f * 6.2831853f / frames;
+            Camera cam = {size / 2 + 0.5f, size / 2 + 0.5f, cosf(angle), sinf(angle), -sinf(angle) * 0.85f, cosf(angle) * 0.85f};
+            start = std::chrono::steady_clock::now();
+            cpu.render(world, cam, settings);
+            total += msSince(start);
+        }
+        std::cout << "  " << (mode ? "paletted" : "rgba    ") << " avg " << total / frames << " ms/frame";
+        if (mode)
+            std::cout << "  (" << std::setprecision(2) << rgbaTotal / total << "x)";
+        std::cout << std::endl;
+        rgbaTotal = total;
+    }
+    return 0;
+}
@@ -0,0 +1,84 @@
+// Sprite pass cost against sprite count on a walled map with an open plaza
+// in the middle. "in view" sprites stand in the plaza inside the camera's
+// field of view, so nearly all of them are drawn; "scattered" ones are spread
+// over the map and most are dropped behind walls by the depth buffer test.
+// usage: bench_sprites [threads]
+
+#include <iostream>
+#include <iomanip>
+#include <chrono>
+#include <cstdlib>
+
+#include "Sprites.h"
+#include "BenchUtil.h"
+
+int main(int argc, char **argv)
+{
+    seedRand(12345);
+    int threads = argc > 1 ? atoi(argv[1]) : 0;
+    const int size = 512, w = 640, h = 480, frames = 20, plazaRadius = 40;
+
+    WorldMap world(size, size);
+    for (int x = 0; x < size; x++)
+        for (int y = 0; y < size; y++)
+        {
+            int dx = x - size / 2, dy = y - size / 2;
+            bool plaza = dx * dx + dy * dy < plazaRadius * plazaRadius;
+            if (x == 0 || y == 0 || x == size - 1 || y == size - 1 || (!plaza && nextRand() % 24 == 0))
+                world.set(x, y, 1);
+        }
+
+    std::vector<unsigned char> tex(64 * 64 * 3, 200);
+    ThreadPool pool(threads);
+    CpuRenderer cpu(&pool);
+    cpu.resize(w, h);
+    cpu.setTexture(tex.data(), 64, 64, 3);
+    SpriteRenderer spriteRenderer(&pool);
+    spriteRenderer.addTexture(tex.data(), 64, 64, 3);
+
+    RenderSettings settings;
+    settings.maxDistance = 1e30f;
+    settings.fogStart = 1e30f;
+
+    int counts[] = {1000, 10000, 100000, 1000000};
+    std::cout << pool.size() << " threads" << std::endl;
+    for (int count : counts)
+        for (int scattered = 0; scattered < 2; scattered++)
+        {
+            // in view: within 30 degrees of +x, the camera sweeps 10 either way
+            // of it and sees 40
+            std::vector<Sprite> sprites(count);
+            for (Sprite &s : sprites)
+            {
+                if (scattered) {
+                    s.x = 1.5f + nextRand() % (size - 3);
+                    s.y = 1.5f + nextRand() % (size - 3);
+                } else {
+                    float a = ((nextRand() % 2001) / 1000.f - 1.f) * 0.52f;
+                    float d = 6.f + (nextRand() % 1000) / 1000.f * (plazaRadius - 8);
+                    s.x = size / 2 + 0.5f + cosf(a) * d;
+                    s.y = size / 2 + 0.5f + sinf(a) * d;
+                }
+                s.texture = 0;
+            }
+
+            // every in view sprite is drawn, fewer frames for the big counts
+            int runFrames = !scattered && count >= 100000 ? 4 : frames;
+            double ms = 0;
+            long long visible = 0;
+            for (int f = 0; f < runFrames; f++)
+            {
+                float angle = scattered ? f * 6.2831853f / runFrames : (f * 2.f / (runFrames - 1) - 1.f) * 0.17f;
+                Camera cam = {size / 2 + 0.5f, size / 2 + 0.5f, cosf(angle), sinf(angle), -sinf(angle) * 0.85f, cosf(angle) * 0.85f};
+                cpu.render(world, cam, settings);
+                auto start = std::chrono::steady_clock::now();
+                spriteRenderer.render(cpu, cam, sprites);
+                ms += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+                visible += spriteRenderer.visible;
+            }
+            std::cout << std::setw(8) << count << " sprites " << (scattered ? "scattered" : "in view  ") << std::fixed
+                      << std::setprecision(3) << std::setw(9) << ms / runFrames << " ms/frame  " << std::setw(8) << visible / runFrames
+                      << " drawn" << std::endl;
+        }
+    return 0;
+}
@@ -0,0 +1,74 @@
+// Frame cost with one texture for everything vs a 256 layer atlas where
+// every cell value and floor kind picks its own wall, floor and ceiling.
+// usage: bench_texture_atlas [size] [layers]
+
+#include <iostream>
+#include <iomanip>
+#include <chrono>
+#include <cstdlib>
+
+#include "CpuRenderer.h"
+#include "BenchUtil.h"
+
+int main(int argc, char **argv)
+{
+    seedRand(99);
+    int size = argc > 1 ? atoi(argv[1]) : 256;
+    int layers = argc > 2 ? atoi(argv[2]) : 256;
+    const int w = 640, h = 480, frames = 40, texSize = 64;
+
+    WorldMap world(size, size);
+    for (int x = 0; x < size; x++)
+        for (int y = 0; y < size; y++)
+        {
+            if (x == 0 || y == 0 || x == size - 1 || y == size - 1 || nextRand() % 12 == 0)
+                world.set(x, y, (uint8_t)(1 + nextRand() % 255));
+            world.setFloor(x, y, (uint8_t)(nextRand() % 256));
+        }
+
+    TextureAtlas atlas;
+    TextureTable table;
+    std::vector<unsigned char> tex((size_t)texSize * texSize * 3);
+    for (int l = 0; l < layers; l++)
+    {
+        for (size_t i = 0; i < tex.size(); i++)
+            tex[i] = (unsigned char)(nextRand() & 0xFF);
+        atlas.add(tex.data(), texSize, texSize, 3);
+    }
+    for (int c = 0; c < 256; c++)
+    {
+        table.setWall((uint8_t)c, (uint16_t)(c % layers));
+        table.setFloor((uint8_t)c, (uint16_t)((c * 7) % layers), (uint16_t)((c * 13) % layers));
+    }
+
+    ThreadPool pool;
+    CpuRenderer cpu(&pool);
+    cpu.resize(w, h);
+    RenderSettings settings;
+
+    std::cout << std::fixed << std::setprecision(3);
+    std::cout << "map " << size << "x" << size << "  " << pool.size() << " threads" << std::endl;
+    for (int mode = 0; mode < 4; mode++)
+    {
+        bool many = mode & 1;
+        cpu.paletted = mode >= 2;
+        if (many)
+            cpu.setTextures(atlas, table);
+        else
+            cpu.setTexture(tex.data(), texSize, texSize, 3);
+
+        double total = 0;
+        for (int f = 0; f < frames; f++)
+        {
+            float angle = f * 6.2831853f / frames;
+            Camera cam = {size / 2 + 0.5f, size / 2 + 0.5f, cosf(angle), sinf(angle), -sinf(angle) * 0.85f, cosf(angle) * 0.85f};
+            auto start = std::chrono::steady_clock::now();
+            cpu.render(world, cam, settings);
+            total += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        }
+        std::cout << "  " << (cpu.paletted ? "paletted " : "rgba     ") << std::setw(3) << cpu.texLayers << " layers  "
+                  << std::setw(6) << cpu.texture.size() * 4 / 1024 << " KB rgba  " << std::setw(5) << cpu.textureIndexed.size() / 1024
+                  << " KB indexed  avg " << total / frames << " ms/frame" << std::endl;
+    }
+    return 0;
+}
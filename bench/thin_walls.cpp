@@ -0,0 +1,75 @@
+// Cost of the thin wall plane test: the same map rendered with a share of
+// its walls as full cells and as doors at random open fractions (rays pass
+// the open part), plus the cost of opening every door, which only touches
+// one byte per cell.
+// usage: bench_thin_walls [size] [percent of walls that are doors]
+
+#include <iostream>
+#include <iomanip>
+#include <chrono>
+#include <cstdlib>
+
+#include "CpuRenderer.h"
+#include "BenchUtil.h"
+
+int main(int argc, char **argv)
+{
+    seedRand(31337);
+    int size = argc > 1 ? atoi(argv[1]) : 256;
+    int percent = argc > 2 ? atoi(argv[2]) : 30;
+    const int w = 640, h = 480, frames = 40;
+
+    // 2 and 3 are doors across x and across y when thin walls are on
+    WorldMap world(size, size);
+    std::vector<std::pair<int, int>> doors;
+    for (int x = 0; x < size; x++)
+        for (int y = 0; y < size; y++)
+            if (x == 0 || y == 0 || x == size - 1 || y == size - 1) {
+                world.set(x, y, 1);
+            } else if (nextRand() % 12 == 0) {
+                bool door = (int)(nextRand() % 100) < percent;
+                world.set(x, y, door ? (uint8_t)(2 + nextRand() % 2) : 1);
+                if (door) {
+                    world.setOpen(x, y, (nextRand() % 256) / 255.f);
+                    doors.push_back(std::make_pair(x, y));
+                }
+            }
+
+    std::vector<unsigned char> tex(64 * 64 * 3);
+    for (size_t i = 0; i < tex.size(); i++)
+        tex[i] = (unsigned char)(nextRand() & 0xFF);
+
+    ThreadPool pool;
+    CpuRenderer cpu(&pool);
+    cpu.resize(w, h);
+    cpu.setTexture(tex.data(), 64, 64, 3);
+    RenderSettings settings;
+    settings.maxDistance = 64.f;
+    settings.fogStart = 32.f;
+
+    std::cout << std::fixed << std::setprecision(3);
+    std::cout << "map " << size << "x" << size << "  " << doors.size() << " doors  " << pool.size() << " threads" << std::endl;
+    for (int mode = 0; mode < 2; mode++)
+    {
+        world.setThin(2, mode ? THIN_X : THIN_NONE);
+        world.setThin(3, mode ? THIN_Y : THIN_NONE);
+        double total = 0;
+        for (int f = 0; f < frames; f++)
+        {
+            float angle = f * 6.2831853f / frames;
+            Camera cam = {size / 2 + 0.5f, size / 2 + 0.5f, cosf(angle), sinf(angle), -sinf(angle) * 0.85f, cosf(angle) * 0.85f};
+            auto start = std::chrono::steady_clock::now();
+            cpu.render(world, cam, settings);
+            total += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        }
+        std::cout << "  " << (mode ? "thin doors " : "full cells ") << " avg " << total / frames << " ms/frame  "
+                  << std::setprecision(1) << total / frames * 1e6 / w << " ns/column" << std::setprecision(3) << std::endl;
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < doors.size(); i++)
+        world.setOpen(doors[i].first, doors[i].second, 1.f);
+    double openUs = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count();
+    std::cout << "  opening every door " << openUs << " us, " << doors.size() * sizeof(int) << " bytes of map buffer to upload" << std::endl;
+    return 0;
+}
@@ -0,0 +1,163 @@
+// Visibility polygons: contains() against a brute force DDA ray to each
+// sample, cached against uncached get(), and which entries a map edit keeps
+// (a kept entry must still cover what a fresh polygon covers).
+// usage: bench_visibility [size] [origins] [samples per origin]
+
+#include <iostream>
+#include <iomanip>
+#include <chrono>
+#include <cstdlib>
+#include <vector>
+
+#include "Visibility.h"
+#include "BenchUtil.h"
+
+double msSince(std::chrono::steady_clock::time_point start)
+{
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+// distance from (px, py) to the polygon's outline
+float edgeDistance(const VisibilityPolygon &poly, float px, float py)
+{
+    float best = 1e30f;
+    size_t n = poly.xs.size();
+    for (size_t i = 0, j = n - 1; i < n; j = i++)
+    {
+        float ex = poly.xs[i] - poly.xs[j], ey = poly.ys[i] - poly.ys[j];
+        float len = ex * ex + ey * ey;
+        float t = len > 0 ? ((px - poly.xs[j]) * ex + (py - poly.ys[j]) * ey) / len : 0.f;
+        t = t < 0 ? 0 : (t > 1 ? 1 : t);
+        float dx = poly.xs[j] + t * ex - px, dy = poly.ys[j] + t * ey - py;
+        best = std::min(best, sqrtf(dx * dx + dy * dy));
+    }
+    return best;
+}
+
+// the two cover the same area, up to points on either outline; a far edit
+// can add corner rays, so the vertex lists may differ
+bool sameRegion(const VisibilityPolygon &a, const VisibilityPolygon &b, float radius)
+{
+    for (int s = 0; s < 256; s++)
+    {
+        float angle = (nextRand() % 36000) * 6.2831853f / 36000;
+        float dist = (nextRand() % 10000) / 10000.f * radius;
+        float px = a.originX + cosf(angle) * dist, py = a.originY + sinf(angle) * dist;
+        if (a.contains(px, py) != b.contains(px, py) && edgeDistance(a, px, py) > 0.01f && edgeDistance(b, px, py) > 0.01f)
+            return false;
+    }
+    return true;
+}
+
+int main(int argc, char **argv)
+{
+    seedRand(4242);
+    int size = argc > 1 ? atoi(argv[1]) : 256;
+    int originCount = argc > 2 ? atoi(argv[2]) : 400;
+    int samples = argc > 3 ? atoi(argv[3]) : 500;
+
+    WorldMap world(size, size);
+    for (int x = 0; x < size; x++)
+        for (int y = 0; y < size; y++)
+            if (x == 0 || y == 0 || x == size - 1 || y == size - 1 || nextRand() % 12 == 0)
+                world.set(x, y, 1);
+
+    std::vector<int> origins;
+    while ((int)origins.size() < originCount * 2)
+    {
+        int x = 1 + nextRand() % (size - 2), y = 1 + nextRand() % (size - 2);
+        if (!world.solid(x, y)) {
+            origins.push_back(x);
+            origins.push_back(y);
+        }
+    }
+
+    VisibilityCache cache;
+    cache.maxEntries = originCount * 2;
+    float radius = cache.radius;
+    std::cout << std::fixed << std::setprecision(3);
+    std::cout << "map " << size << "x" << size << "  radius " << radius << "  " << originCount << " origins" << std::endl;
+
+    // samples inside the ring's chords only, so a miss is a real disagreement
+    long long inside = 0, mismatches = 0, nearEdge = 0;
+    for (int o = 0; o < originCount; o++)
+    {
+        std::shared_ptr<const VisibilityPolygon> poly = cache.get(world, origins[o * 2], origins[o * 2 + 1]);
+        for (int s = 0; s < samples; s++)
+        {
+            float angle = (nextRand() % 36000) * 6.2831853f / 36000;
+            float dist = 0.01f + (nextRand() % 10000) / 10000.f * radius * 0.95f;
+            float dirX = cosf(angle), dirY = sinf(angle);
+            float px = poly->originX + dirX * dist, py = poly->originY + dirY * dist;
+            RayHit hit = castRayOccupancy(world, poly->originX, poly->originY, dirX, dirY, dist);
+            bool seen = hit.cell == 0;
+            bool in = poly->contains(px, py);
+            inside += in;
+            if (in != seen) {
+                if (edgeDistance(*poly, px, py) < 0.01f)
+                    nearEdge++;
+                else
+                    mismatches++;
+            }
+        }
+    }
+    std::cout << "  contains " << (long long)originCount * samples << " samples  " << inside << " inside  " << mismatches
+              << " disagree with the DDA (" << nearEdge << " more within 0.01 of an edge)" << std::endl;
+
+    // uncached, then a cold and a warm pass through the cache
+    VisibilityPolygon scratch;
+    auto start = std::chrono::steady_clock::now();
+    for (int o = 0; o < originCount; o++)
+        computeVisibility(world, origins[o * 2] + 0.5f, origins[o * 2 + 1] + 0.5f, radius, scratch);
+    double uncached = msSince(start);
+    cache.clear();
+    start = std::chrono::steady_clock::now();
+    for (int o = 0; o < originCount; o++)
+        cache.get(world, origins[o * 2], origins[o * 2 + 1]);
+    double cold = msSince(start);
+    start = std::chrono::steady_clock::now();
+    for (int o = 0; o < originCount; o++)
+        cache.get(world, origins[o * 2], origins[o * 2 + 1]);
+    double warm = msSince(start);
+    std::cout << "  get uncached " << uncached * 1000 / originCount << " us  cold " << cold * 1000 / originCount
+              << " us  warm " << warm * 1000 / originCount << " us" << std::endl;
+
+    // single cell edits: an edit outside an entry's bounding box must keep
+    // it, and a kept entry must cover what a polygon computed after the
+    // edit covers
+    std::vector<std::shared_ptr<const VisibilityPolygon>> held(originCount);
+    for (int o = 0; o < originCount; o++)
+        held[o] = cache.get(world, origins[o * 2], origins[o * 2 + 1]);
+    long long kept = 0, dropped = 0, wrongDrops = 0, stale = 0;
+    const int edits = 50;
+    for (int e = 0; e < edits; e++)
+    {
+        int x = 1 + nextRand() % (size - 2), y = 1 + nextRand() % (size - 2);
+        world.set(x, y, world.solid(x, y) ? 0 : 1);
+        cache.onCellsChanged(x, y, x, y);
+        for (int o = 0; o < originCount; o++)
+        {
+            std::shared_ptr<const VisibilityPolygon> now = cache.get(world, origins[o * 2], origins[o * 2 + 1]);
+            const VisibilityPolygon &was = *held[o];
+            bool outside = x < was.minX || x > was.maxX || y < was.minY || y > was.maxY;
+            float dx = x + 0.5f - now->originX, dy = y + 0.5f - now->originY;
+            if (now == held[o]) {
+                kept++;
+                // edits out of reach of the origin cannot matter, check the rest
+                if (dx * dx + dy * dy > (radius + 2) * (radius + 2))
+                    continue;
+                computeVisibility(world, origins[o * 2] + 0.5f, origins[o * 2 + 1] + 0.5f, radius, scratch);
+                if (!sameRegion(*now, scratch, radius))
+                    stale++;
+            } else {
+                dropped++;
+                if (outside)
+                    wrongDrops++;
+            }
+            held[o] = now;
+        }
+    }
+    std::cout << "  " << edits << " cell edits  " << kept << " entries kept  " << dropped << " dropped  " << wrongDrops
+              << " dropped from outside their box  " << stale << " kept but stale" << std::endl;
+    return 0;
+}
@@ -0,0 +1,122 @@
+// Cost of collecting the VisibleSet during CPU rendering: ns/column with and
+// without it, on one thread and on N. Every few frames the set is checked
+// against the cells each column's castRayOccupancy walk enters (collected
+// one by one) and its faces against the hit faces of those walks, which
+// must come out sorted with no duplicates.
+// usage: bench_visible_set [threads]
+
+#include <iostream>
+#include <iomanip>
+#include <chrono>
+#include <cstdlib>
+#include <set>
+
+#include "CpuRenderer.h"
+#include "BenchUtil.h"
+
+// plain visitor: every entered cell, runs expanded
+struct CellList
+{
+    const WorldMap *world;
+    std::vector<uint8_t> *seen;
+
+    void cell(long long bit)
+    {
+        int x = int(bit / (long long)world->occRowBits), y = int(bit % (long long)world->occRowBits);
+        (*seen)[(size_t)x * world->h + y] = 1;
+    }
+    void run(long long bit, int n, int stepY)
+    {
+        for (int i = 1; i <= n; i++)
+            cell(bit + i * stepY);
+    }
+    bool through(int mapX, int mapY, int side, float dist, uint8_t cell) { (void)mapX; (void)mapY; (void)side; (void)dist; (void)cell; return false; }
+};
+
+Camera cameraAt(int f, int size)
+{
+    float angle = f * 0.0314f;
+    return {size / 2 + 0.37f + f * 0.05f, size / 2 + 0.61f, cosf(angle), sinf(angle), -sinf(angle) * 0.85f, cosf(angle) * 0.85f};
+}
+
+// cells that differ from the reference, faces out of order or repeated, and
+// whether the face list differs from the reference set
+void checkFrame(const WorldMap &world, const Camera &cam, const RenderSettings &settings, int w, const VisibleSet &set,
+                long long &wrongCells, long long &repeated, long long &wrongFaces)
+{
+    std::vector<uint8_t> seen((size_t)world.w * world.h, 0);
+    CellList list = {&world, &seen};
+    std::set<VisibleFace> faces;
+    for (int x = 0; x < w; x++)
+    {
+        float cameraX = 2 * x / float(w) - 1;
+        float rayDirX = cam.dirX + cam.planeX * cameraX;
+        float rayDirY = cam.dirY + cam.planeY * cameraX;
+        RayHit hit = castRayOccupancyVisit(world, cam.posX, cam.posY, rayDirX, rayDirY, settings.maxDistance, list);
+        if (hit.cell)
+            faces.insert({hit.mapX, hit.mapY, hit.side * 2 + ((hit.side == 0 ? rayDirX : rayDirY) >= 0 ? 0 : 1)});
+    }
+
+    for (int x = 0; x < world.w; x++)
+        for (int y = 0; y < world.h; y++)
+            wrongCells += set.visible(x, y) != (seen[(size_t)x * world.h + y] != 0);
+    for (size_t i = 1; i < set.faces.size(); i++)
+        repeated += !(set.faces[i - 1] < set.faces[i]);
+    if (set.faces.size() != faces.size() || !std::equal(set.faces.begin(), set.faces.end(), faces.begin()))
+        wrongFaces++;
+}
+
+int main(int argc, char **argv)
+{
+    seedRand(12345);
+    int threads = argc > 1 ? atoi(argv[1]) : 0;
+    const int size = 1024, w = 640, h = 480, frames = 200;
+
+    WorldMap world(size, size);
+    for (int x = 0; x < size; x++)
+        for (int y = 0; y < size; y++)
+            if (x == 0 || y == 0 || x == size - 1 || y == size - 1 || nextRand() % 64 == 0)
+                world.set(x, y, 1);
+
+    std::vector<unsigned char> tex(64 * 64 * 3);
+    for (size_t i = 0; i < tex.size(); i++)
+        tex[i] = (unsigned char)(i * 7);
+
+    RenderSettings settings;
+    ThreadPool single(1), pool(threads);
+    ThreadPool *pools[2] = {&single, &pool};
+    std::cout << std::fixed << std::setprecision(1);
+    for (ThreadPool *p : pools)
+    {
+        CpuRenderer cpu(p);
+        cpu.resize(w, h);
+        cpu.setTexture(tex.data(), 64, 64, 3);
+        VisibleSet set;
+        double ns[2] = {0, 0};
+        long long wrongCells = 0, repeated = 0, wrongFaces = 0, faceCount = 0;
+        int checked = 0;
+        for (int collect = 0; collect < 2; collect++)
+        {
+            cpu.visibleSet = collect ? &set : NULL;
+            for (int f = 0; f < frames; f++)
+            {
+                Camera cam = cameraAt(f, size);
+                auto start = std::chrono::steady_clock::now();
+                cpu.render(world, cam, settings);
+                ns[collect] += std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+                if (collect && f % 20 == 0)
+                {
+                    checkFrame(world, cam, settings, w, set, wrongCells, repeated, wrongFaces);
+                    faceCount += set.faces.size();
+                    checked++;
+                }
+            }
+        }
+        std::cout << p->size() << " threads  " << ns[0] / ((double)frames * w) << " ns/column without  "
+                  << ns[1] / ((double)frames * w) << " with the set" << std::endl;
+        std::cout << "  " << checked << " frames checked  " << wrongCells << " cells differ from the walks  "
+                  << faceCount / checked << " faces per frame  " << repeated << " repeated  " << wrongFaces
+                  << " frames with other faces" << std::endl;
+    }
+    return 0;
+}
@@ -0,0 +1,56 @@
+// Heightmap terrain engine: ns per screen column and heightmap samples per
+// column on a 4096x4096 map, for a few level of detail factors (0 samples
+// every cell along the ray).
+// usage: bench_voxel_terrain [log2 size]
+
+#include <iostream>
+#include <iomanip>
+#include <chrono>
+#include <cstdlib>
+
+#include "VoxelTerrain.h"
+
+int main(int argc, char **argv)
+{
+    int shift = argc > 1 ? atoi(argv[1]) : 12;
+    const int w = 640, h = 480, frames = 40;
+
+    ThreadPool pool;
+    Terrain terrain;
+    auto start = std::chrono::steady_clock::now();
+    terrain.generate(shift, 1234, &pool);
+    double genMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+    CpuRenderer cpu(&pool);
+    cpu.resize(w, h);
+    VoxelRenderer voxel(&pool);
+    RenderSettings settings;
+    settings.maxDistance = 1500.f;
+    settings.fogStart = 800.f;
+
+    std::cout << std::fixed << std::setprecision(1);
+    std::cout << "terrain " << terrain.size << "x" << terrain.size << " generated in " << genMs << " ms  "
+              << pool.size() << " threads" << std::endl;
+
+    const float lods[4] = {0.f, 0.005f, 0.01f, 0.02f};
+    for (int l = 0; l < 4; l++)
+    {
+        voxel.lodFactor = lods[l];
+        double total = 0;
+        long long samples = 0;
+        for (int f = 0; f < frames; f++)
+        {
+            float angle = f * 6.2831853f / frames;
+            Camera cam = {terrain.size * 0.5f + f * 7.f, terrain.size * 0.5f, cosf(angle), sinf(angle), -sinf(angle) * 0.85f, cosf(angle) * 0.85f};
+            voxel.cameraHeight = terrain.heightAt(cam.posX, cam.posY) + 60.f;
+            start = std::chrono::steady_clock::now();
+            voxel.render(cpu, terrain, cam, settings);
+            total += std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+            samples += voxel.samples;
+        }
+        std::cout << "  lod " << std::setprecision(3) << lods[l] << "  avg " << std::setprecision(2) << total / frames / 1e6
+                  << " ms/frame  " << std::setprecision(1) << total / frames / w << " ns/column  "
+                  << double(samples) / frames / w << " samples/column" << std::endl;
+    }
+    return 0;
+}
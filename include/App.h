@@ -66,6 +66,8 @@ int App::init()
 }
 
 bool should_reflesh = true;
+bool first_frame_shown = false;
+bool c_was_down = false, f_was_down = false, p_was_down = false, h_was_down = false, t_was_down = false, e_was_down = false, g_was_down = false;
 
 void App::loop()
 {
@@ -93,6 +95,11 @@ void App::loop()
             game->loop();
             /* Swap front and back buffers */
             glfwSwapBuffers(window);
+            if (!first_frame_shown) {
+                // glfwGetTime counts from glfwInit, so this covers window, shaders and assets
+                std::cout << "first frame: " << glfwGetTime() * 1000.0 << " ms" << std::endl;
+                first_frame_shown = true;
+            }
 
             should_reflesh = false;
         }
@@ -106,6 +113,8 @@ void App::loop()
         /* Poll for and process events */
         glfwPollEvents();
         double frameTime = glfwGetTime() - currentTime;
+        if (game->tick(frameTime))
+            should_reflesh = true;
         if (glfwGetKey(window, GLFW_KEY_W) == GLFW_PRESS) {
             game->move(SHEESH_ILERI, frameTime);
             should_reflesh = true;
@@ -122,5 +131,50 @@ void App::loop()
             game->move(SHEESH_SOL, frameTime);
             should_reflesh = true;
         }
+
+        // C: compute shader <-> CPU renderer, F: float <-> fixed point CPU path,
+        // P: RGBA <-> paletted CPU path, H: variable heights on the CPU path,
+        // T: heightmap terrain on the CPU path, E: open / close the door ahead,
+        // G: split cast and shade passes <-> one compute invocation per column
+        bool c_down = glfwGetKey(window, GLFW_KEY_C) == GLFW_PRESS;
+        if (c_down && !c_was_down) {
+            game->cpu_render = !game->cpu_render;
+            should_reflesh = true;
+        }
+        c_was_down = c_down;
+        bool f_down = glfwGetKey(window, GLFW_KEY_F) == GLFW_PRESS;
+        if (f_down && !f_was_down) {
+            game->cpu.fixedPoint = !game->cpu.fixedPoint;
+            should_reflesh = true;
+        }
+        f_was_down = f_down;
+        bool p_down = glfwGetKey(window, GLFW_KEY_P) == GLFW_PRESS;
+        if (p_down && !p_was_down) {
+            game->cpu.paletted = !game->cpu.paletted;
+            should_reflesh = true;
+        }
+        p_was_down = p_down;
+        bool h_down = glfwGetKey(window, GLFW_KEY_H) == GLFW_PRESS;
+        if (h_down && !h_was_down) {
+            game->cpu.heights = game->cpu.heights ? NULL : &game->heights;
+            should_reflesh = true;
+        }
+        h_was_down = h_down;
+        bool t_down = glfwGetKey(window, GLFW_KEY_T) == GLFW_PRESS;
+        if (t_down && !t_was_down) {
+            game->terrain_mode = !game->terrain_mode;
+            should_reflesh = true;
+        }
+        t_was_down = t_down;
+        bool e_down = glfwGetKey(window, GLFW_KEY_E) == GLFW_PRESS;
+        if (e_down && !e_was_down)
+            game->toggleDoor();
+        e_was_down = e_down;
+        bool g_down = glfwGetKey(window, GLFW_KEY_G) == GLFW_PRESS;
+        if (g_down && !g_was_down) {
+            game->split_dispatch = !game->split_dispatch;
+            should_reflesh = true;
+        }
+        g_was_down = g_down;
     }
 }
\ No newline at end of file
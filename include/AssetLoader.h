@@ -0,0 +1,266 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <future>
+#include <functional>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <chrono>
+
+#include "Assets.h"
+#include "CpuRenderer.h"
+
+// Texture loading off the main thread. request() hands a texture to the
+// decode threads and gives back a future of its atlas layer; the threads
+// decode it (embedded images skip that, see Assets.h), resample it to the
+// atlas size and convert it to what the renderers draw from: transposed
+// packed texels and key colour mask for CpuRenderer, palette indices both
+// transposed (CPU paletted path) and row major (the GPU array texture).
+// The main thread calls uploadSlice() once per frame, which passes
+// converted textures to the upload callback until uploadBudget bytes are
+// spent and then resolves their futures. The layer is known up front, so
+// the texture table can point at it right away and the renderers draw
+// the placeholder (CpuRenderer::reserveLayers) until the upload lands.
+//
+// No mip levels are built: both renderers sample texels directly.
+
+class AssetLoader
+{
+public:
+    struct Texture
+    {
+        std::string name;
+        int layer = -1;
+        bool ok = false;
+        std::vector<uint32_t> texels;  // texW x texH, (x * texH + y), packRGBA
+        std::vector<uint8_t> mask;     // same order, 1 on key colour texels
+        std::vector<uint8_t> indices;  // same order, into palette
+        std::vector<uint8_t> rows;     // row major indices, for glTexSubImage3D
+    };
+    // main thread, from uploadSlice()
+    typedef std::function<void(const Texture &texture)> Upload;
+
+private:
+    struct Job
+    {
+        Texture texture;
+        std::vector<unsigned char> encoded; // empty: load by name
+        std::promise<int> layer;
+    };
+
+    std::vector<std::thread> threads;
+    std::mutex mtx;
+    std::condition_variable wake;
+    bool quit = false;
+    std::vector<Job *> queue;     // front first
+    size_t queueHead = 0;
+    std::vector<Job *> converted; // in completion order
+    int busy = 0;
+
+    std::vector<uint8_t> inverse; // 15 bit colour -> nearest palette index
+    std::once_flag inverseBuilt;  // by the first decode thread that needs it
+
+    void decodeLoop();
+    void buildInverse();
+    void convert(Job &job, const unsigned char *pixels, int w, int h, int channels);
+
+public:
+    int texW = 64, texH = 64;    // the atlas layer size, set before requesting
+    Palette palette;             // set before requesting
+    size_t uploadBudget = 256 << 10;
+
+    // stats
+    std::atomic<int> decoded{0}, failed{0};
+    std::atomic<long long> decodeMicros{0}; // summed over threads
+    int uploaded = 0;
+    size_t uploadedBytes = 0;
+
+    AssetLoader(int threadCount = 0);
+    ~AssetLoader();
+
+    std::shared_future<int> request(const std::string &name, int layer);
+    std::shared_future<int> request(const std::string &name, int layer, std::vector<unsigned char> encoded);
+    int uploadSlice(const Upload &upload); // textures uploaded
+    int pending();                         // requested and not uploaded yet
+    int threadCount() const { return (int)threads.size(); }
+};
+
+AssetLoader::AssetLoader(int threadCount)
+{
+    if (threadCount <= 0)
+        threadCount = (int)std::thread::hardware_concurrency() - 1;
+    if (threadCount <= 0)
+        threadCount = 1;
+    for (int i = 0; i < threadCount; i++)
+        threads.emplace_back(&AssetLoader::decodeLoop, this);
+}
+
+AssetLoader::~AssetLoader()
+{
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        quit = true;
+    }
+    wake.notify_all();
+    for (auto &t : threads)
+        t.join();
+    for (size_t i = queueHead; i < queue.size(); i++)
+        delete queue[i];
+    for (Job *job : converted)
+        delete job;
+}
+
+void AssetLoader::buildInverse()
+{
+    inverse.resize(1 << 15);
+    for (int c = 0; c < (1 << 15); c++)
+    {
+        int r = ((c >> 10) & 31) * 255 / 31, g = ((c >> 5) & 31) * 255 / 31, b = (c & 31) * 255 / 31;
+        int best = 0, bestDist = 1 << 30;
+        for (int i = 0; i < palette.count; i++)
+        {
+            int dr = r - (int)(palette.colors[i] & 0xFF);
+            int dg = g - (int)((palette.colors[i] >> 8) & 0xFF);
+            int db = b - (int)((palette.colors[i] >> 16) & 0xFF);
+            int d = dr * dr + dg * dg + db * db;
+            if (d < bestDist) {
+                bestDist = d;
+                best = i;
+            }
+        }
+        inverse[c] = (uint8_t)best;
+    }
+}
+
+std::shared_future<int> AssetLoader::request(const std::string &name, int layer)
+{
+    return request(name, layer, std::vector<unsigned char>());
+}
+
+std::shared_future<int> AssetLoader::request(const std::string &name, int layer, std::vector<unsigned char> encoded)
+{
+    Job *job = new Job();
+    job->texture.name = name;
+    job->texture.layer = layer;
+    job->encoded = std::move(encoded);
+    std::shared_future<int> future = job->layer.get_future().share();
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        queue.push_back(job);
+    }
+    wake.notify_one();
+    return future;
+}
+
+void AssetLoader::decodeLoop()
+{
+    while (true)
+    {
+        Job *job;
+        {
+            std::unique_lock<std::mutex> lock(mtx);
+            wake.wait(lock, [&] { return quit || queueHead < queue.size(); });
+            if (quit)
+                return;
+            job = queue[queueHead++];
+            if (queueHead == queue.size()) {
+                queue.clear();
+                queueHead = 0;
+            }
+            busy++;
+        }
+
+        auto start = std::chrono::steady_clock::now();
+        if (job->encoded.empty()) {
+            ImageAsset image;
+            if (loadImageAsset(job->texture.name.c_str(), image))
+                convert(*job, image.pixels, image.w, image.h, image.channels);
+        } else {
+            int w, h, channels;
+            stbi_set_flip_vertically_on_load_thread(true);
+            unsigned char *pixels = stbi_load_from_memory(job->encoded.data(), (int)job->encoded.size(), &w, &h, &channels, 0);
+            if (pixels) {
+                convert(*job, pixels, w, h, channels);
+                stbi_image_free(pixels);
+            }
+            job->encoded = std::vector<unsigned char>();
+        }
+        decodeMicros += std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count();
+        if (job->texture.ok)
+            decoded++;
+        else
+            failed++;
+
+        std::lock_guard<std::mutex> lock(mtx);
+        converted.push_back(job);
+        busy--;
+    }
+}
+
+// nearest resample to texW x texH like TextureAtlas::add, then the layouts
+void AssetLoader::convert(Job &job, const unsigned char *pixels, int w, int h, int channels)
+{
+    if (channels < 3)
+        return;
+    std::call_once(inverseBuilt, [this] { buildInverse(); });
+    Texture &t = job.texture;
+    size_t size = (size_t)texW * texH;
+    t.texels.resize(size);
+    t.mask.resize(size);
+    t.indices.resize(size);
+    t.rows.resize(size);
+    for (int y = 0; y < texH; y++)
+        for (int x = 0; x < texW; x++)
+        {
+            const unsigned char *p = pixels + ((size_t)(y * h / texH) * w + x * w / texW) * channels;
+            size_t i = (size_t)x * texH + y;
+            uint8_t index = inverse[(p[0] >> 3) << 10 | (p[1] >> 3) << 5 | (p[2] >> 3)];
+            t.texels[i] = packRGBA(p[0], p[1], p[2]);
+            t.mask[i] = maskKey(p[0], p[1], p[2]);
+            t.indices[i] = index;
+            t.rows[(size_t)y * texW + x] = index;
+        }
+    t.ok = true;
+}
+
+int AssetLoader::uploadSlice(const Upload &upload)
+{
+    std::vector<Job *> slice;
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        size_t bytes = 0, n = 0;
+        const size_t layerBytes = (size_t)texW * texH * 7; // texels, mask, indices, rows
+        while (n < converted.size() && (n == 0 || bytes + layerBytes <= uploadBudget))
+        {
+            bytes += layerBytes;
+            n++;
+        }
+        slice.assign(converted.begin(), converted.begin() + n);
+        converted.erase(converted.begin(), converted.begin() + n);
+    }
+
+    for (Job *job : slice)
+    {
+        if (job->texture.ok) {
+            upload(job->texture);
+            uploaded++;
+            uploadedBytes += (size_t)texW * texH * 7;
+            job->layer.set_value(job->texture.layer);
+        } else {
+            std::cerr << "texture failed to load: " << job->texture.name << std::endl;
+            job->layer.set_value(-1);
+        }
+        delete job;
+    }
+    return (int)slice.size();
+}
+
+int AssetLoader::pending()
+{
+    std::lock_guard<std::mutex> lock(mtx);
+    return (int)(queue.size() - queueHead + converted.size()) + busy;
+}
@@ -0,0 +1,121 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdlib>
+#include <cstring>
+#include <cstdio>
+#include <string>
+#include <vector>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+
+#include "stb_image.h"
+
+// Shaders and textures by name, relative to assets/ ("shaders/compute.glsl",
+// "wall.png"). With EMBEDDED_ASSETS defined (the CMake build runs
+// tools/embed_assets into EmbeddedAssets.h) they come out of the binary:
+// shader text as is and images already decoded, flipped like the runtime
+// load, so startup does no file I/O and no PNG decode. When the
+// RAYCASTER_ASSETS environment variable names a directory, files found
+// there win over the embedded copies, for mods. Builds without embedding
+// read from the working directory as before.
+
+struct EmbeddedAsset
+{
+    const char *name;
+    const unsigned char *data; // size bytes plus a 0, so text can be used as a C string
+    size_t size;
+    int w, h, channels;        // images only, decoded pixels in data
+};
+
+#ifdef EMBEDDED_ASSETS
+#include "EmbeddedAssets.h"
+#else
+constexpr EmbeddedAsset embeddedAssets[] = {{"", NULL, 0, 0, 0, 0}};
+constexpr int embeddedAssetCount = 0;
+#endif
+
+// decoded pixels, rows bottom up, borrowed from the binary when embedded
+struct ImageAsset
+{
+    const unsigned char *pixels = NULL;
+    int w = 0, h = 0, channels = 0;
+    std::vector<unsigned char> owned; // pixels of an image decoded from a file
+};
+
+const EmbeddedAsset *findEmbeddedAsset(const char *name)
+{
+    for (int i = 0; i < embeddedAssetCount; i++)
+        if (strcmp(embeddedAssets[i].name, name) == 0)
+            return &embeddedAssets[i];
+    return NULL;
+}
+
+// path of name in the override directory, empty when there is none
+static std::string assetOverridePath(const char *name)
+{
+    const char *dir = getenv("RAYCASTER_ASSETS");
+    if (!dir || !*dir)
+        return std::string();
+    return std::string(dir) + "/" + name;
+}
+
+static bool readAssetFile(const std::string &path, std::string &out)
+{
+    std::ifstream file(path, std::ios::binary);
+    if (!file)
+        return false;
+    out.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+    return true;
+}
+
+bool loadTextAsset(const char *name, std::string &out)
+{
+    std::string path = assetOverridePath(name);
+    if (!path.empty() && readAssetFile(path, out))
+        return true;
+    if (const EmbeddedAsset *e = findEmbeddedAsset(name)) {
+        out.assign((const char *)e->data, e->size);
+        return true;
+    }
+    if (readAssetFile(name, out))
+        return true;
+    std::cerr << "asset not found: " << name << std::endl;
+    return false;
+}
+
+static bool decodeImageFile(const char *path, ImageAsset &image)
+{
+    FILE *f = fopen(path, "rb");
+    if (!f)
+        return false;
+    stbi_set_flip_vertically_on_load_thread(true); // decoded on loader threads too
+    unsigned char *pixels = stbi_load_from_file(f, &image.w, &image.h, &image.channels, 0);
+    fclose(f);
+    if (!pixels)
+        return false;
+    image.owned.assign(pixels, pixels + (size_t)image.w * image.h * image.channels);
+    stbi_image_free(pixels);
+    image.pixels = image.owned.data();
+    return true;
+}
+
+bool loadImageAsset(const char *name, ImageAsset &image)
+{
+    std::string path = assetOverridePath(name);
+    if (!path.empty() && decodeImageFile(path.c_str(), image))
+        return true;
+    if (const EmbeddedAsset *e = findEmbeddedAsset(name)) {
+        image.owned.clear();
+        image.pixels = e->data;
+        image.w = e->w;
+        image.h = e->h;
+        image.channels = e->channels;
+        return true;
+    }
+    if (decodeImageFile(name, image))
+        return true;
+    std::cerr << "asset not found: " << name << std::endl;
+    return false;
+}
@@ -0,0 +1,376 @@
+#pragma once
+
+#include <cstdint>
+#include <cstdlib>
+#include <vector>
+#include <unordered_map>
+#include <algorithm>
+#include <functional>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <math.h>
+
+#include "WorldMap.h"
+
+// Chunk residency for worlds too big to keep in memory (MapGenerator worlds
+// up to 1M x 1M). The renderers keep reading a plain WorldMap, `view`: a
+// window of viewChunks x viewChunks chunks around the camera. Chunks are
+// loaded (or generated) by a Loader on background threads, nearest and
+// straight ahead of the travel direction first, plus `lookahead` chunks
+// past the view edge along that direction, so they are in before the
+// window gets there. A view chunk that is not resident yet holds `fallback`
+// cells (a solid wall, give it a fog coloured texture for the fog look):
+// the traversal never waits on a load, the chunk pops in on the update
+// after it arrives. Resident chunks are an LRU cache bounded by
+// budgetBytes; chunks the current update touched are never evicted, so the
+// budget should hold the view plus the lookahead band.
+//
+// The view moves in whole chunks once the camera is viewChunks / 4 off its
+// centre. Everything in it is rewritten then (recentered), otherwise
+// `changed` lists the view rects that chunk arrivals rewrote, for GPU
+// uploads and the caches keyed on map regions.
+
+#define STREAM_CHUNK_SHIFT 6
+#define STREAM_CHUNK (1 << STREAM_CHUNK_SHIFT)
+#define STREAM_CHUNK_CELLS (STREAM_CHUNK * STREAM_CHUNK)
+
+// A position on a streamed world: its chunk and a float offset inside it,
+// [0, STREAM_CHUNK) once normalized. The float part stays small however far
+// the chunk is from the world origin, where a float of the absolute cell
+// (2^24 and up) has no fraction left at all. Ray setup takes the offset
+// from a nearby chunk, the view origin (ChunkStream::viewX/viewY), so the
+// float and 16.16 traversal only ever see view sized coordinates.
+struct WorldPos
+{
+    int64_t chunkX = 0, chunkY = 0;
+    float x = 0, y = 0;
+
+    WorldPos() {}
+    WorldPos(int64_t cellX, int64_t cellY, float fracX = 0.f, float fracY = 0.f)
+        : chunkX(cellX >> STREAM_CHUNK_SHIFT), chunkY(cellY >> STREAM_CHUNK_SHIFT),
+          x((float)(cellX & (STREAM_CHUNK - 1)) + fracX), y((float)(cellY & (STREAM_CHUNK - 1)) + fracY)
+    {
+        normalize();
+    }
+
+    void normalize();
+    void move(float dx, float dy)
+    {
+        x += dx;
+        y += dy;
+        normalize();
+    }
+    int64_t cellX() const { return chunkX * STREAM_CHUNK + (int64_t)floorf(x); }
+    int64_t cellY() const { return chunkY * STREAM_CHUNK + (int64_t)floorf(y); }
+    // offset from the corner of chunk (originX, originY), exact to the float
+    // ulp of the result, so keep the origin close
+    float relX(int64_t originX) const { return (float)((chunkX - originX) * STREAM_CHUNK) + x; }
+    float relY(int64_t originY) const { return (float)((chunkY - originY) * STREAM_CHUNK) + y; }
+};
+
+void WorldPos::normalize()
+{
+    int64_t carryX = (int64_t)floorf(x * (1.f / STREAM_CHUNK));
+    int64_t carryY = (int64_t)floorf(y * (1.f / STREAM_CHUNK));
+    chunkX += carryX;
+    chunkY += carryY;
+    x -= (float)(carryX * STREAM_CHUNK);
+    y -= (float)(carryY * STREAM_CHUNK);
+    // a tiny negative offset rounds up to STREAM_CHUNK
+    if (x >= STREAM_CHUNK) {
+        x -= STREAM_CHUNK;
+        chunkX++;
+    }
+    if (y >= STREAM_CHUNK) {
+        y -= STREAM_CHUNK;
+        chunkY++;
+    }
+}
+
+class ChunkStream
+{
+public:
+    // fills the STREAM_CHUNK_CELLS cells of chunk (cx, cy) at x * STREAM_CHUNK + y,
+    // called on the loader threads
+    typedef std::function<void(int64_t cx, int64_t cy, uint8_t *out)> Loader;
+
+    struct Rect
+    {
+        int x0, y0, x1, y1; // view cells, inclusive
+    };
+
+private:
+    struct Chunk
+    {
+        std::vector<uint8_t> cells;
+        uint64_t lastUse = 0;
+    };
+    struct Request
+    {
+        int64_t key;
+        float priority; // lower loads first
+    };
+
+    Loader loader;
+    int64_t chunksX, chunksY;
+    std::unordered_map<int64_t, Chunk> resident;
+    std::vector<uint8_t> viewState; // per view chunk: VIEW_FALLBACK, VIEW_LOADED or VIEW_OUTSIDE
+    std::vector<Request> wanted;
+    uint64_t useClock = 0;
+
+    // shared with the loader threads
+    std::vector<std::thread> threads;
+    std::mutex mtx;
+    std::condition_variable wake;
+    bool quit = false;
+    std::vector<Request> queue; // sorted, next request at the back
+    std::vector<int64_t> loading;
+    std::vector<std::pair<int64_t, std::vector<uint8_t>>> ready;
+
+    enum { VIEW_FALLBACK, VIEW_LOADED, VIEW_OUTSIDE };
+
+    static int64_t key(int64_t cx, int64_t cy) { return (int64_t)((uint64_t)cx << 32 | (uint32_t)cy); }
+    static int64_t keyX(int64_t k) { return k >> 32; }
+    static int64_t keyY(int64_t k) { return (int32_t)(uint32_t)k; }
+    bool insideWorld(int64_t cx, int64_t cy) const { return cx >= 0 && cy >= 0 && cx < chunksX && cy < chunksY; }
+
+    void loaderLoop();
+    void blit(int vcx, int vcy, const uint8_t *src);
+    void recenter(int64_t cx, int64_t cy);
+    void enforceBudget();
+
+public:
+    int viewChunks = 16;         // view side in chunks
+    int lookahead = 4;           // chunks past the view edge prefetched ahead
+    int nearChunks = 2;          // a missing chunk this close to the camera is a stall
+    size_t budgetBytes = 32 << 20;
+    uint8_t fallback = 1;        // cell value of chunks not resident yet
+
+    WorldMap view;
+    int64_t originX = 0, originY = 0; // world chunk of view cell (0, 0)
+    std::vector<Rect> changed;        // view rects rewritten by the last update
+    bool recentered = false;          // the last update moved the view, all of it changed
+
+    // stats, totals and of the last update
+    uint64_t loads = 0, evictions = 0, stalls = 0, hits = 0, lookups = 0;
+    int frameHits = 0, frameMisses = 0, frameStalls = 0;
+
+    ChunkStream(Loader _loader, int64_t worldW, int64_t worldH, int threadCount = 2);
+    ~ChunkStream();
+
+    // camera at world cell (x, y), moving along (dirX, dirY), zero when still
+    void update(int64_t x, int64_t y, float dirX, float dirY);
+    void update(const WorldPos &pos, float dirX, float dirY) { update(pos.cellX(), pos.cellY(), dirX, dirY); }
+
+    float hitRate() const { return lookups ? (float)hits / lookups : 1.f; }
+    size_t residentBytes() const { return resident.size() * STREAM_CHUNK_CELLS; }
+    size_t inFlight();
+    int fallbackChunks() const; // view chunks inside the world still drawn as the fallback
+    int64_t viewCellX() const { return originX * STREAM_CHUNK; } // world cell of view cell (0, 0)
+    int64_t viewCellY() const { return originY * STREAM_CHUNK; }
+    // position in view cells, what the renderers and the shader's pos take
+    float viewX(const WorldPos &pos) const { return pos.relX(originX); }
+    float viewY(const WorldPos &pos) const { return pos.relY(originY); }
+};
+
+ChunkStream::ChunkStream(Loader _loader, int64_t worldW, int64_t worldH, int threadCount)
+    : loader(_loader)
+{
+    chunksX = (worldW + STREAM_CHUNK - 1) >> STREAM_CHUNK_SHIFT;
+    chunksY = (worldH + STREAM_CHUNK - 1) >> STREAM_CHUNK_SHIFT;
+    if (threadCount < 1)
+        threadCount = 1;
+    for (int i = 0; i < threadCount; i++)
+        threads.emplace_back(&ChunkStream::loaderLoop, this);
+}
+
+ChunkStream::~ChunkStream()
+{
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        quit = true;
+    }
+    wake.notify_all();
+    for (auto &t : threads)
+        t.join();
+}
+
+void ChunkStream::loaderLoop()
+{
+    while (true)
+    {
+        Request r;
+        {
+            std::unique_lock<std::mutex> lock(mtx);
+            wake.wait(lock, [&] { return quit || !queue.empty(); });
+            if (quit)
+                return;
+            r = queue.back();
+            queue.pop_back();
+            loading.push_back(r.key);
+        }
+        std::vector<uint8_t> cells(STREAM_CHUNK_CELLS);
+        loader(keyX(r.key), keyY(r.key), cells.data());
+        {
+            std::lock_guard<std::mutex> lock(mtx);
+            loading.erase(std::find(loading.begin(), loading.end(), r.key));
+            ready.emplace_back(r.key, std::move(cells));
+        }
+    }
+}
+
+size_t ChunkStream::inFlight()
+{
+    std::lock_guard<std::mutex> lock(mtx);
+    return queue.size() + loading.size() + ready.size();
+}
+
+// src NULL writes the fallback
+void ChunkStream::blit(int vcx, int vcy, const uint8_t *src)
+{
+    int x0 = vcx << STREAM_CHUNK_SHIFT, y0 = vcy << STREAM_CHUNK_SHIFT;
+    for (int x = 0; x < STREAM_CHUNK; x++)
+        for (int y = 0; y < STREAM_CHUNK; y++)
+            view.set(x0 + x, y0 + y, src ? src[x * STREAM_CHUNK + y] : fallback);
+}
+
+void ChunkStream::recenter(int64_t cx, int64_t cy)
+{
+    int side = viewChunks << STREAM_CHUNK_SHIFT;
+    if (view.w != side || view.h != side)
+        view.resize(side, side, view.layout);
+    originX = cx - viewChunks / 2;
+    originY = cy - viewChunks / 2;
+    viewState.assign((size_t)viewChunks * viewChunks, VIEW_FALLBACK);
+
+    for (int vcx = 0; vcx < viewChunks; vcx++)
+        for (int vcy = 0; vcy < viewChunks; vcy++)
+        {
+            int64_t wx = originX + vcx, wy = originY + vcy;
+            if (!insideWorld(wx, wy))
+                viewState[(size_t)vcx * viewChunks + vcy] = VIEW_OUTSIDE;
+            blit(vcx, vcy, NULL); // resident chunks are copied in by update()
+        }
+    recentered = true;
+}
+
+void ChunkStream::update(int64_t x, int64_t y, float dirX, float dirY)
+{
+    changed.clear();
+    recentered = false;
+    frameHits = frameMisses = frameStalls = 0;
+    useClock++;
+
+    int64_t cx = x >> STREAM_CHUNK_SHIFT, cy = y >> STREAM_CHUNK_SHIFT;
+    int64_t offX = cx - (originX + viewChunks / 2), offY = cy - (originY + viewChunks / 2);
+    if (viewState.empty() || std::max(std::abs(offX), std::abs(offY)) > viewChunks / 4)
+        recenter(cx, cy);
+
+    // arrivals become resident
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        for (auto &r : ready)
+        {
+            Chunk &c = resident[r.first];
+            c.cells = std::move(r.second);
+            c.lastUse = useClock - 1;
+            loads++;
+        }
+        ready.clear();
+    }
+
+    float len = sqrtf(dirX * dirX + dirY * dirY);
+    if (len > 0) {
+        dirX /= len;
+        dirY /= len;
+    }
+
+    // the view rect, then the band of lookahead chunks around it where it is
+    // ahead of the camera; ahead comes first at equal distance. The camera
+    // can be viewChunks / 4 off centre, so the walk goes by the view, not
+    // by the camera.
+    wanted.clear();
+    for (int64_t wx = originX - lookahead; wx < originX + viewChunks + lookahead; wx++)
+        for (int64_t wy = originY - lookahead; wy < originY + viewChunks + lookahead; wy++)
+        {
+            if (!insideWorld(wx, wy))
+                continue;
+            int vcx = (int)(wx - originX), vcy = (int)(wy - originY);
+            bool inView = vcx >= 0 && vcy >= 0 && vcx < viewChunks && vcy < viewChunks;
+            float ox = (float)(wx - cx), oy = (float)(wy - cy);
+            float ahead = ox * dirX + oy * dirY;
+            float dist = std::max(fabsf(ox), fabsf(oy));
+            if (!inView && ahead < dist * 0.7f)
+                continue;
+
+            auto it = resident.find(key(wx, wy));
+            if (inView)
+                lookups++;
+            if (it != resident.end()) {
+                it->second.lastUse = useClock;
+                if (!inView)
+                    continue;
+                hits++;
+                frameHits++;
+                uint8_t &state = viewState[(size_t)vcx * viewChunks + vcy];
+                if (state == VIEW_FALLBACK) {
+                    blit(vcx, vcy, it->second.cells.data());
+                    state = VIEW_LOADED;
+                    changed.push_back({vcx << STREAM_CHUNK_SHIFT, vcy << STREAM_CHUNK_SHIFT,
+                                       ((vcx + 1) << STREAM_CHUNK_SHIFT) - 1, ((vcy + 1) << STREAM_CHUNK_SHIFT) - 1});
+                }
+                continue;
+            }
+            if (inView) {
+                frameMisses++;
+                if (dist <= nearChunks) {
+                    frameStalls++;
+                    stalls++;
+                }
+            }
+            wanted.push_back({key(wx, wy), dist - 0.75f * ahead});
+        }
+
+    // never ask for more than the budget holds next to what is in use
+    size_t budgetChunks = budgetBytes / STREAM_CHUNK_CELLS;
+    size_t inUse = (size_t)frameHits;
+    std::sort(wanted.begin(), wanted.end(), [](const Request &a, const Request &b) { return a.priority < b.priority; });
+    if (wanted.size() + inUse > budgetChunks)
+        wanted.resize(budgetChunks > inUse ? budgetChunks - inUse : 0);
+
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        queue.clear();
+        for (size_t i = wanted.size(); i-- > 0;)
+            if (std::find(loading.begin(), loading.end(), wanted[i].key) == loading.end())
+                queue.push_back(wanted[i]);
+    }
+    wake.notify_all();
+
+    if (recentered) {
+        changed.clear();
+        changed.push_back({0, 0, view.w - 1, view.h - 1});
+    }
+    enforceBudget();
+}
+
+int ChunkStream::fallbackChunks() const
+{
+    return (int)std::count(viewState.begin(), viewState.end(), (uint8_t)VIEW_FALLBACK);
+}
+
+void ChunkStream::enforceBudget()
+{
+    while (residentBytes() > budgetBytes)
+    {
+        auto oldest = resident.end();
+        for (auto it = resident.begin(); it != resident.end(); ++it)
+            if (it->second.lastUse < useClock && (oldest == resident.end() || it->second.lastUse < oldest->second.lastUse))
+                oldest = it;
+        if (oldest == resident.end())
+            return;
+        resident.erase(oldest);
+        evictions++;
+    }
+}
@@ -0,0 +1,877 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <vector>
+#include <algorithm>
+
+#include "WorldMap.h"
+#include "Dda.h"
+#include "Fixed.h"
+#include "ThreadPool.h"
+#include "RenderSettings.h"
+#include "VisibleSet.h"
+#include "LightMap.h"
+#include "Palette.h"
+#include "TextureAtlas.h"
+#include "Heights.h"
+
+// CPU twin of compute.glsl. Renders the same image into an RGBA8
+// framebuffer, one column per work item on the shared thread pool. With
+// fixedPoint set the traversal, projection and texturing are all 16.16
+// integer math (see Fixed.h) and the frame is bit identical everywhere.
+
+struct Camera
+{
+    float posX, posY;
+    float dirX, dirY;
+    float planeX, planeY;
+};
+
+static inline uint32_t packRGBA(uint32_t r, uint32_t g, uint32_t b)
+{
+    return r | (g << 8) | (b << 16) | 0xFF000000u;
+}
+
+// t in [0, 256], 0 keeps c, 256 is all fog
+static inline uint32_t fogMix(uint32_t c, uint32_t fog, int t)
+{
+    if (t == 0)
+        return c;
+    uint32_t r = ((c & 0xFF) * (256 - t) + (fog & 0xFF) * t) >> 8;
+    uint32_t g = (((c >> 8) & 0xFF) * (256 - t) + ((fog >> 8) & 0xFF) * t) >> 8;
+    uint32_t b = (((c >> 16) & 0xFF) * (256 - t) + ((fog >> 16) & 0xFF) * t) >> 8;
+    return packRGBA(r, g, b);
+}
+
+// level in [0, 255], 255 keeps c
+static inline uint32_t shadeRGBA(uint32_t c, int level)
+{
+    if (level >= 255)
+        return c;
+    uint32_t r = ((c & 0xFF) * (level + 1)) >> 8;
+    uint32_t g = (((c >> 8) & 0xFF) * (level + 1)) >> 8;
+    uint32_t b = (((c >> 16) & 0xFF) * (level + 1)) >> 8;
+    return packRGBA(r, g, b);
+}
+
+// a in [0, 255], 255 is all c
+static inline uint32_t blendRGBA(uint32_t under, uint32_t c, int a)
+{
+    return fogMix(c, under, 255 - a);
+}
+
+// ceiling is floor colour * 0.8, same as the shader
+static inline uint32_t dimCeiling(uint32_t c)
+{
+    uint32_t r = (c & 0xFF) * 4 / 5;
+    uint32_t g = ((c >> 8) & 0xFF) * 4 / 5;
+    uint32_t b = ((c >> 16) & 0xFF) * 4 / 5;
+    return packRGBA(r, g, b);
+}
+
+// collects the masked and translucent walls a ray passes, at most max of
+// them; the ray stops at the first opaque wall or when the list is full
+template <typename Inner>
+struct LayerVisit
+{
+    Inner &inner;
+    const uint8_t *material;
+    RayHit *hits;
+    int max, count;
+
+    void cell(long long bit) { inner.cell(bit); }
+    void run(long long bit, int n, int stepY) { inner.run(bit, n, stepY); }
+    bool through(int mapX, int mapY, int side, float dist, uint8_t cell)
+    {
+        if (material[cell] == MATERIAL_OPAQUE || count == max)
+            return false;
+        RayHit &hit = hits[count++];
+        hit.perpWallDist = dist;
+        hit.mapX = mapX;
+        hit.mapY = mapY;
+        hit.side = side;
+        hit.cell = cell;
+        hit.steps = 0;
+        return true;
+    }
+};
+
+class CpuRenderer
+{
+private:
+    ThreadPool *pool;
+
+    void renderColumnFloat(const WorldMap &world, const Camera &cam, int x);
+    void renderColumnFixed(const WorldMap &world, const FixedCamera &cam, int x);
+    void renderColumnHeights(const WorldMap &world, const Camera &cam, int x);
+    void buildColorMap();
+    void drawLayer(const WorldMap &world, const Camera &cam, float rayDirX, float rayDirY, const RayHit &hit, int x);
+
+    template <typename Visitor>
+    RayHit castRayLayers(const WorldMap &world, const Camera &cam, float rayDirX, float rayDirY, Visitor &inner, RayHit *hits, int &count)
+    {
+        LayerVisit<Visitor> visit = {inner, cellMaterial, hits, maxLayers, 0};
+        RayHit hit = castRayOccupancyVisit(world, cam.posX, cam.posY, rayDirX, rayDirY, settings.maxDistance, visit);
+        count = visit.count;
+        return hit;
+    }
+
+    std::vector<int> columnCells, columnWrites; // per column counters of the heights path
+    std::vector<RayHit> layerHits;              // maxLayers per column, sized with the frame
+    std::vector<int> columnLayers;
+
+    uint32_t shadeTexel(size_t t, int light, int fog) const
+    {
+        if (paletted)
+            return colormap.row(light, fog)[textureIndexed[t]];
+        return fogMix(shadeRGBA(texture[t], light), fogPacked, fog);
+    }
+
+    // settings of the frame being rendered, in both number formats
+    RenderSettings settings;
+    uint32_t fogPacked = 0;
+    float fogScale = 0;
+    int64_t fxMaxDist = 0, fxFogStart = 0, fxFogRange = 1;
+
+    int fogFloat(float dist) const
+    {
+        // clamped before the conversion: past int range (fogScale is 1e30
+        // with no fog range) the cast is undefined
+        float t = (dist - settings.fogStart) * fogScale;
+        return !(t > 0) ? 0 : (t >= 256 ? 256 : int(t));
+    }
+    int fogFixed(int64_t dist) const
+    {
+        int64_t t = ((dist - fxFogStart) << 8) / fxFogRange;
+        return t < 0 ? 0 : (t > 256 ? 256 : (int)t);
+    }
+
+public:
+    int w = 0, h = 0;
+    std::vector<uint32_t> framebuffer; // row y at framebuffer[y * w], same rows as img_output
+    std::vector<float> zbuffer;        // perpWallDist of every column, kept for the sprite pass
+
+    // atlas layers stored transposed (texel x, y of layer l at
+    // (l * texW + x) * texH + y) so a wall column is one contiguous run
+    std::vector<uint32_t> texture;
+    int texW = 0, texH = 0, texLayers = 0;
+
+    // texel offset of the wall, floor and ceiling layer of every cell value
+    size_t wallOffset[256], floorOffset[256], ceilingOffset[256];
+
+    // masked and translucent walls, float path only (fixed point and heights
+    // draw them opaque): rays pass up to maxLayers of them and the column is
+    // composited back to front over the opaque wall behind
+    uint8_t cellMaterial[256], cellAlpha[256];
+    bool seeThrough = false;          // some cell value is not opaque
+    std::vector<uint8_t> textureMask; // 1 on key colour texels, same layout as texture
+    int maxLayers = 4;
+    long long layersDrawn = 0;        // last frame
+
+    // paletted path: the same texture as 8 bit indices (also transposed),
+    // shaded and fogged through the colormap instead of per pixel math
+    bool paletted = false;
+    Palette palette;
+    std::vector<uint8_t> textureIndexed;
+    ColorMap colormap;
+
+    bool fixedPoint = false;
+    int columnChunk = 16;
+
+    // when set, the traversal fills it with the frame's visible cells and faces
+    VisibleSet *visibleSet = NULL;
+
+    // baked lighting, one level per wall column and one per floor pixel
+    const LightMap *lightMap = NULL;
+
+    // when set, columns are drawn front to back through cells of different
+    // floor, ceiling and wall heights (float math, also with fixedPoint)
+    const HeightField *heights = NULL;
+    float eyeHeight = 0.5f;
+    int maxColumnCells = 4096;
+
+    // stats of the last heights frame; with the y-buffer writes never pass w * h
+    struct HeightStats
+    {
+        long long cellsVisited = 0, pixelsWritten = 0;
+        int maxColumnCells = 0;
+    } heightStats;
+
+    CpuRenderer(ThreadPool *_pool) : pool(_pool) {}
+
+    void resize(int _w, int _h);
+    void setTexture(const unsigned char *data, int _texW, int _texH, int channels); // one layer for everything
+    void setTextures(const TextureAtlas &atlas, const TextureTable &table);
+    void setTextureTable(const TextureTable &table);
+    // layers streamed in later (AssetLoader): reserveLayers() grows the
+    // atlas with placeholder layers, setLayer() fills one in, in the
+    // transposed layout, indices into the current palette
+    void reserveLayers(int layers);
+    void setLayer(int layer, const uint32_t *texels, const uint8_t *indices, const uint8_t *mask);
+    // fog and colormap state for a frame; render() calls it, other passes
+    // drawing into the framebuffer (sprites, terrain) can too and then read
+    // it back through the three below
+    void beginFrame(const RenderSettings &_settings);
+    const RenderSettings &frameSettings() const { return settings; }
+    uint32_t fogColor() const { return fogPacked; }
+    int fogAt(float dist) const { return fogFloat(dist); } // 0..256
+    void render(const WorldMap &world, const Camera &cam, const RenderSettings &_settings);
+};
+
+void CpuRenderer::resize(int _w, int _h)
+{
+    w = _w;
+    h = _h;
+    framebuffer.assign((size_t)w * h, 0);
+    zbuffer.assign(w, 0.f);
+}
+
+void CpuRenderer::setTexture(const unsigned char *data, int _texW, int _texH, int channels)
+{
+    TextureAtlas atlas;
+    atlas.add(data, _texW, _texH, channels);
+    setTextures(atlas, TextureTable());
+}
+
+void CpuRenderer::setTextures(const TextureAtlas &atlas, const TextureTable &table)
+{
+    texW = atlas.w;
+    texH = atlas.h;
+    texLayers = atlas.layers;
+    size_t layerSize = (size_t)texW * texH;
+    texture.resize(layerSize * texLayers);
+    textureMask.resize(layerSize * texLayers);
+    for (int l = 0; l < texLayers; l++)
+        for (int y = 0; y < texH; y++)
+            for (int x = 0; x < texW; x++)
+            {
+                const unsigned char *p = atlas.layer(l) + ((size_t)y * texW + x) * 3;
+                texture[l * layerSize + (size_t)x * texH + y] = packRGBA(p[0], p[1], p[2]);
+                textureMask[l * layerSize + (size_t)x * texH + y] = maskKey(p[0], p[1], p[2]);
+            }
+
+    // one palette for the whole atlas: the layers are quantized as one tall image
+    std::vector<uint8_t> indices;
+    quantizeTexture(atlas.rgb.data(), texW, texH * texLayers, 3, palette, indices);
+    textureIndexed.resize(indices.size());
+    for (int l = 0; l < texLayers; l++)
+        for (int y = 0; y < texH; y++)
+            for (int x = 0; x < texW; x++)
+                textureIndexed[l * layerSize + (size_t)x * texH + y] = indices[l * layerSize + (size_t)y * texW + x];
+    colormap.table.clear();
+
+    setTextureTable(table);
+}
+
+// grey checker placeholder, index 0 in the paletted path
+void CpuRenderer::reserveLayers(int layers)
+{
+    if (layers <= texLayers)
+        return;
+    size_t layerSize = (size_t)texW * texH;
+    texture.resize(layerSize * layers);
+    textureMask.resize(layerSize * layers, 0);
+    textureIndexed.resize(layerSize * layers, 0);
+    for (int l = texLayers; l < layers; l++)
+        for (int x = 0; x < texW; x++)
+            for (int y = 0; y < texH; y++)
+                texture[l * layerSize + (size_t)x * texH + y] = ((x >> 3) ^ (y >> 3)) & 1 ? packRGBA(96, 96, 96) : packRGBA(160, 160, 160);
+    texLayers = layers;
+}
+
+void CpuRenderer::setLayer(int layer, const uint32_t *texels, const uint8_t *indices, const uint8_t *mask)
+{
+    if (layer < 0 || layer >= texLayers)
+        return;
+    size_t layerSize = (size_t)texW * texH;
+    std::copy(texels, texels + layerSize, texture.begin() + layer * layerSize);
+    std::copy(indices, indices + layerSize, textureIndexed.begin() + layer * layerSize);
+    std::copy(mask, mask + layerSize, textureMask.begin() + layer * layerSize);
+}
+
+// layers past the atlas fall back to layer 0
+void CpuRenderer::setTextureTable(const TextureTable &table)
+{
+    size_t layerSize = (size_t)texW * texH;
+    seeThrough = false;
+    for (int c = 0; c < 256; c++)
+    {
+        const WallSurface &wall = table.walls[c];
+        const FloorSurface &floor = table.floors[c];
+        wallOffset[c] = (wall.layer < texLayers ? wall.layer : 0) * layerSize;
+        floorOffset[c] = (floor.floor < texLayers ? floor.floor : 0) * layerSize;
+        ceilingOffset[c] = (floor.ceiling < texLayers ? floor.ceiling : 0) * layerSize;
+        cellMaterial[c] = c ? wall.material : MATERIAL_OPAQUE;
+        cellAlpha[c] = wall.alpha;
+        seeThrough |= cellMaterial[c] != MATERIAL_OPAQUE;
+    }
+}
+
+void CpuRenderer::buildColorMap()
+{
+    colormap.fog = fogPacked;
+    colormap.table.resize((size_t)COLORMAP_LIGHTS * COLORMAP_FOGS * 256);
+    for (int l = 0; l < COLORMAP_LIGHTS; l++)
+        for (int f = 0; f < COLORMAP_FOGS; f++)
+        {
+            uint32_t *row = colormap.levelRow(l, f);
+            int level = l * 255 / (COLORMAP_LIGHTS - 1);
+            int t = f * 256 / (COLORMAP_FOGS - 1);
+            for (int i = 0; i < 256; i++)
+                row[i] = fogMix(shadeRGBA(palette.colors[i], level), fogPacked, t);
+        }
+}
+
+void CpuRenderer::beginFrame(const RenderSettings &_settings)
+{
+    settings = _settings;
+    if (settings.fogStart > settings.maxDistance)
+        settings.fogStart = settings.maxDistance;
+    fogPacked = packRGBA((uint32_t)(settings.fogColor[0] * 255.f), (uint32_t)(settings.fogColor[1] * 255.f), (uint32_t)(settings.fogColor[2] * 255.f));
+    float range = settings.maxDistance - settings.fogStart;
+    fogScale = range > 0 ? 256.f / range : 1e30f;
+    // past 16.16 range means no limit
+    fxMaxDist = settings.maxDistance < 32767.f ? (int64_t)toFixed(settings.maxDistance) : FX_FAR;
+    fxFogStart = settings.fogStart < 32767.f ? (int64_t)toFixed(settings.fogStart) : FX_FAR;
+    fxFogRange = fxMaxDist - fxFogStart > 0 ? fxMaxDist - fxFogStart : 1;
+
+    if (paletted && (colormap.table.empty() || colormap.fog != fogPacked))
+        buildColorMap();
+}
+
+void CpuRenderer::render(const WorldMap &world, const Camera &cam, const RenderSettings &_settings)
+{
+    beginFrame(_settings);
+
+    FixedCamera fcam = toFixedCamera(cam.posX, cam.posY, cam.dirX, cam.dirY, cam.planeX, cam.planeY);
+    if (visibleSet)
+        visibleSet->begin(world, w);
+    if (heights) {
+        columnCells.assign(w, 0);
+        columnWrites.assign(w, 0);
+    }
+    bool layered = seeThrough && !heights && !fixedPoint;
+    if (layered) {
+        layerHits.resize((size_t)w * maxLayers);
+        columnLayers.assign(w, 0);
+    }
+    pool->parallelFor(w, columnChunk, [&](int begin, int end) {
+        for (int x = begin; x < end; x++)
+        {
+            if (heights)
+                renderColumnHeights(world, cam, x);
+            else if (fixedPoint)
+                renderColumnFixed(world, fcam, x);
+            else
+                renderColumnFloat(world, cam, x);
+        }
+    });
+    if (visibleSet)
+        visibleSet->finish();
+
+    if (heights) {
+        heightStats = HeightStats();
+        for (int x = 0; x < w; x++)
+        {
+            heightStats.cellsVisited += columnCells[x];
+            heightStats.pixelsWritten += columnWrites[x];
+            heightStats.maxColumnCells = std::max(heightStats.maxColumnCells, columnCells[x]);
+        }
+    }
+    layersDrawn = 0;
+    if (layered)
+        for (int x = 0; x < w; x++)
+            layersDrawn += columnLayers[x];
+}
+
+static inline VisibleFace hitFace(int mapX, int mapY, int side, bool rayPositive, uint8_t cell)
+{
+    VisibleFace f;
+    f.x = cell ? mapX : -1;
+    f.y = mapY;
+    f.face = side * 2 + (rayPositive ? 0 : 1);
+    return f;
+}
+
+void CpuRenderer::renderColumnFloat(const WorldMap &world, const Camera &cam, int x)
+{
+    uint32_t *fb = framebuffer.data();
+    for (int y = 0; y < h; y++)
+        fb[(size_t)y * w + x] = 0;
+
+    float cameraX = 2 * x / float(w) - 1;
+    float rayDirX = cam.dirX + cam.planeX * cameraX;
+    float rayDirY = cam.dirY + cam.planeY * cameraX;
+
+    RayHit hit;
+    RayHit *layers = seeThrough ? layerHits.data() + (size_t)x * maxLayers : NULL;
+    int layerCount = 0;
+    if (visibleSet) {
+        CellMarker marker = {visibleSet, x};
+        if (layers)
+            hit = castRayLayers(world, cam, rayDirX, rayDirY, marker, layers, layerCount);
+        else
+            hit = castRayOccupancyVisit(world, cam.posX, cam.posY, rayDirX, rayDirY, settings.maxDistance, marker);
+        visibleSet->columnFaces[x] = hitFace(hit.mapX, hit.mapY, hit.side, (hit.side == 0 ? rayDirX : rayDirY) >= 0, hit.cell);
+    } else if (layers) {
+        NoVisit none;
+        hit = castRayLayers(world, cam, rayDirX, rayDirY, none, layers, layerCount);
+    } else {
+        hit = castRayOccupancy(world, cam.posX, cam.posY, rayDirX, rayDirY, settings.maxDistance);
+    }
+    float perpWallDist = hit.perpWallDist > 1e-4f ? hit.perpWallDist : 1e-4f;
+    // the list ran out on a see-through wall: fog behind it, drawn as a layer
+    bool backLayer = layers && hit.cell && cellMaterial[hit.cell] != MATERIAL_OPAQUE;
+    // sprites are hidden by the nearest wall, see-through or not
+    zbuffer[x] = layerCount ? std::max(layers[0].perpWallDist, 1e-4f) : perpWallDist;
+
+    int lineHeight = int(h / perpWallDist);
+    int drawStart = -lineHeight / 2 + h / 2;
+    if (drawStart < 0) drawStart = 0;
+    int drawEnd = lineHeight / 2 + h / 2;
+    if (drawEnd >= h) drawEnd = h - 1;
+
+    float wallX;
+    if (hit.side == 0) wallX = cam.posY + perpWallDist * rayDirY;
+    else               wallX = cam.posX + perpWallDist * rayDirX;
+    wallX -= floorf(wallX);
+    bool thinHit = hit.cell && world.thin[hit.cell].axis != THIN_NONE;
+    float texU = thinHit ? wallX - world.openAt(hit.mapX, hit.mapY) : wallX; // the texture slides with the door
+
+    int texX = int(texU * float(texW));
+    if (texX >= texW) texX = texW - 1;
+    if (hit.side == 0 && rayDirX > 0) texX = texW - texX - 1;
+    if (hit.side == 1 && rayDirY < 0) texX = texW - texX - 1;
+
+    if (hit.cell == 0 || backLayer) {
+        // nothing within reach, the wall band is all fog
+        for (int y = drawStart; y < drawEnd; y++)
+            fb[(size_t)y * w + x] = fogPacked;
+    } else {
+        int fog = fogFloat(perpWallDist);
+        int light = lightMap ? lightMap->faceLevel(hit.mapX, hit.mapY, hit.side * 2 + ((hit.side == 0 ? rayDirX : rayDirY) >= 0 ? 0 : 1)) : 255;
+        float step = 1.0f * texH / lineHeight;
+        float texPos = (drawStart - h / 2 + lineHeight / 2) * step;
+        if (paletted) {
+            const uint8_t *column = textureIndexed.data() + wallOffset[hit.cell] + (size_t)texX * texH;
+            const uint32_t *shade = colormap.row(light, fog);
+            for (int y = drawStart; y < drawEnd; y++)
+            {
+                int texY = int(texPos) & (texH - 1);
+                texPos += step;
+                fb[(size_t)y * w + x] = shade[column[texY]];
+            }
+        } else {
+            const uint32_t *column = texture.data() + wallOffset[hit.cell] + (size_t)texX * texH;
+            for (int y = drawStart; y < drawEnd; y++)
+            {
+                int texY = int(texPos) & (texH - 1);
+                texPos += step;
+                fb[(size_t)y * w + x] = fogMix(shadeRGBA(column[texY], light), fogPacked, fog);
+            }
+        }
+    }
+
+    float floorXWall, floorYWall;
+    if (hit.cell == 0 || thinHit) {
+        floorXWall = cam.posX + perpWallDist * rayDirX;
+        floorYWall = cam.posY + perpWallDist * rayDirY;
+    } else if (hit.side == 0 && rayDirX > 0) {
+        floorXWall = hit.mapX;
+        floorYWall = hit.mapY + wallX;
+    } else if (hit.side == 0 && rayDirX < 0) {
+        floorXWall = hit.mapX + 1.0f;
+        floorYWall = hit.mapY + wallX;
+    } else if (hit.side == 1 && rayDirY > 0) {
+        floorXWall = hit.mapX + wallX;
+        floorYWall = hit.mapY;
+    } else {
+        floorXWall = hit.mapX + wallX;
+        floorYWall = hit.mapY + 1.0f;
+    }
+
+    if (drawEnd < 0) drawEnd = h;
+    for (int y = drawEnd; y < h; y++)
+    {
+        if (2 * y - h <= 0)
+            continue;
+        float currentDist = h / (2.0f * y - h);
+        float weight = currentDist / perpWallDist;
+
+        float currentFloorX = weight * floorXWall + (1.0f - weight) * cam.posX;
+        float currentFloorY = weight * floorYWall + (1.0f - weight) * cam.posY;
+
+        int floorTexX = int(currentFloorX * texW) % texW;
+        int floorTexY = int(currentFloorY * texH) % texH;
+        if (floorTexX < 0) floorTexX += texW;
+        if (floorTexY < 0) floorTexY += texH;
+
+        int cellX = std::min(std::max(int(currentFloorX), 0), world.w - 1);
+        int cellY = std::min(std::max(int(currentFloorY), 0), world.h - 1);
+        uint8_t kind = world.floors[(size_t)cellX * world.h + cellY];
+        size_t t = (size_t)floorTexX * texH + floorTexY;
+        size_t floorT = floorOffset[kind] + t, ceilingT = ceilingOffset[kind] + t;
+        int light = lightMap ? lightMap->floorLevel(int(currentFloorX * LIGHTMAP_RES), int(currentFloorY * LIGHTMAP_RES)) : 255;
+        int fog = fogFloat(currentDist);
+        if (paletted) {
+            fb[(size_t)y * w + x] = colormap.row(light, fog)[textureIndexed[floorT]];
+            fb[(size_t)(h - y) * w + x] = colormap.row(light * 4 / 5, fog)[textureIndexed[ceilingT]];
+        } else {
+            fb[(size_t)y * w + x] = fogMix(shadeRGBA(texture[floorT], light), fogPacked, fog);
+            fb[(size_t)(h - y) * w + x] = fogMix(dimCeiling(shadeRGBA(texture[ceilingT], light)), fogPacked, fog);
+        }
+    }
+
+    // see-through walls over everything behind them, farthest first
+    if (backLayer)
+        drawLayer(world, cam, rayDirX, rayDirY, hit, x);
+    for (int i = layerCount - 1; i >= 0; i--)
+        drawLayer(world, cam, rayDirX, rayDirY, layers[i], x);
+    if (layers)
+        columnLayers[x] = layerCount + backLayer;
+}
+
+// one masked or translucent wall column over what is already in the
+// framebuffer; key colour texels are holes for both
+void CpuRenderer::drawLayer(const WorldMap &world, const Camera &cam, float rayDirX, float rayDirY, const RayHit &hit, int x)
+{
+    uint32_t *fb = framebuffer.data();
+    float dist = hit.perpWallDist > 1e-4f ? hit.perpWallDist : 1e-4f;
+
+    int lineHeight = int(h / dist);
+    int drawStart = -lineHeight / 2 + h / 2;
+    if (drawStart < 0) drawStart = 0;
+    int drawEnd = lineHeight / 2 + h / 2;
+    if (drawEnd >= h) drawEnd = h - 1;
+
+    float wallX;
+    if (hit.side == 0) wallX = cam.posY + dist * rayDirY;
+    else               wallX = cam.posX + dist * rayDirX;
+    wallX -= floorf(wallX);
+    if (world.thin[hit.cell].axis != THIN_NONE)
+        wallX -= world.openAt(hit.mapX, hit.mapY); // the texture slides with the door
+
+    int texX = int(wallX * float(texW));
+    if (texX >= texW) texX = texW - 1;
+    if (hit.side == 0 && rayDirX > 0) texX = texW - texX - 1;
+    if (hit.side == 1 && rayDirY < 0) texX = texW - texX - 1;
+
+    int fog = fogFloat(dist);
+    int light = lightMap ? lightMap->faceLevel(hit.mapX, hit.mapY, hit.side * 2 + ((hit.side == 0 ? rayDirX : rayDirY) >= 0 ? 0 : 1)) : 255;
+    size_t column = wallOffset[hit.cell] + (size_t)texX * texH;
+    const uint8_t *mask = textureMask.data() + column;
+    bool masked = cellMaterial[hit.cell] == MATERIAL_MASKED;
+    int alpha = cellAlpha[hit.cell];
+    float step = 1.0f * texH / lineHeight;
+    float texPos = (drawStart - h / 2 + lineHeight / 2) * step;
+    for (int y = drawStart; y < drawEnd; y++)
+    {
+        int texY = int(texPos) & (texH - 1);
+        texPos += step;
+        if (mask[texY])
+            continue;
+        uint32_t c = shadeTexel(column + texY, light, fog);
+        uint32_t *p = fb + (size_t)y * w + x;
+        *p = masked ? c : blendRGBA(*p, c, alpha);
+    }
+}
+
+void CpuRenderer::renderColumnFixed(const WorldMap &world, const FixedCamera &cam, int x)
+{
+    uint32_t *fb = framebuffer.data();
+    for (int y = 0; y < h; y++)
+        fb[(size_t)y * w + x] = 0;
+
+    fixed cameraX = (fixed)((((int64_t)2 * x - w) << FX_SHIFT) / w);
+    fixed rayDirX = cam.dirX + (fixed)fxMul(cam.planeX, cameraX);
+    fixed rayDirY = cam.dirY + (fixed)fxMul(cam.planeY, cameraX);
+
+    FixedRayHit hit;
+    if (visibleSet) {
+        CellMarker marker = {visibleSet, x};
+        hit = castRayFixedVisit(world, cam.posX, cam.posY, rayDirX, rayDirY, fxMaxDist, marker);
+        visibleSet->columnFaces[x] = hitFace(hit.mapX, hit.mapY, hit.side, (hit.side == 0 ? rayDirX : rayDirY) >= 0, hit.cell);
+    } else {
+        hit = castRayFixed(world, cam.posX, cam.posY, rayDirX, rayDirY, fxMaxDist);
+    }
+    int64_t perpWallDist = hit.perpWallDist > 0 ? hit.perpWallDist : 1;
+    zbuffer[x] = fromFixed(perpWallDist);
+
+    int64_t lineHeight64 = ((int64_t)h << FX_SHIFT) / perpWallDist;
+    int lineHeight = lineHeight64 > (1 << 24) ? (1 << 24) : (int)lineHeight64;
+    int drawStart = -lineHeight / 2 + h / 2;
+    if (drawStart < 0) drawStart = 0;
+    int drawEnd = lineHeight / 2 + h / 2;
+    if (drawEnd >= h) drawEnd = h - 1;
+
+    int64_t wallX;
+    if (hit.side == 0) wallX = cam.posY + fxMul(perpWallDist, rayDirY);
+    else               wallX = cam.posX + fxMul(perpWallDist, rayDirX);
+    wallX &= FX_FRAC;
+
+    int texX = (int)((wallX * texW) >> FX_SHIFT);
+    if (hit.side == 0 && rayDirX > 0) texX = texW - texX - 1;
+    if (hit.side == 1 && rayDirY < 0) texX = texW - texX - 1;
+
+    if (hit.cell == 0)
+    {
+        for (int y = drawStart; y < drawEnd; y++)
+            fb[(size_t)y * w + x] = fogPacked;
+    }
+    else if (lineHeight > 0)
+    {
+        int fog = fogFixed(perpWallDist);
+        int light = lightMap ? lightMap->faceLevel(hit.mapX, hit.mapY, hit.side * 2 + ((hit.side == 0 ? rayDirX : rayDirY) >= 0 ? 0 : 1)) : 255;
+        int64_t step = ((int64_t)texH << FX_SHIFT) / lineHeight;
+        int64_t texPos = (int64_t)(drawStart - h / 2 + lineHeight / 2) * step;
+        if (paletted) {
+            const uint8_t *column = textureIndexed.data() + wallOffset[hit.cell] + (size_t)texX * texH;
+            const uint32_t *shade = colormap.row(light, fog);
+            for (int y = drawStart; y < drawEnd; y++)
+            {
+                int texY = (int)(texPos >> FX_SHIFT) & (texH - 1);
+                texPos += step;
+                fb[(size_t)y * w + x] = shade[column[texY]];
+            }
+        } else {
+            const uint32_t *column = texture.data() + wallOffset[hit.cell] + (size_t)texX * texH;
+            for (int y = drawStart; y < drawEnd; y++)
+            {
+                int texY = (int)(texPos >> FX_SHIFT) & (texH - 1);
+                texPos += step;
+                fb[(size_t)y * w + x] = fogMix(shadeRGBA(column[texY], light), fogPacked, fog);
+            }
+        }
+    }
+
+    int64_t floorXWall, floorYWall;
+    int64_t mapX = (int64_t)hit.mapX << FX_SHIFT, mapY = (int64_t)hit.mapY << FX_SHIFT;
+    if (hit.cell == 0) {
+        floorXWall = cam.posX + fxMul(perpWallDist, rayDirX);
+        floorYWall = cam.posY + fxMul(perpWallDist, rayDirY);
+    } else if (hit.side == 0 && rayDirX > 0) {
+        floorXWall = mapX;
+        floorYWall = mapY + wallX;
+    } else if (hit.side == 0 && rayDirX < 0) {
+        floorXWall = mapX + FX_ONE;
+        floorYWall = mapY + wallX;
+    } else if (hit.side == 1 && rayDirY > 0) {
+        floorXWall = mapX + wallX;
+        floorYWall = mapY;
+    } else {
+        floorXWall = mapX + wallX;
+        floorYWall = mapY + FX_ONE;
+    }
+
+    if (drawEnd < 0) drawEnd = h;
+    for (int y = drawEnd; y < h; y++)
+    {
+        if (2 * y - h <= 0)
+            continue;
+        int64_t currentDist = ((int64_t)h << FX_SHIFT) / (2 * y - h);
+        int64_t weight = (currentDist << FX_SHIFT) / perpWallDist;
+
+        int64_t currentFloorX = fxMul(weight, floorXWall) + fxMul(FX_ONE - weight, cam.posX);
+        int64_t currentFloorY = fxMul(weight, floorYWall) + fxMul(FX_ONE - weight, cam.posY);
+
+        int floorTexX = (int)(((currentFloorX * texW) >> FX_SHIFT) % texW);
+        int floorTexY = (int)(((currentFloorY * texH) >> FX_SHIFT) % texH);
+        if (floorTexX < 0) floorTexX += texW;
+        if (floorTexY < 0) floorTexY += texH;
+
+        int cellX = std::min(std::max((int)(currentFloorX >> FX_SHIFT), 0), world.w - 1);
+        int cellY = std::min(std::max((int)(currentFloorY >> FX_SHIFT), 0), world.h - 1);
+        uint8_t kind = world.floors[(size_t)cellX * world.h + cellY];
+        size_t t = (size_t)floorTexX * texH + floorTexY;
+        size_t floorT = floorOffset[kind] + t, ceilingT = ceilingOffset[kind] + t;
+        int light = lightMap ? lightMap->floorLevel((int)((currentFloorX * LIGHTMAP_RES) >> FX_SHIFT), (int)((currentFloorY * LIGHTMAP_RES) >> FX_SHIFT)) : 255;
+        int fog = fogFixed(currentDist);
+        if (paletted) {
+            fb[(size_t)y * w + x] = colormap.row(light, fog)[textureIndexed[floorT]];
+            fb[(size_t)(h - y) * w + x] = colormap.row(light * 4 / 5, fog)[textureIndexed[ceilingT]];
+        } else {
+            fb[(size_t)y * w + x] = fogMix(shadeRGBA(texture[floorT], light), fogPacked, fog);
+            fb[(size_t)(h - y) * w + x] = fogMix(dimCeiling(shadeRGBA(texture[ceilingT], light)), fogPacked, fog);
+        }
+    }
+}
+
+// Front to back through every cell the ray crosses. [top, bottom) are the
+// rows of the column not drawn yet: the floor of a cell fills up from the
+// bottom, its ceiling down from the top, and a step up (or down from the
+// ceiling) to the next cell draws a face and raises the clip. The column
+// is done when the clip closes, the ray hits a blocked cell, leaves the map
+// or passes maxDistance; whatever is left is fog.
+void CpuRenderer::renderColumnHeights(const WorldMap &world, const Camera &cam, int x)
+{
+    uint32_t *fb = framebuffer.data();
+    const HeightField &hf = *heights;
+    const float halfH = h * 0.5f, eyeZ = eyeHeight;
+
+    float cameraX = 2 * x / float(w) - 1;
+    float rayDirX = cam.dirX + cam.planeX * cameraX;
+    float rayDirY = cam.dirY + cam.planeY * cameraX;
+
+    int mapX = int(cam.posX), mapY = int(cam.posY);
+    float deltaDistX = (rayDirX == 0) ? 1e30f : fabsf(1 / rayDirX);
+    float deltaDistY = (rayDirY == 0) ? 1e30f : fabsf(1 / rayDirY);
+    int stepX = rayDirX < 0 ? -1 : 1, stepY = rayDirY < 0 ? -1 : 1;
+    float sideDistX = (rayDirX < 0 ? cam.posX - mapX : mapX + 1.0f - cam.posX) * deltaDistX;
+    float sideDistY = (rayDirY < 0 ? cam.posY - mapY : mapY + 1.0f - cam.posY) * deltaDistY;
+
+    int top = 0, bottom = h;
+    int cells = 0, writes = 0;
+    float nearDist = 0;
+    zbuffer[x] = settings.maxDistance;
+
+    // rows covered by height z between two distances; near 0 is off screen
+    auto rowAt = [&](float z, float dist) {
+        float y = halfH - (z - eyeZ) * h / dist;
+        return y < -1.f ? -1 : (y > h + 1.f ? h + 1 : int(ceilf(y)));
+    };
+
+    CellMarker marker = {visibleSet, x};
+    if (visibleSet)
+        visibleSet->columnFaces[x] = hitFace(mapX, mapY, 0, true, 0);
+
+    size_t cur = (size_t)mapX * world.h + mapY;
+    bool inside = world.inside(mapX, mapY);
+    while (inside && top < bottom && cells < maxColumnCells)
+    {
+        cells++;
+        if (visibleSet)
+            marker.cell((long long)world.occBit(mapX, mapY));
+        float farDist;
+        int side;
+        if (sideDistX < sideDistY) {
+            farDist = sideDistX;
+            sideDistX += deltaDistX;
+            mapX += stepX;
+            side = 0;
+        } else {
+            farDist = sideDistY;
+            sideDistY += deltaDistY;
+            mapY += stepY;
+            side = 1;
+        }
+        bool last = farDist >= settings.maxDistance;
+        if (last)
+            farDist = settings.maxDistance;
+
+        float cf = hf.floorAt(cur), cc = hf.ceilAt(cur);
+        uint8_t kind = world.floors[cur];
+
+        // floor of this cell, from the near edge up to the far edge
+        if (eyeZ > cf)
+        {
+            int r0 = std::max(rowAt(cf, farDist), top);
+            int r1 = nearDist > 0 ? std::min(rowAt(cf, nearDist), bottom) : bottom;
+            for (int r = std::max(r0, int(halfH) + 1); r < r1; r++)
+            {
+                float rowDist = (eyeZ - cf) * h / (r - halfH);
+                float fx = cam.posX + rowDist * rayDirX, fy = cam.posY + rowDist * rayDirY;
+                int tx = int((fx - floorf(fx)) * texW), ty = int((fy - floorf(fy)) * texH);
+                size_t t = floorOffset[kind] + (size_t)std::min(tx, texW - 1) * texH + std::min(ty, texH - 1);
+                int light = lightMap ? lightMap->floorLevel(int(fx * LIGHTMAP_RES), int(fy * LIGHTMAP_RES)) : 255;
+                fb[(size_t)r * w + x] = shadeTexel(t, light, fogFloat(rowDist));
+                writes++;
+            }
+            if (r0 < bottom)
+                bottom = std::max(r0, top);
+        }
+        // ceiling, from the top down to the far edge
+        if (cc > eyeZ && top < bottom)
+        {
+            int r0 = nearDist > 0 ? std::max(rowAt(cc, nearDist), top) : top;
+            int r1 = std::min(rowAt(cc, farDist), bottom);
+            for (int r = r0; r < std::min(r1, int(ceilf(halfH))); r++)
+            {
+                float rowDist = (cc - eyeZ) * h / (halfH - r);
+                float fx = cam.posX + rowDist * rayDirX, fy = cam.posY + rowDist * rayDirY;
+                int tx = int((fx - floorf(fx)) * texW), ty = int((fy - floorf(fy)) * texH);
+                size_t t = ceilingOffset[kind] + (size_t)std::min(tx, texW - 1) * texH + std::min(ty, texH - 1);
+                int light = lightMap ? lightMap->floorLevel(int(fx * LIGHTMAP_RES), int(fy * LIGHTMAP_RES)) : 255;
+                fb[(size_t)r * w + x] = shadeTexel(t, light * 4 / 5, fogFloat(rowDist));
+                writes++;
+            }
+            if (r1 > top)
+                top = std::min(r1, bottom);
+        }
+        if (last || top >= bottom || !world.inside(mapX, mapY))
+            break;
+
+        size_t next = (size_t)mapX * world.h + mapY;
+        float nf = hf.floorAt(next), nc = hf.ceilAt(next);
+        bool blocked = hf.blocked(next);
+        if (blocked) {
+            nf = std::max(nf, cc);
+            nc = std::min(nc, cf);
+        }
+
+        if (nf > cf || nc < cc)
+        {
+            float wallX = side == 0 ? cam.posY + farDist * rayDirY : cam.posX + farDist * rayDirX;
+            wallX -= floorf(wallX);
+            int texX = std::min(int(wallX * texW), texW - 1);
+            if (side == 0 && rayDirX > 0) texX = texW - texX - 1;
+            if (side == 1 && rayDirY < 0) texX = texW - texX - 1;
+            uint8_t value = world.get(mapX, mapY);
+            size_t column = (value ? wallOffset[value] : floorOffset[world.floors[next]]) + (size_t)texX * texH;
+            int face = side * 2 + ((side == 0 ? rayDirX : rayDirY) >= 0 ? 0 : 1);
+            int light = lightMap ? lightMap->faceLevel(mapX, mapY, face) : 255;
+            int fog = fogFloat(farDist);
+            float zStep = farDist / h;
+
+            // lower face: step up to the next floor
+            if (nf > cf)
+            {
+                int r0 = std::max(rowAt(std::min(nf, cc), farDist), top);
+                int r1 = std::min(rowAt(cf, farDist), bottom);
+                for (int r = r0; r < r1; r++)
+                {
+                    float z = eyeZ + (halfH - r) * zStep;
+                    int texY = int(floorf((1.f - z) * texH)) & (texH - 1);
+                    fb[(size_t)r * w + x] = shadeTexel(column + texY, light, fog);
+                    writes++;
+                }
+                if (r0 < bottom)
+                    bottom = std::max(r0, top);
+            }
+            // upper face: step down to the next ceiling
+            if (nc < cc && top < bottom)
+            {
+                int r0 = std::max(rowAt(cc, farDist), top);
+                int r1 = std::min(rowAt(std::max(nc, cf), farDist), bottom);
+                for (int r = r0; r < r1; r++)
+                {
+                    float z = eyeZ + (halfH - r) * zStep;
+                    int texY = int(floorf((1.f - z) * texH)) & (texH - 1);
+                    fb[(size_t)r * w + x] = shadeTexel(column + texY, light, fog);
+                    writes++;
+                }
+                if (r1 > top)
+                    top = std::min(r1, bottom);
+            }
+            if (zbuffer[x] >= settings.maxDistance)
+                zbuffer[x] = farDist;
+        }
+        if (blocked) {
+            if (visibleSet) {
+                marker.cell((long long)world.occBit(mapX, mapY));
+                visibleSet->columnFaces[x] = hitFace(mapX, mapY, side, (side == 0 ? rayDirX : rayDirY) >= 0, 1);
+            }
+            break;
+        }
+        cur = next;
+        nearDist = farDist;
+    }
+
+    for (int r = top; r < bottom; r++)
+    {
+        fb[(size_t)r * w + x] = fogPacked;
+        writes++;
+    }
+    columnCells[x] = cells;
+    columnWrites[x] = writes;
+}
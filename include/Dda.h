@@ -0,0 +1,269 @@
+#pragma once
+
+#include <math.h>
+#include <cstdint>
+
+#include "WorldMap.h"
+
+// CPU version of the traversal in compute.glsl. The cell address is carried
+// along with mapX/mapY and moved with the layout's step functions, so a step
+// never recomputes x * h + y (or the morton/tile address) from scratch.
+
+struct RayHit
+{
+    float perpWallDist;
+    int mapX, mapY;
+    int side;      // 0: x side (NS), 1: y side (EW)
+    uint8_t cell;  // 0 if the ray left the map or ran past maxDist
+    int steps;
+};
+
+template <typename Layout>
+RayHit castRayLayout(const WorldMap &world, const Layout &layout, float posX, float posY, float rayDirX, float rayDirY, float maxDist)
+{
+    RayHit hit;
+    const uint8_t *cells = world.cells.data();
+
+    int mapX = int(posX);
+    int mapY = int(posY);
+
+    float deltaDistX = (rayDirX == 0) ? 1e30f : fabsf(1 / rayDirX);
+    float deltaDistY = (rayDirY == 0) ? 1e30f : fabsf(1 / rayDirY);
+
+    int stepX, stepY;
+    float sideDistX, sideDistY;
+    if (rayDirX < 0) {
+        stepX = -1;
+        sideDistX = (posX - mapX) * deltaDistX;
+    } else {
+        stepX = 1;
+        sideDistX = (mapX + 1.0f - posX) * deltaDistX;
+    }
+    if (rayDirY < 0) {
+        stepY = -1;
+        sideDistY = (posY - mapY) * deltaDistY;
+    } else {
+        stepY = 1;
+        sideDistY = (mapY + 1.0f - posY) * deltaDistY;
+    }
+
+    size_t idx = layout.index(mapX, mapY);
+    int side = 0;
+    int steps = 0;
+    uint8_t cell = 0;
+    while (true)
+    {
+        if ((sideDistX < sideDistY ? sideDistX : sideDistY) > maxDist) {
+            side = -1;
+            break;
+        }
+        //jump to next map square, either in x-direction, or in y-direction
+        if (sideDistX < sideDistY) {
+            sideDistX += deltaDistX;
+            idx = layout.stepX(idx, mapX, stepX);
+            mapX += stepX;
+            side = 0;
+        } else {
+            sideDistY += deltaDistY;
+            idx = layout.stepY(idx, mapY, stepY);
+            mapY += stepY;
+            side = 1;
+        }
+        steps++;
+        if (!world.inside(mapX, mapY))
+            break;
+        cell = cells[idx];
+        if (cell > 0)
+            break;
+    }
+
+    if (side < 0) {
+        // ran out of distance, report the cut off point
+        hit.perpWallDist = maxDist;
+        side = sideDistX < sideDistY ? 0 : 1;
+    } else {
+        hit.perpWallDist = side == 0 ? sideDistX - deltaDistX : sideDistY - deltaDistY;
+    }
+    hit.mapX = mapX;
+    hit.mapY = mapY;
+    hit.side = side;
+    hit.cell = cell;
+    hit.steps = steps;
+    return hit;
+}
+
+RayHit castRay(const WorldMap &world, float posX, float posY, float rayDirX, float rayDirY, float maxDist = 1e30f)
+{
+    switch (world.layout) {
+        case MAP_LAYOUT_TILED: return castRayLayout(world, world.tiled, posX, posY, rayDirX, rayDirY, maxDist);
+        case MAP_LAYOUT_MORTON: return castRayLayout(world, world.morton, posX, posY, rayDirX, rayDirY, maxDist);
+        default: return castRayLayout(world, world.row, posX, posY, rayDirX, rayDirY, maxDist);
+    }
+}
+
+// Plane of a thin wall cell against the ray, between the distances where
+// the ray enters and leaves the cell. True when it hits the closed part of
+// the panel; dist and side are then the plane's.
+static inline bool thinWallHit(const WorldMap &world, int mapX, int mapY, uint8_t cell, float posX, float posY,
+                               float rayDirX, float rayDirY, float enter, float exit, float &dist, int &side)
+{
+    const ThinWall &t = world.thin[cell];
+    float along;
+    if (t.axis == THIN_X) {
+        if (rayDirX == 0)
+            return false;
+        dist = (mapX + t.offset - posX) / rayDirX;
+        along = posY + dist * rayDirY - mapY;
+        side = 0;
+    } else {
+        if (rayDirY == 0)
+            return false;
+        dist = (mapY + t.offset - posY) / rayDirY;
+        along = posX + dist * rayDirX - mapX;
+        side = 1;
+    }
+    return dist >= enter && dist <= exit && along >= world.openAt(mapX, mapY);
+}
+
+// Visitors see every cell the occupancy traversal enters, as plane bit
+// indices: cell() for single steps and run() for a skipped run of n cells
+// starting after `bit` in direction stepY (always inside one word).
+// through() is asked on every solid cell; returning true keeps the ray
+// going (masked and translucent walls), false ends it there.
+struct NoVisit
+{
+    void cell(long long bit) { (void)bit; }
+    void run(long long bit, int n, int stepY) { (void)bit; (void)n; (void)stepY; }
+    bool through(int mapX, int mapY, int side, float dist, uint8_t cell) { (void)mapX; (void)mapY; (void)side; (void)dist; (void)cell; return false; }
+};
+
+// Same traversal over the occupancy plane. Each load brings in 64 cells of
+// the current x row, so after an empty cell the run of empty cells ahead in
+// y is counted with one ctz/clz and those y steps are taken without touching
+// memory. The material byte is only fetched on the hit. Results match
+// castRay() step for step, except that thin wall cells (doors) are only hit
+// where their plane is closed.
+template <typename Visitor>
+RayHit castRayOccupancyVisit(const WorldMap &world, float posX, float posY, float rayDirX, float rayDirY, float maxDist, Visitor &visit)
+{
+    RayHit hit;
+    const uint64_t *occ = world.occupancy.data();
+    const long long rowBits = (long long)world.occRowBits;
+
+    int mapX = int(posX);
+    int mapY = int(posY);
+
+    float deltaDistX = (rayDirX == 0) ? 1e30f : fabsf(1 / rayDirX);
+    float deltaDistY = (rayDirY == 0) ? 1e30f : fabsf(1 / rayDirY);
+
+    int stepX, stepY;
+    float sideDistX, sideDistY;
+    if (rayDirX < 0) {
+        stepX = -1;
+        sideDistX = (posX - mapX) * deltaDistX;
+    } else {
+        stepX = 1;
+        sideDistX = (mapX + 1.0f - posX) * deltaDistX;
+    }
+    if (rayDirY < 0) {
+        stepY = -1;
+        sideDistY = (posY - mapY) * deltaDistY;
+    } else {
+        stepY = 1;
+        sideDistY = (mapY + 1.0f - posY) * deltaDistY;
+    }
+
+    long long bit = (long long)mapX * rowBits + mapY;
+    int side = 0;
+    int steps = 0;
+    uint8_t cell = 0;
+    float hitDist = 0.f;
+    if (world.inside(mapX, mapY))
+        visit.cell(bit);
+    while (true)
+    {
+        if ((sideDistX < sideDistY ? sideDistX : sideDistY) > maxDist) {
+            side = -1;
+            break;
+        }
+        if (sideDistX < sideDistY) {
+            sideDistX += deltaDistX;
+            mapX += stepX;
+            bit += stepX > 0 ? rowBits : -rowBits;
+            side = 0;
+        } else {
+            sideDistY += deltaDistY;
+            mapY += stepY;
+            bit += stepY;
+            side = 1;
+        }
+        steps++;
+        if (!world.inside(mapX, mapY))
+            break;
+        visit.cell(bit);
+
+        uint64_t word = occ[bit >> 6];
+        int b = (int)(bit & 63);
+        if ((word >> b) & 1) {
+            cell = world.get(mapX, mapY);
+            float dist = side == 0 ? sideDistX - deltaDistX : sideDistY - deltaDistY;
+            int hitSide = side;
+            bool solid = world.thin[cell].axis == THIN_NONE ||
+                         thinWallHit(world, mapX, mapY, cell, posX, posY, rayDirX, rayDirY, dist,
+                                     sideDistX < sideDistY ? sideDistX : sideDistY, dist, hitSide);
+            if (solid && !visit.through(mapX, mapY, hitSide, dist, cell)) {
+                hitDist = dist;
+                side = hitSide;
+                break;
+            }
+            cell = 0;
+            continue;
+        }
+
+        // empty cells ahead of us in this word, clipped to the map edge
+        int run;
+        if (stepY > 0) {
+            uint64_t ahead = b == 63 ? 0 : word >> (b + 1);
+            run = ahead ? ctz64(ahead) : 63 - b;
+            if (run > world.h - 1 - mapY) run = world.h - 1 - mapY;
+        } else {
+            uint64_t behind = b == 0 ? 0 : word << (64 - b);
+            run = behind ? clz64(behind) : b;
+            if (run > mapY) run = mapY;
+        }
+        long long runFrom = bit;
+        int taken = 0;
+        while (taken < run && !(sideDistX < sideDistY) && sideDistY <= maxDist) {
+            sideDistY += deltaDistY;
+            mapY += stepY;
+            bit += stepY;
+            side = 1;
+            taken++;
+        }
+        steps += taken;
+        if (taken)
+            visit.run(runFrom, taken, stepY);
+    }
+
+    if (side < 0) {
+        // ran out of distance, report the cut off point
+        hit.perpWallDist = maxDist;
+        side = sideDistX < sideDistY ? 0 : 1;
+    } else if (cell) {
+        hit.perpWallDist = hitDist;
+    } else {
+        hit.perpWallDist = side == 0 ? sideDistX - deltaDistX : sideDistY - deltaDistY;
+    }
+    hit.mapX = mapX;
+    hit.mapY = mapY;
+    hit.side = side;
+    hit.cell = cell;
+    hit.steps = steps;
+    return hit;
+}
+
+RayHit castRayOccupancy(const WorldMap &world, float posX, float posY, float rayDirX, float rayDirY, float maxDist = 1e30f)
+{
+    NoVisit none;
+    return castRayOccupancyVisit(world, posX, posY, rayDirX, rayDirY, maxDist, none);
+}
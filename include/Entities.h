@@ -0,0 +1,124 @@
+#pragma once
+
+#include <vector>
+#include <algorithm>
+
+#include "WorldMap.h"
+#include "ThreadPool.h"
+
+// outside the map counts as a wall, open doors do not
+static inline bool cellBlocked(const WorldMap &world, int x, int y)
+{
+    return !world.inside(x, y) || (world.solid(x, y) && !world.passable(x, y));
+}
+
+// Collision rule of Game::move: try the x move, then the y move from the new
+// x, each one only if the cell it ends in is free. radius pushes the probe
+// out to the leading edge; with radius 0 it is exactly the player rule.
+// Returns the blocked axes, bit 0 for x and bit 1 for y.
+static inline int slideMove(const WorldMap &world, float &posX, float &posY, float dx, float dy, float radius)
+{
+    int blocked = 0;
+    float probeX = posX + dx + (dx > 0 ? radius : (dx < 0 ? -radius : 0.f));
+    if (!cellBlocked(world, int(probeX), int(posY)))
+        posX += dx;
+    else
+        blocked |= 1;
+    float probeY = posY + dy + (dy > 0 ? radius : (dy < 0 ? -radius : 0.f));
+    if (!cellBlocked(world, int(posX), int(probeY)))
+        posY += dy;
+    else
+        blocked |= 2;
+    return blocked;
+}
+
+#define ENTITY_BATCH 16
+
+// Structure of arrays store for moving actors. update() integrates
+// velocity and applies slideMove()'s rule to every entity, split across the
+// thread pool and processed ENTITY_BATCH at a time: the arithmetic runs as
+// plain loops over the batch (vectorised by the compiler) and only the map
+// lookups are per entity. A blocked axis also zeroes that velocity component.
+class EntityStore
+{
+public:
+    std::vector<float> posX, posY;
+    std::vector<float> dirX, dirY;
+    std::vector<float> velX, velY;
+    std::vector<float> radius;
+
+    int size() const { return (int)posX.size(); }
+    int add(float x, float y, float dx, float dy, float vx, float vy, float r);
+    void remove(int i); // swaps the last entity into slot i
+    void clear();
+    void update(const WorldMap &world, float dt, ThreadPool *pool);
+};
+
+int EntityStore::add(float x, float y, float dx, float dy, float vx, float vy, float r)
+{
+    posX.push_back(x);
+    posY.push_back(y);
+    dirX.push_back(dx);
+    dirY.push_back(dy);
+    velX.push_back(vx);
+    velY.push_back(vy);
+    radius.push_back(r);
+    return size() - 1;
+}
+
+void EntityStore::remove(int i)
+{
+    int last = size() - 1;
+    posX[i] = posX[last]; posX.pop_back();
+    posY[i] = posY[last]; posY.pop_back();
+    dirX[i] = dirX[last]; dirX.pop_back();
+    dirY[i] = dirY[last]; dirY.pop_back();
+    velX[i] = velX[last]; velX.pop_back();
+    velY[i] = velY[last]; velY.pop_back();
+    radius[i] = radius[last]; radius.pop_back();
+}
+
+void EntityStore::clear()
+{
+    posX.clear(); posY.clear();
+    dirX.clear(); dirY.clear();
+    velX.clear(); velY.clear();
+    radius.clear();
+}
+
+void EntityStore::update(const WorldMap &world, float dt, ThreadPool *pool)
+{
+    float *px = posX.data(), *py = posY.data();
+    float *vx = velX.data(), *vy = velY.data();
+    const float *r = radius.data();
+
+    pool->parallelFor(size(), 4096, [&](int begin, int end) {
+        float dx[ENTITY_BATCH], dy[ENTITY_BATCH], probe[ENTITY_BATCH];
+        bool ok[ENTITY_BATCH];
+        for (int base = begin; base < end; base += ENTITY_BATCH)
+        {
+            int n = std::min(ENTITY_BATCH, end - base);
+            float *bx = px + base, *by = py + base, *bvx = vx + base, *bvy = vy + base;
+            const float *br = r + base;
+
+            for (int k = 0; k < n; k++) {
+                dx[k] = bvx[k] * dt;
+                dy[k] = bvy[k] * dt;
+                probe[k] = bx[k] + dx[k] + (dx[k] > 0 ? br[k] : (dx[k] < 0 ? -br[k] : 0.f));
+            }
+            for (int k = 0; k < n; k++)
+                ok[k] = !cellBlocked(world, int(probe[k]), int(by[k]));
+            for (int k = 0; k < n; k++) {
+                bx[k] = ok[k] ? bx[k] + dx[k] : bx[k];
+                bvx[k] = ok[k] ? bvx[k] : 0.f;
+                probe[k] = by[k] + dy[k] + (dy[k] > 0 ? br[k] : (dy[k] < 0 ? -br[k] : 0.f));
+            }
+            for (int k = 0; k < n; k++)
+                ok[k] = !cellBlocked(world, int(bx[k]), int(probe[k]));
+            for (int k = 0; k < n; k++) {
+                by[k] = ok[k] ? by[k] + dy[k] : by[k];
+                bvy[k] = ok[k] ? bvy[k] : 0.f;
+            }
+        }
+    });
+}
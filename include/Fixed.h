@@ -0,0 +1,138 @@
+#pragma once
+
+#include <cstdint>
+#include <math.h>
+
+#include "WorldMap.h"
+#include "Dda.h"
+
+// 16.16 fixed point traversal. Everything after the camera is converted is
+// integer math, so a given FixedCamera produces the same hits and the same
+// pixels on every compiler, CPU and thread count. Products are done in 64
+// bits and shifted back (arithmetic shift on every compiler we ship with).
+
+typedef int32_t fixed;
+#define FX_SHIFT 16
+#define FX_ONE (1 << FX_SHIFT)
+#define FX_FRAC (FX_ONE - 1)
+#define FX_FAR ((int64_t)1 << 46) // stands in for the shader's 1e30
+
+static inline fixed toFixed(float v) { return (fixed)lrintf(v * FX_ONE); }
+static inline float fromFixed(int64_t v) { return (float)v / FX_ONE; }
+static inline int64_t fxMul(int64_t a, int64_t b) { return (a * b) >> FX_SHIFT; }
+
+struct FixedCamera
+{
+    fixed posX, posY;
+    fixed dirX, dirY;
+    fixed planeX, planeY;
+};
+
+struct FixedRayHit
+{
+    int64_t perpWallDist; // 16.16
+    int mapX, mapY;
+    int side;
+    uint8_t cell;
+    int steps;
+};
+
+FixedCamera toFixedCamera(float posX, float posY, float dirX, float dirY, float planeX, float planeY)
+{
+    FixedCamera cam;
+    cam.posX = toFixed(posX);
+    cam.posY = toFixed(posY);
+    cam.dirX = toFixed(dirX);
+    cam.dirY = toFixed(dirY);
+    cam.planeX = toFixed(planeX);
+    cam.planeY = toFixed(planeY);
+    return cam;
+}
+
+// |1 / d| in 16.16
+static inline int64_t fxDeltaDist(fixed d)
+{
+    if (d == 0)
+        return FX_FAR;
+    int64_t r = ((int64_t)1 << (2 * FX_SHIFT)) / d;
+    return r < 0 ? -r : r;
+}
+
+// Visitor sees every cell entered as an occupancy bit index, like
+// castRayOccupancyVisit() (single cells only, no runs here).
+template <typename Visitor>
+FixedRayHit castRayFixedVisit(const WorldMap &world, fixed posX, fixed posY, fixed rayDirX, fixed rayDirY, int64_t maxDist, Visitor &visit)
+{
+    FixedRayHit hit;
+    int mapX = posX >> FX_SHIFT;
+    int mapY = posY >> FX_SHIFT;
+
+    int64_t deltaDistX = fxDeltaDist(rayDirX);
+    int64_t deltaDistY = fxDeltaDist(rayDirY);
+
+    int stepX, stepY;
+    int64_t sideDistX, sideDistY;
+    if (rayDirX < 0) {
+        stepX = -1;
+        sideDistX = fxMul(posX & FX_FRAC, deltaDistX);
+    } else {
+        stepX = 1;
+        sideDistX = fxMul(FX_ONE - (posX & FX_FRAC), deltaDistX);
+    }
+    if (rayDirY < 0) {
+        stepY = -1;
+        sideDistY = fxMul(posY & FX_FRAC, deltaDistY);
+    } else {
+        stepY = 1;
+        sideDistY = fxMul(FX_ONE - (posY & FX_FRAC), deltaDistY);
+    }
+
+    int side = 0;
+    int steps = 0;
+    uint8_t cell = 0;
+    if (world.inside(mapX, mapY))
+        visit.cell((long long)world.occBit(mapX, mapY));
+    while (true)
+    {
+        if ((sideDistX < sideDistY ? sideDistX : sideDistY) > maxDist) {
+            side = -1;
+            break;
+        }
+        if (sideDistX < sideDistY) {
+            sideDistX += deltaDistX;
+            mapX += stepX;
+            side = 0;
+        } else {
+            sideDistY += deltaDistY;
+            mapY += stepY;
+            side = 1;
+        }
+        steps++;
+        if (!world.inside(mapX, mapY))
+            break;
+        visit.cell((long long)world.occBit(mapX, mapY));
+        if (world.solid(mapX, mapY)) {
+            cell = world.get(mapX, mapY);
+            break;
+        }
+    }
+
+    if (side < 0) {
+        hit.perpWallDist = maxDist;
+        side = sideDistX < sideDistY ? 0 : 1;
+    } else {
+        hit.perpWallDist = side == 0 ? sideDistX - deltaDistX : sideDistY - deltaDistY;
+    }
+    hit.mapX = mapX;
+    hit.mapY = mapY;
+    hit.side = side;
+    hit.cell = cell;
+    hit.steps = steps;
+    return hit;
+}
+
+FixedRayHit castRayFixed(const WorldMap &world, fixed posX, fixed posY, fixed rayDirX, fixed rayDirY, int64_t maxDist = FX_FAR)
+{
+    NoVisit none;
+    return castRayFixedVisit(world, posX, posY, rayDirX, rayDirY, maxDist, none);
+}
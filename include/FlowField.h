@@ -0,0 +1,688 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+#include <array>
+#include <queue>
+#include <unordered_map>
+#include <algorithm>
+#include <functional>
+
+#include "WorldMap.h"
+#include "ThreadPool.h"
+
+// Hierarchical flow fields for steering many agents to shared goals.
+//
+// The map is cut into FLOW_CHUNK x FLOW_CHUNK chunks. Every maximal run of
+// open cells across a chunk border is a portal, with one node on each side
+// at the middle of the run. Each chunk keeps the BFS distances between its
+// own nodes (built in parallel when given a pool). A goal is solved on that small node graph first (Dijkstra,
+// seeded from a BFS inside the goal's chunk); the per cell flow of a chunk
+// is only built the first time an agent in that chunk asks for it, from
+// the costs of that chunk's nodes.
+//
+// A cell edit rebuilds the four borders of its chunk and the node tables of
+// that chunk and its four neighbours. Each cached goal keeps the node its
+// cost came through; only the nodes of the rebuilt chunks and the nodes
+// whose path ran through them are solved again, and only the chunk flows
+// whose chunk was rebuilt or whose exits changed are dropped.
+//
+// Goals live in an LRU cache bounded by budgetBytes. goal() hands out a
+// FlowGoalId, not the goal itself: direction() looks it up on every call
+// and solves the goal again if the cache dropped it in between.
+
+#define FLOW_CHUNK 64
+#define FLOW_INF 0x3fffffff
+
+// per cell directions
+#define FLOW_NONE 0
+#define FLOW_POS_X 1
+#define FLOW_NEG_X 2
+#define FLOW_POS_Y 3
+#define FLOW_NEG_Y 4
+
+static inline void flowVector(uint8_t dir, int &dx, int &dy)
+{
+    static const int tx[5] = {0, 1, -1, 0, 0};
+    static const int ty[5] = {0, 0, 0, 1, -1};
+    dx = tx[dir];
+    dy = ty[dir];
+}
+
+struct FlowNode
+{
+    int x, y;
+    uint8_t exitDir;          // step that crosses the border to the mate
+    int mateChunk, mateIndex;
+};
+
+typedef int64_t FlowGoalId; // gx * h + gy
+
+struct FlowGoal
+{
+    int gx, gy;
+    std::vector<int> nodeCost;                   // per global node
+    std::vector<int> nodeParent;                 // node the cost came through, -1 in the goal's chunk
+    std::vector<std::vector<uint8_t>> chunkDirs; // per chunk, empty until used
+    std::vector<uint64_t> chunkSeedHash;         // inputs each chunk flow was built from
+    size_t flowBytes = 0;                        // sum of the chunkDirs sizes
+    uint64_t lastUse = 0;
+
+    size_t bytes() const
+    {
+        return (nodeCost.size() + nodeParent.size()) * sizeof(int) +
+               chunkDirs.size() * (sizeof(std::vector<uint8_t>) + sizeof(uint64_t)) + flowBytes;
+    }
+};
+
+class FlowFields
+{
+private:
+    struct PortalRun { int start, len; };
+
+    const WorldMap *world = NULL;
+    int chunksX = 0, chunksY = 0;
+    std::vector<std::vector<PortalRun>> xBorders; // between (cx, cy) and (cx + 1, cy)
+    std::vector<std::vector<PortalRun>> yBorders; // between (cx, cy) and (cx, cy + 1)
+    std::vector<std::vector<FlowNode>> chunkNodes;
+    std::vector<std::array<int, 5>> borderStart;  // west, east, south, north, end
+    std::vector<std::vector<int>> chunkDist;      // n * n per chunk
+    std::vector<int> nodeOffset;                  // global id of a chunk's first node
+    std::vector<int> nodeChunk;                   // chunk of a global node
+    int nodeCount = 0;
+
+    std::unordered_map<FlowGoalId, FlowGoal> goals;
+    uint64_t useClock = 0;
+
+    typedef std::pair<int, int> QueueItem; // cost, global node
+    typedef std::priority_queue<QueueItem, std::vector<QueueItem>, std::greater<QueueItem>> Queue;
+
+    bool open(int x, int y) const { return world->inside(x, y) && !world->solid(x, y); }
+    int chunkOf(int x, int y) const { return (x / FLOW_CHUNK) * chunksY + y / FLOW_CHUNK; }
+
+    void buildBorderX(int cx, int cy);
+    void buildBorderY(int cx, int cy);
+    void buildChunkNodes(int c);
+    void buildChunkDist(int c);
+    void linkMates();
+    void chunkOpen(int c, std::vector<uint8_t> &mask) const;
+    void chunkBfs(const std::vector<uint8_t> &mask, std::vector<std::pair<int, int>> seeds, std::vector<int> &cost) const;
+    void goalNodes(const FlowGoal &goal, std::vector<std::pair<int, int>> &seeds) const;
+    void propagate(FlowGoal &goal, Queue &queue);
+    void solveGoal(FlowGoal &goal);
+    void repairGoal(FlowGoal &goal, const std::vector<char> &dirty, const std::vector<int> &oldOffset);
+    uint64_t chunkSeeds(const FlowGoal &goal, int c, std::vector<std::pair<int, int>> &seeds) const;
+    void buildChunkFlow(FlowGoal &goal, int c);
+    FlowGoal &acquire(FlowGoalId id);
+    void enforceBudget(FlowGoalId keep);
+
+public:
+    size_t budgetBytes = 64 << 20;
+
+    // stats
+    int chunkFlowsBuilt = 0, goalsSolved = 0, goalsRepaired = 0, goalsEvicted = 0;
+
+    void build(const WorldMap &_world, ThreadPool *pool = NULL);
+    FlowGoalId goal(int gx, int gy);
+    uint8_t direction(FlowGoalId goal, int x, int y);
+    void onCellsChanged(int x0, int y0, int x1, int y1); // inclusive cell rect
+    size_t cachedBytes() const;
+    int nodes() const { return nodeCount; }
+};
+
+void FlowFields::build(const WorldMap &_world, ThreadPool *pool)
+{
+    world = &_world;
+    chunksX = (world->w + FLOW_CHUNK - 1) / FLOW_CHUNK;
+    chunksY = (world->h + FLOW_CHUNK - 1) / FLOW_CHUNK;
+    int chunks = chunksX * chunksY;
+    xBorders.assign(chunks, std::vector<PortalRun>());
+    yBorders.assign(chunks, std::vector<PortalRun>());
+    chunkNodes.assign(chunks, std::vector<FlowNode>());
+    borderStart.assign(chunks, std::array<int, 5>());
+    chunkDist.assign(chunks, std::vector<int>());
+    goals.clear();
+
+    for (int cx = 0; cx < chunksX; cx++)
+        for (int cy = 0; cy < chunksY; cy++)
+        {
+            buildBorderX(cx, cy);
+            buildBorderY(cx, cy);
+        }
+    for (int c = 0; c < chunks; c++)
+        buildChunkNodes(c);
+    linkMates();
+    if (pool)
+        pool->parallelFor(chunks, 4, [&](int begin, int end) {
+            for (int c = begin; c < end; c++)
+                buildChunkDist(c);
+        });
+    else
+        for (int c = 0; c < chunks; c++)
+            buildChunkDist(c);
+}
+
+void FlowFields::buildBorderX(int cx, int cy)
+{
+    std::vector<PortalRun> &runs = xBorders[cx * chunksY + cy];
+    runs.clear();
+    if (cx + 1 >= chunksX)
+        return;
+    int xa = (cx + 1) * FLOW_CHUNK - 1;
+    int y0 = cy * FLOW_CHUNK, y1 = std::min(y0 + FLOW_CHUNK, world->h);
+    for (int y = y0; y < y1;)
+    {
+        if (!open(xa, y) || !open(xa + 1, y)) {
+            y++;
+            continue;
+        }
+        int start = y;
+        while (y < y1 && open(xa, y) && open(xa + 1, y))
+            y++;
+        runs.push_back({start, y - start});
+    }
+}
+
+void FlowFields::buildBorderY(int cx, int cy)
+{
+    std::vector<PortalRun> &runs = yBorders[cx * chunksY + cy];
+    runs.clear();
+    if (cy + 1 >= chunksY)
+        return;
+    int ya = (cy + 1) * FLOW_CHUNK - 1;
+    int x0 = cx * FLOW_CHUNK, x1 = std::min(x0 + FLOW_CHUNK, world->w);
+    for (int x = x0; x < x1;)
+    {
+        if (!open(x, ya) || !open(x, ya + 1)) {
+            x++;
+            continue;
+        }
+        int start = x;
+        while (x < x1 && open(x, ya) && open(x, ya + 1))
+            x++;
+        runs.push_back({start, x - start});
+    }
+}
+
+// node order: west, east, south, north borders, portals in run order
+void FlowFields::buildChunkNodes(int c)
+{
+    int cx = c / chunksY, cy = c % chunksY;
+    std::vector<FlowNode> &nodes = chunkNodes[c];
+    std::array<int, 5> &start = borderStart[c];
+    nodes.clear();
+
+    start[0] = 0;
+    if (cx > 0)
+        for (const PortalRun &r : xBorders[(cx - 1) * chunksY + cy])
+            nodes.push_back({cx * FLOW_CHUNK, r.start + r.len / 2, FLOW_NEG_X, c - chunksY, 0});
+    start[1] = (int)nodes.size();
+    for (const PortalRun &r : xBorders[c])
+        nodes.push_back({(cx + 1) * FLOW_CHUNK - 1, r.start + r.len / 2, FLOW_POS_X, c + chunksY, 0});
+    start[2] = (int)nodes.size();
+    if (cy > 0)
+        for (const PortalRun &r : yBorders[c - 1])
+            nodes.push_back({r.start + r.len / 2, cy * FLOW_CHUNK, FLOW_NEG_Y, c - 1, 0});
+    start[3] = (int)nodes.size();
+    for (const PortalRun &r : yBorders[c])
+        nodes.push_back({r.start + r.len / 2, (cy + 1) * FLOW_CHUNK - 1, FLOW_POS_Y, c + 1, 0});
+    start[4] = (int)nodes.size();
+}
+
+// mate of west portal k is east portal k of the chunk before, and so on
+void FlowFields::linkMates()
+{
+    int chunks = chunksX * chunksY;
+    nodeOffset.resize(chunks + 1);
+    nodeCount = 0;
+    for (int c = 0; c < chunks; c++)
+    {
+        nodeOffset[c] = nodeCount;
+        nodeCount += (int)chunkNodes[c].size();
+        const std::array<int, 5> &start = borderStart[c];
+        for (int g = 0; g < 4; g++)
+        {
+            int mateGroup = g ^ 1;
+            for (int k = start[g]; k < start[g + 1]; k++)
+            {
+                FlowNode &n = chunkNodes[c][k];
+                n.mateIndex = borderStart[n.mateChunk][mateGroup] + (k - start[g]);
+            }
+        }
+    }
+    nodeOffset[chunks] = nodeCount;
+    nodeChunk.resize(nodeCount);
+    for (int c = 0; c < chunks; c++)
+        std::fill(nodeChunk.begin() + nodeOffset[c], nodeChunk.begin() + nodeOffset[c + 1], c);
+}
+
+// open cells of chunk c, local index lx * FLOW_CHUNK + ly; cells past the
+// map edge stay closed
+void FlowFields::chunkOpen(int c, std::vector<uint8_t> &mask) const
+{
+    int x0 = (c / chunksY) * FLOW_CHUNK, y0 = (c % chunksY) * FLOW_CHUNK;
+    int cw = std::min(FLOW_CHUNK, world->w - x0), ch = std::min(FLOW_CHUNK, world->h - y0);
+    mask.assign(FLOW_CHUNK * FLOW_CHUNK, 0);
+    for (int lx = 0; lx < cw; lx++)
+        for (int ly = 0; ly < ch; ly++)
+            mask[lx * FLOW_CHUNK + ly] = !world->solid(x0 + lx, y0 + ly);
+}
+
+// multi source BFS inside one chunk; seeds are (local cell, cost). Every
+// step costs 1, so a FIFO stays sorted by cost and the seeds (sorted up
+// front) only have to be merged in when the frontier reaches their cost.
+void FlowFields::chunkBfs(const std::vector<uint8_t> &mask, std::vector<std::pair<int, int>> seeds, std::vector<int> &cost) const
+{
+    cost.assign(FLOW_CHUNK * FLOW_CHUNK, FLOW_INF);
+    std::sort(seeds.begin(), seeds.end(), [](const std::pair<int, int> &a, const std::pair<int, int> &b) {
+        return a.second < b.second;
+    });
+
+    int queue[FLOW_CHUNK * FLOW_CHUNK];
+    int head = 0, tail = 0;
+    size_t next = 0;
+    for (;;)
+    {
+        int frontier = head < tail ? cost[queue[head]] : (next < seeds.size() ? seeds[next].second : FLOW_INF);
+        while (next < seeds.size() && seeds[next].second <= frontier)
+        {
+            const std::pair<int, int> &seed = seeds[next++];
+            if (seed.second < cost[seed.first]) {
+                cost[seed.first] = seed.second;
+                queue[tail++] = seed.first;
+            }
+        }
+        if (head == tail)
+            break;
+        int idx = queue[head++];
+        int d = cost[idx] + 1;
+        int ly = idx & (FLOW_CHUNK - 1);
+        if (idx >= FLOW_CHUNK && mask[idx - FLOW_CHUNK] && d < cost[idx - FLOW_CHUNK]) {
+            cost[idx - FLOW_CHUNK] = d;
+            queue[tail++] = idx - FLOW_CHUNK;
+        }
+        if (idx + FLOW_CHUNK < FLOW_CHUNK * FLOW_CHUNK && mask[idx + FLOW_CHUNK] && d < cost[idx + FLOW_CHUNK]) {
+            cost[idx + FLOW_CHUNK] = d;
+            queue[tail++] = idx + FLOW_CHUNK;
+        }
+        if (ly > 0 && mask[idx - 1] && d < cost[idx - 1]) {
+            cost[idx - 1] = d;
+            queue[tail++] = idx - 1;
+        }
+        if (ly < FLOW_CHUNK - 1 && mask[idx + 1] && d < cost[idx + 1]) {
+            cost[idx + 1] = d;
+            queue[tail++] = idx + 1;
+        }
+    }
+}
+
+void FlowFields::buildChunkDist(int c)
+{
+    const std::vector<FlowNode> &nodes = chunkNodes[c];
+    int n = (int)nodes.size();
+    int x0 = (c / chunksY) * FLOW_CHUNK, y0 = (c % chunksY) * FLOW_CHUNK;
+    std::vector<int> &dist = chunkDist[c];
+    dist.assign(n * n, FLOW_INF);
+    std::vector<uint8_t> mask;
+    std::vector<int> cost;
+    chunkOpen(c, mask);
+    for (int i = 0; i < n; i++)
+    {
+        chunkBfs(mask, {{(nodes[i].x - x0) * FLOW_CHUNK + (nodes[i].y - y0), 0}}, cost);
+        for (int j = 0; j < n; j++)
+            dist[i * n + j] = cost[(nodes[j].x - x0) * FLOW_CHUNK + (nodes[j].y - y0)];
+    }
+}
+
+// goal chunk nodes the goal reaches inside its own chunk, with their costs
+void FlowFields::goalNodes(const FlowGoal &goal, std::vector<std::pair<int, int>> &seeds) const
+{
+    seeds.clear();
+    int gc = chunkOf(goal.gx, goal.gy);
+    int x0 = (gc / chunksY) * FLOW_CHUNK, y0 = (gc % chunksY) * FLOW_CHUNK;
+    std::vector<uint8_t> mask;
+    std::vector<int> cost;
+    chunkOpen(gc, mask);
+    chunkBfs(mask, {{(goal.gx - x0) * FLOW_CHUNK + (goal.gy - y0), 0}}, cost);
+    for (int i = 0; i < (int)chunkNodes[gc].size(); i++)
+    {
+        const FlowNode &n = chunkNodes[gc][i];
+        int d = cost[(n.x - x0) * FLOW_CHUNK + (n.y - y0)];
+        if (d < FLOW_INF)
+            seeds.push_back({nodeOffset[gc] + i, d});
+    }
+}
+
+// Dijkstra on the node graph from the queued nodes
+void FlowFields::propagate(FlowGoal &goal, Queue &queue)
+{
+    while (!queue.empty())
+    {
+        QueueItem top = queue.top();
+        queue.pop();
+        int id = top.second;
+        if (top.first != goal.nodeCost[id])
+            continue;
+        int c = nodeChunk[id];
+        int i = id - nodeOffset[c];
+        int n = (int)chunkNodes[c].size();
+
+        // across the border
+        const FlowNode &node = chunkNodes[c][i];
+        int mate = nodeOffset[node.mateChunk] + node.mateIndex;
+        if (top.first + 1 < goal.nodeCost[mate]) {
+            goal.nodeCost[mate] = top.first + 1;
+            goal.nodeParent[mate] = id;
+            queue.push({top.first + 1, mate});
+        }
+        // inside the chunk
+        for (int j = 0; j < n; j++)
+        {
+            int d = chunkDist[c][i * n + j];
+            int other = nodeOffset[c] + j;
+            if (d < FLOW_INF && top.first + d < goal.nodeCost[other]) {
+                goal.nodeCost[other] = top.first + d;
+                goal.nodeParent[other] = id;
+                queue.push({top.first + d, other});
+            }
+        }
+    }
+}
+
+void FlowFields::solveGoal(FlowGoal &goal)
+{
+    goal.nodeCost.assign(nodeCount, FLOW_INF);
+    goal.nodeParent.assign(nodeCount, -1);
+    goalsSolved++;
+    if (!open(goal.gx, goal.gy))
+        return;
+
+    Queue queue;
+    std::vector<std::pair<int, int>> seeds;
+    goalNodes(goal, seeds);
+    for (const auto &seed : seeds)
+    {
+        goal.nodeCost[seed.first] = seed.second;
+        queue.push({seed.second, seed.first});
+    }
+    propagate(goal, queue);
+}
+
+// After onCellsChanged renumbered the nodes: costs of the chunks that were
+// not rebuilt carry over unless their path ran through a rebuilt one. The
+// rest start from their kept neighbours and Dijkstra runs from there, which
+// also carries any shortcut the edit opened out to the kept nodes.
+void FlowFields::repairGoal(FlowGoal &goal, const std::vector<char> &dirty, const std::vector<int> &oldOffset)
+{
+    if (!open(goal.gx, goal.gy)) {
+        solveGoal(goal);
+        return;
+    }
+
+    // 0 unknown, 1 kept, 2 lost; parent -2 is a node of a rebuilt chunk
+    std::vector<int> cost(nodeCount, FLOW_INF), parent(nodeCount, -1);
+    std::vector<uint8_t> state(nodeCount, 0);
+    int chunks = chunksX * chunksY;
+    for (int c = 0; c < chunks; c++)
+    {
+        int first = nodeOffset[c], n = nodeOffset[c + 1] - first;
+        if (dirty[c]) {
+            std::fill(state.begin() + first, state.begin() + first + n, 2);
+            continue;
+        }
+        for (int i = 0; i < n; i++)
+        {
+            int old = oldOffset[c] + i;
+            cost[first + i] = goal.nodeCost[old];
+            int p = goal.nodeParent[old];
+            if (p >= 0) {
+                int pc = (int)(std::upper_bound(oldOffset.begin(), oldOffset.end(), p) - oldOffset.begin()) - 1;
+                p = dirty[pc] ? -2 : nodeOffset[pc] + p - oldOffset[pc];
+            }
+            parent[first + i] = p;
+        }
+    }
+    std::vector<int> chain;
+    for (int v = 0; v < nodeCount; v++)
+    {
+        int u = v;
+        while (state[u] == 0 && cost[u] < FLOW_INF && parent[u] >= 0)
+        {
+            chain.push_back(u);
+            u = parent[u];
+        }
+        uint8_t s = state[u] ? state[u] : (cost[u] < FLOW_INF && parent[u] == -2) ? 2 : 1;
+        state[u] = s;
+        for (int w : chain)
+            state[w] = s;
+        chain.clear();
+    }
+
+    for (int v = 0; v < nodeCount; v++)
+    {
+        if (state[v] != 2)
+            continue;
+        cost[v] = FLOW_INF;
+        int c = nodeChunk[v];
+        int i = v - nodeOffset[c], n = (int)chunkNodes[c].size();
+        const FlowNode &node = chunkNodes[c][i];
+        int mate = nodeOffset[node.mateChunk] + node.mateIndex;
+        if (state[mate] == 1 && cost[mate] < FLOW_INF && cost[mate] + 1 < cost[v]) {
+            cost[v] = cost[mate] + 1;
+            parent[v] = mate;
+        }
+        for (int j = 0; j < n; j++)
+        {
+            int d = chunkDist[c][j * n + i];
+            int other = nodeOffset[c] + j;
+            if (state[other] == 1 && d < FLOW_INF && cost[other] < FLOW_INF && cost[other] + d < cost[v]) {
+                cost[v] = cost[other] + d;
+                parent[v] = other;
+            }
+        }
+    }
+    std::vector<std::pair<int, int>> seeds;
+    goalNodes(goal, seeds);
+    for (const auto &seed : seeds)
+        if (state[seed.first] == 2 && seed.second <= cost[seed.first]) {
+            cost[seed.first] = seed.second;
+            parent[seed.first] = -1;
+        }
+
+    goal.nodeCost.swap(cost);
+    goal.nodeParent.swap(parent);
+    Queue queue;
+    for (int v = 0; v < nodeCount; v++)
+        if (state[v] == 2 && goal.nodeCost[v] < FLOW_INF)
+            queue.push({goal.nodeCost[v], v});
+    propagate(goal, queue);
+    goalsRepaired++;
+}
+
+// exits of chunk c (plus the goal cell), returns a hash of them
+uint64_t FlowFields::chunkSeeds(const FlowGoal &goal, int c, std::vector<std::pair<int, int>> &seeds) const
+{
+    int x0 = (c / chunksY) * FLOW_CHUNK, y0 = (c % chunksY) * FLOW_CHUNK;
+    const std::vector<FlowNode> &nodes = chunkNodes[c];
+    seeds.clear();
+    if (chunkOf(goal.gx, goal.gy) == c)
+        seeds.push_back({(goal.gx - x0) * FLOW_CHUNK + (goal.gy - y0), 0});
+    for (int i = 0; i < (int)nodes.size(); i++)
+    {
+        int mate = nodeOffset[nodes[i].mateChunk] + nodes[i].mateIndex;
+        // a node is an exit when going through its mate is the way to go
+        int viaMate = goal.nodeCost[mate] < FLOW_INF ? goal.nodeCost[mate] + 1 : FLOW_INF;
+        if (viaMate < FLOW_INF && viaMate <= goal.nodeCost[nodeOffset[c] + i])
+            seeds.push_back({(nodes[i].x - x0) * FLOW_CHUNK + (nodes[i].y - y0), viaMate});
+    }
+    uint64_t hash = 1469598103934665603ull;
+    for (const auto &seed : seeds)
+        hash = (hash ^ (((uint64_t)seed.first << 32) | (uint32_t)seed.second)) * 1099511628211ull;
+    return hash;
+}
+
+// integration field of one chunk from its exits, then steepest descent
+void FlowFields::buildChunkFlow(FlowGoal &goal, int c)
+{
+    int x0 = (c / chunksY) * FLOW_CHUNK, y0 = (c % chunksY) * FLOW_CHUNK;
+    int cw = std::min(FLOW_CHUNK, world->w - x0), ch = std::min(FLOW_CHUNK, world->h - y0);
+    const std::vector<FlowNode> &nodes = chunkNodes[c];
+    bool goalHere = chunkOf(goal.gx, goal.gy) == c;
+
+    std::vector<std::pair<int, int>> seeds;
+    goal.chunkSeedHash[c] = chunkSeeds(goal, c, seeds);
+
+    std::vector<uint8_t> mask;
+    std::vector<int> cost;
+    chunkOpen(c, mask);
+    chunkBfs(mask, seeds, cost);
+
+    std::vector<uint8_t> &dirs = goal.chunkDirs[c];
+    dirs.assign(FLOW_CHUNK * FLOW_CHUNK, FLOW_NONE);
+    for (int lx = 0; lx < cw; lx++)
+        for (int ly = 0; ly < ch; ly++)
+        {
+            int idx = lx * FLOW_CHUNK + ly;
+            int best = cost[idx];
+            if (best >= FLOW_INF)
+                continue;
+            uint8_t dir = FLOW_NONE;
+            const int nx[4] = {lx + 1, lx - 1, lx, lx};
+            const int ny[4] = {ly, ly, ly + 1, ly - 1};
+            for (int k = 0; k < 4; k++)
+            {
+                if (nx[k] < 0 || ny[k] < 0 || nx[k] >= cw || ny[k] >= ch)
+                    continue;
+                int v = cost[nx[k] * FLOW_CHUNK + ny[k]];
+                if (v < best) {
+                    best = v;
+                    dir = (uint8_t)(k + 1);
+                }
+            }
+            dirs[idx] = dir;
+        }
+    // exit nodes step over the border
+    for (int i = 0; i < (int)nodes.size(); i++)
+    {
+        int idx = (nodes[i].x - x0) * FLOW_CHUNK + (nodes[i].y - y0);
+        int mate = nodeOffset[nodes[i].mateChunk] + nodes[i].mateIndex;
+        if (dirs[idx] == FLOW_NONE && goal.nodeCost[mate] < FLOW_INF && goal.nodeCost[mate] + 1 == cost[idx]
+            && !(goalHere && nodes[i].x == goal.gx && nodes[i].y == goal.gy))
+            dirs[idx] = nodes[i].exitDir;
+    }
+
+    goal.flowBytes += dirs.size();
+    chunkFlowsBuilt++;
+}
+
+FlowGoal &FlowFields::acquire(FlowGoalId id)
+{
+    auto it = goals.find(id);
+    if (it == goals.end())
+    {
+        FlowGoal &g = goals[id];
+        g.gx = (int)(id / world->h);
+        g.gy = (int)(id % world->h);
+        g.chunkDirs.assign(chunksX * chunksY, std::vector<uint8_t>());
+        g.chunkSeedHash.assign(chunksX * chunksY, 0);
+        solveGoal(g);
+        g.lastUse = ++useClock;
+        enforceBudget(id);
+        return g;
+    }
+    it->second.lastUse = ++useClock;
+    return it->second;
+}
+
+FlowGoalId FlowFields::goal(int gx, int gy)
+{
+    FlowGoalId id = (FlowGoalId)gx * world->h + gy;
+    acquire(id);
+    return id;
+}
+
+uint8_t FlowFields::direction(FlowGoalId id, int x, int y)
+{
+    if (!world->inside(x, y))
+        return FLOW_NONE;
+    FlowGoal &goal = acquire(id);
+    int c = chunkOf(x, y);
+    if (goal.chunkDirs[c].empty()) {
+        buildChunkFlow(goal, c);
+        enforceBudget(id);
+    }
+    return goal.chunkDirs[c][(x % FLOW_CHUNK) * FLOW_CHUNK + (y % FLOW_CHUNK)];
+}
+
+size_t FlowFields::cachedBytes() const
+{
+    size_t total = 0;
+    for (const auto &g : goals)
+        total += g.second.bytes();
+    return total;
+}
+
+// drops least recently used goals, never the one in use
+void FlowFields::enforceBudget(FlowGoalId keep)
+{
+    while (goals.size() > 1 && cachedBytes() > budgetBytes)
+    {
+        auto oldest = goals.end();
+        for (auto it = goals.begin(); it != goals.end(); ++it)
+            if (it->first != keep && (oldest == goals.end() || it->second.lastUse < oldest->second.lastUse))
+                oldest = it;
+        if (oldest == goals.end())
+            return;
+        goals.erase(oldest);
+        goalsEvicted++;
+    }
+}
+
+void FlowFields::onCellsChanged(int x0, int y0, int x1, int y1)
+{
+    int cx0 = std::max(x0, 0) / FLOW_CHUNK, cx1 = std::min(x1, world->w - 1) / FLOW_CHUNK;
+    int cy0 = std::max(y0, 0) / FLOW_CHUNK, cy1 = std::min(y1, world->h - 1) / FLOW_CHUNK;
+
+    // borders of the edited chunks, then nodes of those chunks and their neighbours
+    std::vector<char> dirty(chunksX * chunksY, 0);
+    for (int cx = cx0; cx <= cx1; cx++)
+        for (int cy = cy0; cy <= cy1; cy++)
+        {
+            buildBorderX(cx, cy);
+            buildBorderY(cx, cy);
+            if (cx > 0) buildBorderX(cx - 1, cy);
+            if (cy > 0) buildBorderY(cx, cy - 1);
+            dirty[cx * chunksY + cy] = 1;
+            if (cx > 0) dirty[(cx - 1) * chunksY + cy] = 1;
+            if (cx + 1 < chunksX) dirty[(cx + 1) * chunksY + cy] = 1;
+            if (cy > 0) dirty[cx * chunksY + cy - 1] = 1;
+            if (cy + 1 < chunksY) dirty[cx * chunksY + cy + 1] = 1;
+        }
+    for (int c = 0; c < chunksX * chunksY; c++)
+        if (dirty[c])
+            buildChunkNodes(c);
+
+    std::vector<int> oldOffset = nodeOffset;
+    linkMates();
+    for (int c = 0; c < chunksX * chunksY; c++)
+        if (dirty[c])
+            buildChunkDist(c);
+
+    // repair cached goals, keep chunk flows whose exits did not change
+    std::vector<std::pair<int, int>> seeds;
+    for (auto &entry : goals)
+    {
+        FlowGoal &g = entry.second;
+        repairGoal(g, dirty, oldOffset);
+        for (int c = 0; c < chunksX * chunksY; c++)
+        {
+            if (g.chunkDirs[c].empty())
+                continue;
+            if (dirty[c] || chunkSeeds(g, c, seeds) != g.chunkSeedHash[c]) {
+                g.flowBytes -= g.chunkDirs[c].size();
+                g.chunkDirs[c].clear();
+                g.chunkDirs[c].shrink_to_fit();
+            }
+        }
+    }
+}
@@ -4,22 +4,23 @@
 #include <GLFW/glfw3.h>
 
 #define STB_IMAGE_IMPLEMENTATION
-#include "stb_image.h"
+#include "Assets.h" // brings in stb_image.h
 
 #include <iostream>
 #include <math.h>
 
-#include "utils.h"
+#include "WorldMap.h"
+#include "CpuRenderer.h"
+#include "Sprites.h"
+#include "Entities.h"
+#include "LightMap.h"
+#include "VoxelTerrain.h"
+#include "MapEdits.h"
+#include "AssetLoader.h"
+#include "RenderSettings.h"
+#include "ShaderCache.h"
 #include <string>
-
-std::string* string_compute = readFile("shaders/compute.glsl");
-const char *str_computeShader = string_compute->c_str();
-
-std::string* string_vertex = readFile("shaders/vertex.glsl");
-const char *str_vertexShader = string_vertex->c_str();
-
-std::string* string_fragment = readFile("shaders/fragment.glsl");
-const char *str_fragmentShader = string_fragment->c_str();
+#include <memory>
 
 GLfloat vertices[] = {
     -1.f,  1.f,  0.f,  0.f,
@@ -49,31 +50,100 @@ int map[10][10] = {
 #define SHEESH_SAG 2
 #define SHEESH_SOL 3
 
+// datas ssbo: pos, dir, plane, maxDistance, fogStart, fogColor
+#define DATAS_COUNT 11
+// struct Column in ray_cast.glsl, one per image column
+#define RAY_COLUMN_BYTES 224
+
 class Game
 {
 private:
     GLuint wall_output;
 
     GLuint tex_output;
-    GLuint ray_program, quad_program;
+    GLuint ray_program, quad_program, scatter_program;
+    GLuint cast_program, shade_program;
     GLuint quad_vao;
 
     GLuint map_ssbo;
     GLuint posdirplane_ssbo;
+    GLuint light_ssbo;
+    GLuint palette_ssbo;
+    GLuint surface_ssbo;
+    GLuint column_ssbo;   // ray_cast.glsl -> ray_shade.glsl
+    GLuint edit_ssbo = 0; // MapEdits::scatter pairs
+    size_t edit_ssbo_size = 0;
 
     float *datas;
     int tex_w, tex_h;
 
+    // shader sources, embedded or from RAYCASTER_ASSETS (Assets.h), loaded in init
+    std::string str_computeShader, str_vertexShader, str_fragmentShader, str_scatterShader;
+    std::string str_castShader, str_shadeShader;
+    ShaderCache shader_cache; // RAYCASTER_SHADER_CACHE or ./shader_cache, empty to disable
+    int quad_ticket, ray_ticket, scatter_ticket, cast_ticket, shade_ticket;
+
+    WorldMap world;
+    ThreadPool pool;
+
 public:
     float posX = 3, posY = 3;      // x and y start position
     float dirX = -1, dirY = 0;       // initial direction vector
     float planeX = 0, planeY = 0.85; // the 2d raycaster version of camera plane
 
+    RenderSettings settings;
+    bool cpu_render = false; // draw with CpuRenderer instead of the compute shader
+    // GPU path: a cast pass of 64 rays per workgroup and a shade pass of one
+    // invocation per pixel, instead of compute.glsl's one invocation per column
+    bool split_dispatch = true;
+    CpuRenderer cpu{&pool};
+    VisibleSet visible_cells; // cells and faces seen by the last CPU frame
+    SpriteRenderer sprite_renderer{&pool};
+    std::vector<Sprite> sprites; // drawn by the CPU renderer only
+    EntityStore entities;
+    LightMap lights;
+    TextureAtlas atlas;
+    TextureTable surfaces; // cell value / floor kind -> atlas layers
+    HeightField heights;   // used by the CPU renderer when cpu.heights points here
+    // map changes go through edits and reach world, map_ssbo and the light
+    // map together at the start of the next frame
+    MapEdits edits;
+    std::vector<int> upload_cells;
+
+    // doors sliding towards a target open fraction, one map edit each per frame
+    struct DoorMotion
+    {
+        int x, y;
+        float open, target;
+    };
+    std::vector<DoorMotion> moving_doors;
+
+    // textures streamed in after init into the layers past the atlas, drawn
+    // as placeholders until they land (uploads run at the start of loop).
+    // The loader threads and the streamed layers only exist once something
+    // calls requestTexture().
+    std::unique_ptr<AssetLoader> texture_loader;
+    Palette atlas_palette;
+    int streamed_layers = 32;
+    int next_streamed_layer = 0;
+
+    bool terrain_mode = false; // CPU path draws the heightmap terrain instead of the map
+    Terrain terrain;           // generated the first time terrain_mode is on
+    VoxelRenderer voxel{&pool};
+    RenderSettings terrain_settings;
+
     void init(int _w, int _h);
     void debugWorksizes();
     void initRayProgram();
+    void initScatterProgram();
     void loop();
     void move(int dir, double frameTime);
+    bool tick(double frameTime); // true when the view changed
+    void writeDatas();
+    void toggleDoor();                        // the door cell in front of the camera
+    void applyEdits();
+    void shapeHeights(int x0, int y0, int x1, int y1); // the map's wall and ceiling heights over a cell rect
+    std::shared_future<int> requestTexture(const std::string &name); // -1 once out of streamed layers
 };
 
 void Game::init(int _w, int _h)
@@ -81,46 +151,44 @@ void Game::init(int _w, int _h)
     tex_w = _w;
     tex_h = _h;
 
-    datas = (float*)calloc(6, sizeof(float));
-    datas[0] = posX;
-    datas[1] = posY;
-    datas[2] = dirX;
-    datas[3] = dirY;
-    datas[4] = planeX;
-    datas[5] = planeY;
-
-    quad_program = glCreateProgram();
-    GLuint quad_vertex = glCreateShader(GL_VERTEX_SHADER);
-    GLuint quad_fragment = glCreateShader(GL_FRAGMENT_SHADER);
-
-    glShaderSource(quad_vertex, 1, &str_vertexShader, NULL);
-    glCompileShader(quad_vertex);
-
-    GLint compileStatus;
-    glGetShaderiv(quad_vertex, GL_COMPILE_STATUS, &compileStatus);
-
-    if (compileStatus != GL_TRUE)
-    {
-        GLchar infoLog[512];
-        glGetShaderInfoLog(quad_vertex, sizeof(infoLog), NULL, infoLog);
-        std::cerr << "VShader derleme hatası: " << infoLog << std::endl;
-    }
-
-    glShaderSource(quad_fragment, 1, &str_fragmentShader, NULL);
-    glCompileShader(quad_fragment);
-
-    glGetShaderiv(quad_fragment, GL_COMPILE_STATUS, &compileStatus);
-
-    if (compileStatus != GL_TRUE)
-    {
-        GLchar infoLog[512];
-        glGetShaderInfoLog(quad_fragment, sizeof(infoLog), NULL, infoLog);
-        std::cerr << "FShader derleme hatası: " << infoLog << std::endl;
-    }
-
-    glAttachShader(quad_program, quad_vertex);
-    glAttachShader(quad_program, quad_fragment);
-    glLinkProgram(quad_program);
+    loadTextAsset("shaders/compute.glsl", str_computeShader);
+    loadTextAsset("shaders/vertex.glsl", str_vertexShader);
+    loadTextAsset("shaders/fragment.glsl", str_fragmentShader);
+    loadTextAsset("shaders/map_scatter.glsl", str_scatterShader);
+    loadTextAsset("shaders/ray_cast.glsl", str_castShader);
+    loadTextAsset("shaders/ray_shade.glsl", str_shadeShader);
+
+    // every program compiles (or loads from the cache) while the rest of init runs
+    const char *cacheDir = getenv("RAYCASTER_SHADER_CACHE");
+    shader_cache.init(cacheDir ? cacheDir : "shader_cache", (void *(*)(const char *))glfwGetProcAddress);
+    quad_ticket = shader_cache.begin("quad", {{GL_VERTEX_SHADER, &str_vertexShader}, {GL_FRAGMENT_SHADER, &str_fragmentShader}});
+    ray_ticket = shader_cache.begin("ray", {{GL_COMPUTE_SHADER, &str_computeShader}});
+    scatter_ticket = shader_cache.begin("scatter", {{GL_COMPUTE_SHADER, &str_scatterShader}});
+    cast_ticket = shader_cache.begin("cast", {{GL_COMPUTE_SHADER, &str_castShader}});
+    shade_ticket = shader_cache.begin("shade", {{GL_COMPUTE_SHADER, &str_shadeShader}});
+
+    world.load(&map[0][0], 10, 10);
+    // a grey floor and ceiling in the far rows
+    for (int x = 7; x < 9; x++)
+        for (int y = 1; y < 9; y++)
+            world.setFloor(x, y, 4);
+    // a grate and a glass pane into the nook of 3 blocks
+    world.set(6, 5, 5);
+    world.set(7, 4, 6);
+    // and a sliding door in front of it
+    world.setThin(7, THIN_X);
+    world.set(8, 5, 7);
+    cpu.resize(tex_w, tex_h);
+    cpu.visibleSet = &visible_cells;
+    lights.addLight({2.5f, 2.5f, 6.f});
+    lights.addLight({7.5f, 7.5f, 6.f});
+    lights.build(world, &pool);
+    cpu.lightMap = &lights;
+
+    heights.fromWorld(world);
+    shapeHeights(0, 0, world.w - 1, world.h - 1);
+
+    datas = (float*)calloc(DATAS_COUNT, sizeof(float));
 
     GLuint quad_vbo;
     glGenVertexArrays(1, &quad_vao);
@@ -136,14 +204,22 @@ void Game::init(int _w, int _h)
     glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, 4 * sizeof(float), (void*)(2 * sizeof(float)));
     glEnableVertexAttribArray(1);
 
+    std::vector<int> gpuMap = world.exportRowMajor();
     glGenBuffers(1, &map_ssbo);
     glBindBuffer(GL_SHADER_STORAGE_BUFFER, map_ssbo);
-    glBufferData(GL_SHADER_STORAGE_BUFFER, sizeof(map), map, GL_STATIC_DRAW);
+    glBufferData(GL_SHADER_STORAGE_BUFFER, gpuMap.size() * sizeof(int), gpuMap.data(), GL_DYNAMIC_DRAW);
     glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
     
     glGenBuffers(1, &posdirplane_ssbo);
     glBindBuffer(GL_SHADER_STORAGE_BUFFER, posdirplane_ssbo);
-    glBufferData(GL_SHADER_STORAGE_BUFFER, sizeof(double) * 6, datas, GL_DYNAMIC_DRAW);
+    glBufferData(GL_SHADER_STORAGE_BUFFER, sizeof(float) * DATAS_COUNT, datas, GL_DYNAMIC_DRAW);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+    writeDatas();
+
+    std::vector<uint32_t> lightLevels = lights.exportPacked();
+    glGenBuffers(1, &light_ssbo);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, light_ssbo);
+    glBufferData(GL_SHADER_STORAGE_BUFFER, lightLevels.size() * sizeof(uint32_t), lightLevels.data(), GL_STATIC_DRAW);
     glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
 
     glGenTextures(1, &tex_output);
@@ -155,31 +231,98 @@ void Game::init(int _w, int _h)
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
     glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA32F, tex_w, tex_h, 0, GL_RGBA, GL_FLOAT,
                  NULL);
-    glBindImageTexture(0, tex_output, 0, GL_FALSE, 0, GL_WRITE_ONLY, GL_RGBA32F);
-
-    unsigned char* wallData;
-    int tw, th, tnumC;
-    stbi_set_flip_vertically_on_load(true);
-    wallData = stbi_load("wall.png", &tw, &th, &tnumC, 0);
-
+    glBindImageTexture(0, tex_output, 0, GL_FALSE, 0, GL_READ_WRITE, GL_RGBA32F); // read back for translucent walls
+
+    ImageAsset wall;
+    loadImageAsset("wall.png", wall);
+    const unsigned char *wallData = wall.pixels;
+    int tw = wall.w, th = wall.h, tnumC = wall.channels;
+
+    // surface textures: wall.png plus tinted copies for the other cell values
+    atlas.add(wallData, tw, th, tnumC);
+    std::vector<unsigned char> tinted((size_t)tw * th * 3);
+    const float tints[3][3] = {{1.f, .55f, .5f}, {.5f, .7f, 1.f}, {.6f, .6f, .6f}};
+    for (int t = 0; t < 3; t++)
+    {
+        for (size_t i = 0; i < (size_t)tw * th; i++)
+            for (int c = 0; c < 3; c++)
+                tinted[i * 3 + c] = (unsigned char)(wallData[i * tnumC + c] * tints[t][c]);
+        atlas.add(tinted.data(), tw, th, 3);
+    }
+    // a grate: bars of the wall texture, key colour in between
+    for (int y = 0; y < th; y++)
+        for (int x = 0; x < tw; x++)
+        {
+            size_t i = (size_t)y * tw + x;
+            bool bar = (x * 8 / tw) % 2 == 0 || y * 8 / th == 0 || y * 8 / th == 7;
+            for (int c = 0; c < 3; c++)
+                tinted[i * 3 + c] = bar ? wallData[i * tnumC + c] : (c == 1 ? 0 : 255);
+        }
+    atlas.add(tinted.data(), tw, th, 3);
+    surfaces.setWall(1, 0);
+    surfaces.setWall(2, 1);
+    surfaces.setWall(3, 2);
+    surfaces.setWall(4, 0);
+    surfaces.setWall(5, 4, MATERIAL_MASKED);
+    surfaces.setWall(6, 2, MATERIAL_TRANSLUCENT, 110);
+    surfaces.setWall(7, 3);
+    surfaces.setFloor(4, 3, 3);
+    cpu.setTextures(atlas, surfaces);
+
+    // one array texture, 1 byte per texel instead of RGBA32F, colours come
+    // from the palette ssbo
+    std::vector<uint8_t> atlasIndices;
+    quantizeTexture(atlas.rgb.data(), atlas.w, atlas.h * atlas.layers, 3, atlas_palette, atlasIndices);
     glGenTextures(1, &wall_output);
-    glBindTexture(GL_TEXTURE_2D, wall_output);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA32F, tw, th, 0, GL_RGB, GL_UNSIGNED_BYTE, wallData);
-    stbi_image_free(wallData);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, wall_output);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    glTexImage3D(GL_TEXTURE_2D_ARRAY, 0, GL_R8UI, atlas.w, atlas.h, atlas.layers, 0, GL_RED_INTEGER, GL_UNSIGNED_BYTE, atlasIndices.data());
+
+    float paletteColors[256 * 4];
+    for (int i = 0; i < 256; i++)
+    {
+        paletteColors[i * 4 + 0] = (atlas_palette.colors[i] & 0xFF) / 255.f;
+        paletteColors[i * 4 + 1] = ((atlas_palette.colors[i] >> 8) & 0xFF) / 255.f;
+        paletteColors[i * 4 + 2] = ((atlas_palette.colors[i] >> 16) & 0xFF) / 255.f;
+        paletteColors[i * 4 + 3] = 1.f;
+    }
+    glGenBuffers(1, &palette_ssbo);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, palette_ssbo);
+    glBufferData(GL_SHADER_STORAGE_BUFFER, sizeof(paletteColors), paletteColors, GL_STATIC_DRAW);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+
+    // wall surfaces by cell value, then floor surfaces by floor kind
+    int surfaceLayers[256 * 4];
+    for (int i = 0; i < 256; i++)
+    {
+        surfaceLayers[i * 2 + 0] = surfaces.walls[i].layer;
+        surfaceLayers[i * 2 + 1] = surfaces.walls[i].material | surfaces.walls[i].alpha << 8 |
+                                   world.thin[i].axis << 16 | int(world.thin[i].offset * 255.f + 0.5f) << 24;
+        surfaceLayers[512 + i * 2 + 0] = surfaces.floors[i].floor;
+        surfaceLayers[512 + i * 2 + 1] = surfaces.floors[i].ceiling;
+    }
+    glGenBuffers(1, &surface_ssbo);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, surface_ssbo);
+    glBufferData(GL_SHADER_STORAGE_BUFFER, sizeof(surfaceLayers), surfaceLayers, GL_STATIC_DRAW);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
 
     GLenum error = glGetError();
     if (error != GL_NO_ERROR) {
         std::cout << "OpenGL Hata Kodu: " << error << std::endl;
     }
 
-    glBindImageTexture(3, wall_output, 0, GL_FALSE, 0, GL_READ_ONLY, GL_RGBA32F);
+    glBindImageTexture(3, wall_output, 0, GL_TRUE, 0, GL_READ_ONLY, GL_R8UI);
 
     debugWorksizes();
+    quad_program = shader_cache.finish(quad_ticket);
     initRayProgram();
+    initScatterProgram();
+    std::cout << "shaders: " << shader_cache.loaded << " from cache, " << shader_cache.compiled << " compiled"
+              << (shader_cache.parallel ? " in parallel" : "") << std::endl;
 }
 
 void Game::debugWorksizes()
@@ -205,37 +348,73 @@ void Game::debugWorksizes()
 
 void Game::initRayProgram()
 {
-    GLuint ray_shader = glCreateShader(GL_COMPUTE_SHADER);
-    glShaderSource(ray_shader, 1, &str_computeShader, NULL);
-    glCompileShader(ray_shader);
+    ray_program = shader_cache.finish(ray_ticket);
+    cast_program = shader_cache.finish(cast_ticket);
+    shade_program = shader_cache.finish(shade_ticket);
 
-    GLint compileStatus;
-    glGetShaderiv(ray_shader, GL_COMPILE_STATUS, &compileStatus);
-
-    if (compileStatus != GL_TRUE)
-    {
-        GLchar infoLog[512];
-        glGetShaderInfoLog(ray_shader, sizeof(infoLog), NULL, infoLog);
-        std::cerr << "CShader derleme hatası: " << infoLog << std::endl;
-    }
-
-    ray_program = glCreateProgram();
-    glAttachShader(ray_program, ray_shader);
-    glLinkProgram(ray_program);
+    glGenBuffers(1, &column_ssbo);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, column_ssbo);
+    glBufferData(GL_SHADER_STORAGE_BUFFER, (GLsizeiptr)tex_w * RAY_COLUMN_BYTES, NULL, GL_DYNAMIC_DRAW);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
 
     glBindBufferBase(GL_SHADER_STORAGE_BUFFER, (GLuint)1, map_ssbo);
     glBindBufferBase(GL_SHADER_STORAGE_BUFFER, (GLuint)2, posdirplane_ssbo);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, (GLuint)4, light_ssbo);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, (GLuint)5, palette_ssbo);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, (GLuint)6, surface_ssbo);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, (GLuint)8, column_ssbo);
+}
 
-    glDeleteShader(ray_shader);
+void Game::initScatterProgram()
+{
+    scatter_program = shader_cache.finish(scatter_ticket);
+    glGenBuffers(1, &edit_ssbo);
 }
 
 void Game::loop()
 {
-    glClearTexImage(tex_output, 0, GL_RGBA, GL_FLOAT, NULL);
-
-    glUseProgram(ray_program);
-    glDispatchCompute((GLuint)tex_w, 1, 1);
-    glMemoryBarrier(GL_SHADER_IMAGE_ACCESS_BARRIER_BIT);
+    applyEdits();
+    if (texture_loader)
+        texture_loader->uploadSlice([&](const AssetLoader::Texture &t) {
+            cpu.setLayer(t.layer, t.texels.data(), t.indices.data(), t.mask.data());
+            glBindTexture(GL_TEXTURE_2D_ARRAY, wall_output);
+            glTexSubImage3D(GL_TEXTURE_2D_ARRAY, 0, 0, 0, t.layer, texture_loader->texW, texture_loader->texH, 1,
+                            GL_RED_INTEGER, GL_UNSIGNED_BYTE, t.rows.data());
+        });
+    if (cpu_render) {
+        Camera cam = {posX, posY, dirX, dirY, planeX, planeY};
+        if (terrain_mode) {
+            if (terrain.texels.empty()) {
+                terrain.generate(10, 1234, &pool);
+                terrain_settings.maxDistance = 800.f;
+                terrain_settings.fogStart = 400.f;
+            }
+            // one map cell is 64 terrain cells, the camera floats above the ground
+            cam.posX *= 64.f;
+            cam.posY *= 64.f;
+            voxel.cameraHeight = terrain.heightAt(cam.posX, cam.posY) + 40.f;
+            voxel.render(cpu, terrain, cam, terrain_settings);
+        } else {
+            cpu.render(world, cam, settings);
+            sprite_renderer.render(cpu, cam, sprites);
+        }
+        glBindTexture(GL_TEXTURE_2D, tex_output);
+        glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, tex_w, tex_h, GL_RGBA, GL_UNSIGNED_BYTE, cpu.framebuffer.data());
+    } else if (split_dispatch) {
+        // the shade pass writes every pixel, no clear
+        glUseProgram(cast_program);
+        glDispatchCompute((GLuint)(tex_w + 63) / 64, 1, 1);
+        glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+        glUseProgram(shade_program);
+        glDispatchCompute((GLuint)(tex_w + 7) / 8, (GLuint)(tex_h + 7) / 8, 1);
+        glMemoryBarrier(GL_SHADER_IMAGE_ACCESS_BARRIER_BIT);
+    } else {
+        glClearTexImage(tex_output, 0, GL_RGBA, GL_FLOAT, NULL);
+
+        glUseProgram(ray_program);
+        glDispatchCompute((GLuint)tex_w, 1, 1);
+        glMemoryBarrier(GL_SHADER_IMAGE_ACCESS_BARRIER_BIT);
+    }
 
     {
         glUseProgram(quad_program);
@@ -246,21 +425,153 @@ void Game::loop()
     }
 }
 
+// moves every entity, same collision rule as the player, and slides doors
+bool Game::tick(double frameTime)
+{
+    entities.update(world, (float)frameTime, &pool);
+
+    bool changed = !moving_doors.empty() || (texture_loader && texture_loader->pending() > 0);
+    float step = (float)frameTime * 1.5f;
+    for (size_t i = 0; i < moving_doors.size();)
+    {
+        DoorMotion &d = moving_doors[i];
+        d.open = d.target > d.open ? std::min(d.open + step, d.target) : std::max(d.open - step, d.target);
+        edits.setOpen(d.x, d.y, d.open);
+        if (d.open == d.target) {
+            moving_doors[i] = moving_doors.back();
+            moving_doors.pop_back();
+        } else {
+            i++;
+        }
+    }
+    return changed;
+}
+
+std::shared_future<int> Game::requestTexture(const std::string &name)
+{
+    if (!texture_loader) {
+        texture_loader.reset(new AssetLoader());
+        texture_loader->texW = atlas.w;
+        texture_loader->texH = atlas.h;
+        texture_loader->palette = atlas_palette;
+        cpu.reserveLayers(atlas.layers + streamed_layers);
+        cpu.setTextureTable(surfaces);
+        next_streamed_layer = atlas.layers;
+
+        // a bigger array texture, the atlas layers copied over and the
+        // streamed ones index 0 until they land
+        GLuint grown;
+        glGenTextures(1, &grown);
+        glBindTexture(GL_TEXTURE_2D_ARRAY, grown);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+        std::vector<uint8_t> blank((size_t)atlas.w * atlas.h * (atlas.layers + streamed_layers), 0);
+        glTexImage3D(GL_TEXTURE_2D_ARRAY, 0, GL_R8UI, atlas.w, atlas.h, atlas.layers + streamed_layers, 0, GL_RED_INTEGER, GL_UNSIGNED_BYTE, blank.data());
+        glCopyImageSubData(wall_output, GL_TEXTURE_2D_ARRAY, 0, 0, 0, 0, grown, GL_TEXTURE_2D_ARRAY, 0, 0, 0, 0, atlas.w, atlas.h, atlas.layers);
+        glDeleteTextures(1, &wall_output);
+        wall_output = grown;
+        glBindImageTexture(3, wall_output, 0, GL_TRUE, 0, GL_READ_ONLY, GL_R8UI);
+    }
+    if (next_streamed_layer >= atlas.layers + streamed_layers) {
+        std::promise<int> none;
+        none.set_value(-1);
+        return none.get_future().share();
+    }
+    return texture_loader->request(name, next_streamed_layer++);
+}
+
+void Game::toggleDoor()
+{
+    int x = int(posX + dirX), y = int(posY + dirY);
+    if (!world.inside(x, y) || world.thin[world.get(x, y)].axis == THIN_NONE)
+        return;
+    for (size_t i = 0; i < moving_doors.size(); i++)
+        if (moving_doors[i].x == x && moving_doors[i].y == y) {
+            moving_doors[i].target = 1.f - moving_doors[i].target;
+            return;
+        }
+    float open = world.openAt(x, y);
+    moving_doors.push_back({x, y, open, open < 0.5f ? 1.f : 0.f});
+}
+
+// the frame boundary: queued edits go into the world, then the dirty
+// ranges of map_ssbo are re-sent and the lights around new walls rebaked
+void Game::applyEdits()
+{
+    if (!edits.pending())
+        return;
+    edits.apply(world);
+
+    if (!edits.scatter.empty()) {
+        // scattered edits: one upload of (cell, value) pairs, written by the GPU
+        size_t bytes = edits.scatter.size() * sizeof(int);
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, edit_ssbo);
+        if (bytes > edit_ssbo_size) {
+            edit_ssbo_size = bytes * 2;
+            glBufferData(GL_SHADER_STORAGE_BUFFER, edit_ssbo_size, NULL, GL_STREAM_DRAW);
+        }
+        glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, bytes, edits.scatter.data());
+        GLint count = (GLint)(edits.scatter.size() / 2);
+        glUseProgram(scatter_program);
+        glUniform1i(0, count);
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, (GLuint)7, edit_ssbo);
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, (GLuint)1, map_ssbo);
+        glDispatchCompute((GLuint)(count + 63) / 64, 1, 1);
+        glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+    }
+
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, map_ssbo);
+    for (size_t i = 0; i < edits.ranges.size(); i++)
+    {
+        const MapEdits::Range &r = edits.ranges[i];
+        upload_cells.resize(r.count);
+        for (size_t c = 0; c < r.count; c++)
+            upload_cells[c] = world.exportCell(int((r.first + c) / world.h), int((r.first + c) % world.h));
+        glBufferSubData(GL_SHADER_STORAGE_BUFFER, r.first * sizeof(int), r.count * sizeof(int), upload_cells.data());
+    }
+
+    if (edits.valuesChanged || edits.floorsChanged)
+        for (size_t i = 0; i < edits.rects.size(); i++)
+        {
+            const MapEdits::Rect &r = edits.rects[i];
+            heights.onCellsChanged(world, r.x0, r.y0, r.x1, r.y1);
+            shapeHeights(r.x0, r.y0, r.x1, r.y1);
+        }
+    if (edits.valuesChanged) {
+        lights.onCellsChanged(edits.rects);
+        if (lights.relit) {
+            std::vector<uint32_t> lightLevels = lights.exportPacked();
+            glBindBuffer(GL_SHADER_STORAGE_BUFFER, light_ssbo);
+            glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, lightLevels.size() * sizeof(uint32_t), lightLevels.data());
+        }
+    }
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+}
+
+// half height walls for the 2 blocks, a lower ceiling over the grey floor
+void Game::shapeHeights(int x0, int y0, int x1, int y1)
+{
+    for (int x = x0; x <= x1; x++)
+        for (int y = y0; y <= y1; y++)
+        {
+            if (world.get(x, y) == 2)
+                heights.setWall(x, y, 0.5f);
+            heights.setCeiling(x, y, world.floorKind(x, y) == 4 ? 0.75f : 1.f);
+        }
+}
+
 void Game::move(int dir, double frameTime) {
     double moveSpeed = 1.2f * frameTime;
     double rotSpeed = 1.4f * frameTime;
     switch (dir) {
         case SHEESH_ILERI:
-            if(map[int(posX + dirX * moveSpeed)][int(posY)] == false)
-                posX += dirX * moveSpeed;
-            if(map[int(posX)][int(posY + dirY * moveSpeed)] == false)
-                posY += dirY * moveSpeed;
+            slideMove(world, posX, posY, dirX * moveSpeed, dirY * moveSpeed, 0.f);
             break;
         case SHEESH_GERI:
-            if(map[int(posX - dirX * moveSpeed)][int(posY)] == false)
-                posX -= dirX * moveSpeed;
-            if(map[int(posX)][int(posY - dirY * moveSpeed)] == false) 
-                posY -= dirY * moveSpeed;
+            slideMove(world, posX, posY, -dirX * moveSpeed, -dirY * moveSpeed, 0.f);
             break;
         case SHEESH_SOL:
         {
@@ -284,14 +595,25 @@ void Game::move(int dir, double frameTime) {
             break;
     }
 
+    writeDatas();
+}
+
+// copies camera and render settings into the datas ssbo
+void Game::writeDatas()
+{
     datas[0] = posX;
     datas[1] = posY;
     datas[2] = dirX;
     datas[3] = dirY;
     datas[4] = planeX;
     datas[5] = planeY;
+    datas[6] = settings.maxDistance;
+    datas[7] = settings.fogStart;
+    datas[8] = settings.fogColor[0];
+    datas[9] = settings.fogColor[1];
+    datas[10] = settings.fogColor[2];
 
     glBindBuffer(GL_SHADER_STORAGE_BUFFER, posdirplane_ssbo);
-    glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, sizeof(double) * 6, datas);
+    glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, sizeof(float) * DATAS_COUNT, datas);
     glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
 }
\ No newline at end of file
@@ -0,0 +1,76 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+#include <algorithm>
+
+#include "WorldMap.h"
+
+// Per cell floor and ceiling heights for the CPU engine, in 1/HEIGHT_UNIT
+// of a cell (0 is the ground, HEIGHT_UNIT the normal ceiling). A solid cell
+// is a cell whose floor is raised to its wall height: when that reaches
+// the ceiling it blocks like before, below that rays pass over it and its
+// top is drawn like any other floor. Indexed x * h + y like WorldMap::floors.
+
+#define HEIGHT_UNIT 64
+
+class HeightField
+{
+public:
+    int w = 0, h = 0;
+    std::vector<uint8_t> floorZ, ceilZ;
+    std::vector<uint8_t> walls; // solid cells as of the last fromWorld / onCellsChanged
+
+    // flat map: open cells 0 / 1, solid cells blocked
+    void fromWorld(const WorldMap &world);
+    // after map edits: new walls become full height, removed walls flat
+    // floor, cells that kept their kind keep their heights
+    void onCellsChanged(const WorldMap &world, int x0, int y0, int x1, int y1);
+
+    float floorAt(size_t i) const { return floorZ[i] * (1.f / HEIGHT_UNIT); }
+    float ceilAt(size_t i) const { return ceilZ[i] * (1.f / HEIGHT_UNIT); }
+    bool blocked(size_t i) const { return floorZ[i] >= ceilZ[i]; }
+
+    void setFloor(int x, int y, float z) { floorZ[(size_t)x * h + y] = toUnits(z); }
+    void setCeiling(int x, int y, float z) { ceilZ[(size_t)x * h + y] = toUnits(z); }
+    void setWall(int x, int y, float z) { setFloor(x, y, z); } // for solid cells
+
+    static uint8_t toUnits(float z)
+    {
+        int v = int(z * HEIGHT_UNIT + 0.5f);
+        return (uint8_t)(v < 0 ? 0 : (v > 255 ? 255 : v));
+    }
+};
+
+void HeightField::fromWorld(const WorldMap &world)
+{
+    w = world.w;
+    h = world.h;
+    floorZ.assign((size_t)w * h, 0);
+    ceilZ.assign((size_t)w * h, HEIGHT_UNIT);
+    walls.assign((size_t)w * h, 0);
+    for (int x = 0; x < w; x++)
+        for (int y = 0; y < h; y++)
+            if (world.solid(x, y)) {
+                floorZ[(size_t)x * h + y] = HEIGHT_UNIT;
+                walls[(size_t)x * h + y] = 1;
+            }
+}
+
+void HeightField::onCellsChanged(const WorldMap &world, int x0, int y0, int x1, int y1)
+{
+    for (int x = std::max(x0, 0); x <= std::min(x1, w - 1); x++)
+        for (int y = std::max(y0, 0); y <= std::min(y1, h - 1); y++)
+        {
+            size_t i = (size_t)x * h + y;
+            bool solid = world.solid(x, y);
+            if (solid && !walls[i]) {
+                // raised floors and lowered ceilings included
+                floorZ[i] = HEIGHT_UNIT;
+                ceilZ[i] = HEIGHT_UNIT;
+            } else if (!solid && walls[i]) {
+                floorZ[i] = 0;
+            }
+            walls[i] = solid;
+        }
+}
@@ -0,0 +1,292 @@
+#pragma once
+
+#include <cstdint>
+#include <math.h>
+#include <vector>
+#include <algorithm>
+
+#include "WorldMap.h"
+#include "MapEdits.h"
+#include "ThreadPool.h"
+#include "LineOfSight.h"
+
+// Baked lighting for static point lights. Every light is baked into the
+// square of cells it can reach: one level per wall face (faces numbered
+// like VisibleFace) and LIGHTMAP_RES x LIGHTMAP_RES levels per floor cell,
+// each sample lit when segmentClear() says the light can see it. Lights are
+// summed into 16 bit accumulators and the render tables (floorLight,
+// faceLight) hold min(255, ambient + sum), so a lookup is one byte fetch.
+//
+// Each light keeps its own contribution. A map edit only rebakes the
+// lights whose square touches the edit: subtract the old contribution,
+// bake, add the new one and refresh the tables inside that square. Nothing
+// outside the square can change, since every segment of a light stays in it.
+
+#define LIGHTMAP_RES 4     // floor samples per cell side
+#define LIGHT_FACE_EPS 0.01f // face samples sit this far out in front of the face
+
+struct PointLight
+{
+    float x, y;
+    float radius;
+    float intensity = 1.f; // 1 adds a full level at the light
+};
+
+class LightMap
+{
+private:
+    struct LightRegion
+    {
+        int x0, y0, x1, y1;         // inclusive cells
+        std::vector<uint8_t> floor; // region texels, same layout as floorLight
+        std::vector<uint8_t> faces; // 4 per region cell
+    };
+
+    const WorldMap *world = NULL;
+    ThreadPool *pool = NULL;
+    std::vector<PointLight> lights;
+    std::vector<LightRegion> regions;
+    std::vector<uint16_t> floorSum, faceSum; // wraps past ~257 full lights on one sample
+
+    int sample(const PointLight &l, float px, float py, float nx, float ny) const;
+    void bakeLight(int i);
+    void applyLight(int i, int sign);
+    void resolve(int x0, int y0, int x1, int y1);
+    void bakeAll(const std::vector<int> &which);
+
+public:
+    uint8_t ambient = 96;
+    int floorW = 0, floorH = 0;
+    std::vector<uint8_t> floorLight; // texel (tx, ty) at tx * floorH + ty
+    std::vector<uint8_t> faceLight;  // (x * h + y) * 4 + face
+
+    int relit = 0; // lights rebaked by the last onCellsChanged()
+
+    void build(const WorldMap &_world, ThreadPool *_pool = NULL);
+    int addLight(const PointLight &light);
+    void setAmbient(uint8_t level);
+    void onCellsChanged(int x0, int y0, int x1, int y1); // inclusive cell rect
+    void onCellsChanged(const std::vector<MapEdits::Rect> &rects); // each light rebaked once
+    int count() const { return (int)lights.size(); }
+
+    // floor texel, ambient outside the map
+    uint8_t floorLevel(int tx, int ty) const
+    {
+        if ((unsigned)tx >= (unsigned)floorW || (unsigned)ty >= (unsigned)floorH)
+            return ambient;
+        return floorLight[(size_t)tx * floorH + ty];
+    }
+    uint8_t faceLevel(int x, int y, int face) const { return faceLight[((size_t)x * world->h + y) * 4 + face]; }
+
+    // floorLight then faceLight, four levels per word, for the shader
+    std::vector<uint32_t> exportPacked() const;
+};
+
+void LightMap::build(const WorldMap &_world, ThreadPool *_pool)
+{
+    world = &_world;
+    pool = _pool;
+    floorW = world->w * LIGHTMAP_RES;
+    floorH = world->h * LIGHTMAP_RES;
+    floorSum.assign((size_t)floorW * floorH, 0);
+    faceSum.assign((size_t)world->w * world->h * 4, 0);
+    floorLight.assign(floorSum.size(), ambient);
+    faceLight.assign(faceSum.size(), ambient);
+
+    regions.assign(lights.size(), LightRegion());
+    std::vector<int> all(lights.size());
+    for (int i = 0; i < (int)all.size(); i++)
+        all[i] = i;
+    bakeAll(all);
+    for (int i : all)
+        applyLight(i, 1);
+    resolve(0, 0, world->w - 1, world->h - 1);
+}
+
+int LightMap::addLight(const PointLight &light)
+{
+    lights.push_back(light);
+    regions.push_back(LightRegion());
+    int i = (int)lights.size() - 1;
+    if (world)
+    {
+        bakeLight(i);
+        applyLight(i, 1);
+        resolve(regions[i].x0, regions[i].y0, regions[i].x1, regions[i].y1);
+    }
+    return i;
+}
+
+void LightMap::setAmbient(uint8_t level)
+{
+    ambient = level;
+    if (world)
+        resolve(0, 0, world->w - 1, world->h - 1);
+}
+
+// level a light adds at (px, py); (nx, ny) is the face normal, 0 for floor
+int LightMap::sample(const PointLight &l, float px, float py, float nx, float ny) const
+{
+    float dx = l.x - px, dy = l.y - py;
+    float dist = sqrtf(dx * dx + dy * dy);
+    if (dist >= l.radius)
+        return 0;
+    float k = l.intensity * (1.f - dist / l.radius);
+    if (nx != 0 || ny != 0)
+    {
+        float facing = dist > 0 ? (nx * dx + ny * dy) / dist : 0.f;
+        if (facing <= 0)
+            return 0;
+        k *= facing;
+    }
+    int level = int(k * 255.f + 0.5f);
+    if (level <= 0)
+        return 0;
+    Segment s = {l.x, l.y, px, py};
+    if (!segmentClear(*world, s))
+        return 0;
+    return level > 255 ? 255 : level;
+}
+
+void LightMap::bakeLight(int i)
+{
+    static const int fdx[4] = {-1, 1, 0, 0};
+    static const int fdy[4] = {0, 0, -1, 1};
+
+    const PointLight &l = lights[i];
+    LightRegion &r = regions[i];
+    r.x0 = std::max(int(floorf(l.x - l.radius)), 0);
+    r.y0 = std::max(int(floorf(l.y - l.radius)), 0);
+    r.x1 = std::min(int(floorf(l.x + l.radius)), world->w - 1);
+    r.y1 = std::min(int(floorf(l.y + l.radius)), world->h - 1);
+    int cw = std::max(r.x1 - r.x0 + 1, 0), ch = std::max(r.y1 - r.y0 + 1, 0);
+    r.floor.assign((size_t)cw * ch * LIGHTMAP_RES * LIGHTMAP_RES, 0);
+    r.faces.assign((size_t)cw * ch * 4, 0);
+
+    // a light inside a wall lights nothing
+    if (!world->inside(int(l.x), int(l.y)) || world->solid(int(l.x), int(l.y)))
+        return;
+
+    int rh = ch * LIGHTMAP_RES;
+    for (int x = r.x0; x <= r.x1; x++)
+        for (int y = r.y0; y <= r.y1; y++)
+        {
+            if (!world->solid(x, y))
+            {
+                for (int tx = 0; tx < LIGHTMAP_RES; tx++)
+                    for (int ty = 0; ty < LIGHTMAP_RES; ty++)
+                    {
+                        float px = x + (tx + 0.5f) / LIGHTMAP_RES, py = y + (ty + 0.5f) / LIGHTMAP_RES;
+                        size_t t = (size_t)((x - r.x0) * LIGHTMAP_RES + tx) * rh + (y - r.y0) * LIGHTMAP_RES + ty;
+                        r.floor[t] = (uint8_t)sample(l, px, py, 0, 0);
+                    }
+                continue;
+            }
+            for (int f = 0; f < 4; f++)
+            {
+                int ox = x + fdx[f], oy = y + fdy[f];
+                if (!world->inside(ox, oy) || world->solid(ox, oy))
+                    continue;
+                float px = x + 0.5f + fdx[f] * (0.5f + LIGHT_FACE_EPS);
+                float py = y + 0.5f + fdy[f] * (0.5f + LIGHT_FACE_EPS);
+                r.faces[((size_t)(x - r.x0) * ch + (y - r.y0)) * 4 + f] = (uint8_t)sample(l, px, py, (float)fdx[f], (float)fdy[f]);
+            }
+        }
+}
+
+void LightMap::applyLight(int i, int sign)
+{
+    const LightRegion &r = regions[i];
+    int cw = r.x1 - r.x0 + 1, ch = r.y1 - r.y0 + 1;
+    if (cw <= 0 || ch <= 0)
+        return;
+    int rh = ch * LIGHTMAP_RES;
+    for (int tx = 0; tx < cw * LIGHTMAP_RES; tx++)
+    {
+        uint16_t *dst = floorSum.data() + (size_t)(r.x0 * LIGHTMAP_RES + tx) * floorH + r.y0 * LIGHTMAP_RES;
+        const uint8_t *src = r.floor.data() + (size_t)tx * rh;
+        for (int ty = 0; ty < rh; ty++)
+            dst[ty] = (uint16_t)(dst[ty] + sign * src[ty]);
+    }
+    for (int x = 0; x < cw; x++)
+    {
+        uint16_t *dst = faceSum.data() + ((size_t)(r.x0 + x) * world->h + r.y0) * 4;
+        const uint8_t *src = r.faces.data() + (size_t)x * ch * 4;
+        for (int k = 0; k < ch * 4; k++)
+            dst[k] = (uint16_t)(dst[k] + sign * src[k]);
+    }
+}
+
+void LightMap::resolve(int x0, int y0, int x1, int y1)
+{
+    for (int tx = x0 * LIGHTMAP_RES; tx < (x1 + 1) * LIGHTMAP_RES; tx++)
+        for (int ty = y0 * LIGHTMAP_RES; ty < (y1 + 1) * LIGHTMAP_RES; ty++)
+        {
+            size_t t = (size_t)tx * floorH + ty;
+            int v = ambient + floorSum[t];
+            floorLight[t] = (uint8_t)(v > 255 ? 255 : v);
+        }
+    for (int x = x0; x <= x1; x++)
+        for (int k = y0 * 4; k < (y1 + 1) * 4; k++)
+        {
+            size_t t = (size_t)x * world->h * 4 + k;
+            int v = ambient + faceSum[t];
+            faceLight[t] = (uint8_t)(v > 255 ? 255 : v);
+        }
+}
+
+// regions are independent, so baking splits across the pool
+void LightMap::bakeAll(const std::vector<int> &which)
+{
+    if (!pool) {
+        for (int i : which)
+            bakeLight(i);
+        return;
+    }
+    pool->parallelFor((int)which.size(), 8, [&](int begin, int end) {
+        for (int k = begin; k < end; k++)
+            bakeLight(which[k]);
+    });
+}
+
+void LightMap::onCellsChanged(int x0, int y0, int x1, int y1)
+{
+    onCellsChanged(std::vector<MapEdits::Rect>(1, MapEdits::Rect{x0, y0, x1, y1}));
+}
+
+void LightMap::onCellsChanged(const std::vector<MapEdits::Rect> &rects)
+{
+    std::vector<int> touched;
+    for (int i = 0; i < (int)lights.size(); i++)
+    {
+        const LightRegion &r = regions[i];
+        for (const MapEdits::Rect &e : rects)
+        {
+            // faces also depend on the cell in front of them
+            if (e.x1 + 1 < r.x0 || e.x0 - 1 > r.x1 || e.y1 + 1 < r.y0 || e.y0 - 1 > r.y1)
+                continue;
+            touched.push_back(i);
+            applyLight(i, -1);
+            break;
+        }
+    }
+    bakeAll(touched);
+    for (int i : touched)
+    {
+        applyLight(i, 1);
+        resolve(regions[i].x0, regions[i].y0, regions[i].x1, regions[i].y1);
+    }
+    relit = (int)touched.size();
+}
+
+std::vector<uint32_t> LightMap::exportPacked() const
+{
+    size_t n = floorLight.size() + faceLight.size();
+    std::vector<uint32_t> packed((n + 3) / 4, 0);
+    for (size_t i = 0; i < n; i++)
+    {
+        uint32_t v = i < floorLight.size() ? floorLight[i] : faceLight[i - floorLight.size()];
+        packed[i >> 2] |= v << ((i & 3) * 8);
+    }
+    return packed;
+}
@@ -0,0 +1,103 @@
+#pragma once
+
+#include <cstdint>
+#include <cstdlib>
+#include <math.h>
+#include <vector>
+
+#include "WorldMap.h"
+#include "ThreadPool.h"
+
+// Batch "can A see B" queries over the occupancy plane. Each segment is
+// walked with the same DDA as the renderer, parametrised so the ray reaches
+// B at t = 1. The number of cells between the two end cells is known up
+// front (|dx cells| + |dy cells|), which is the loop bound; the walk stops
+// early on the first solid cell. The start and end cells are not tested, so
+// an actor standing in a doorway can still be seen.
+
+struct Segment
+{
+    float fromX, fromY;
+    float toX, toY;
+};
+
+// true when nothing blocks the segment. hitDist gets the distance from
+// `from` to the blocking cell boundary, or the segment length when clear.
+bool segmentClear(const WorldMap &world, const Segment &s, float *hitDist = NULL)
+{
+    float rayDirX = s.toX - s.fromX;
+    float rayDirY = s.toY - s.fromY;
+
+    int mapX = int(s.fromX), mapY = int(s.fromY);
+    int endX = int(s.toX), endY = int(s.toY);
+    int cells = abs(endX - mapX) + abs(endY - mapY);
+
+    float deltaDistX = (rayDirX == 0) ? 1e30f : fabsf(1 / rayDirX);
+    float deltaDistY = (rayDirY == 0) ? 1e30f : fabsf(1 / rayDirY);
+
+    int stepX, stepY;
+    float sideDistX, sideDistY;
+    if (rayDirX < 0) {
+        stepX = -1;
+        sideDistX = (s.fromX - mapX) * deltaDistX;
+    } else {
+        stepX = 1;
+        sideDistX = (mapX + 1.0f - s.fromX) * deltaDistX;
+    }
+    if (rayDirY < 0) {
+        stepY = -1;
+        sideDistY = (s.fromY - mapY) * deltaDistY;
+    } else {
+        stepY = 1;
+        sideDistY = (mapY + 1.0f - s.fromY) * deltaDistY;
+    }
+
+    const uint64_t *occ = world.occupancy.data();
+    const long long rowBits = (long long)world.occRowBits;
+    long long bit = (long long)mapX * rowBits + mapY;
+
+    // the last step lands in the end cell, which is not tested
+    for (int i = 1; i < cells; i++)
+    {
+        float t;
+        if (sideDistX < sideDistY) {
+            t = sideDistX;
+            sideDistX += deltaDistX;
+            mapX += stepX;
+            bit += stepX > 0 ? rowBits : -rowBits;
+        } else {
+            t = sideDistY;
+            sideDistY += deltaDistY;
+            mapY += stepY;
+            bit += stepY;
+        }
+        if (!world.inside(mapX, mapY) || ((occ[bit >> 6] >> (bit & 63)) & 1)) {
+            if (hitDist)
+                *hitDist = t * sqrtf(rayDirX * rayDirX + rayDirY * rayDirY);
+            return false;
+        }
+    }
+    if (hitDist)
+        *hitDist = sqrtf(rayDirX * rayDirX + rayDirY * rayDirY);
+    return true;
+}
+
+// Runs count queries on the pool. visible gets bit i set for every clear
+// segment i and must hold (count + 63) / 64 words; hitDist is optional.
+// Chunks are whole 64 query words, so threads never share an output word.
+void lineOfSightBatch(const WorldMap &world, const Segment *segments, int count, uint64_t *visible, float *hitDist, ThreadPool *pool)
+{
+    int words = (count + 63) / 64;
+    pool->parallelFor(words, 64, [&](int begin, int end) {
+        for (int wi = begin; wi < end; wi++)
+        {
+            uint64_t mask = 0;
+            int first = wi * 64;
+            int last = first + 64 < count ? first + 64 : count;
+            for (int i = first; i < last; i++)
+                if (segmentClear(world, segments[i], hitDist ? hitDist + i : NULL))
+                    mask |= 1ull << (i - first);
+            visible[wi] = mask;
+        }
+    });
+}
@@ -0,0 +1,174 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+#include <algorithm>
+
+#include "WorldMap.h"
+
+// Map edits queued during a frame and applied together at the frame
+// boundary, so the CPU engine never sees half an edit batch. apply() writes
+// them into the WorldMap and coalesces the touched cells into ranges of the
+// GPU map buffer (cells x * h + y, one int each, WorldMap::exportCell):
+// dirty cells closer than mergeGap join one range, since re-sending a few
+// clean ints is cheaper than another glBufferSubData call. Batches that
+// still need more than maxRanges calls (edits scattered over the map) come
+// out as (cell, value) pairs instead, one upload for a scatter pass on the
+// GPU side (shaders/map_scatter.glsl). Every applied edit is also
+// collected into rects, one per touched MAP_EDIT_TILE block, for the caches
+// keyed on map regions: Game passes them to HeightField (cell values and
+// floor kinds, which set ceilings) and to LightMap (cell values).
+// VisibilityCache and FlowFields onCellsChanged take the same rects.
+
+#define MAP_EDIT_TILE_SHIFT 4
+#define MAP_EDIT_TILE (1 << MAP_EDIT_TILE_SHIFT)
+
+class MapEdits
+{
+public:
+    struct Range
+    {
+        size_t first, count; // in cells
+    };
+    struct Rect
+    {
+        int x0, y0, x1, y1; // inclusive
+    };
+
+    int mergeGap = 16;
+    size_t maxRanges = 64;
+
+    // results of the last apply(), either ranges or scatter
+    std::vector<Range> ranges;
+    std::vector<int> scatter; // cell, exportCell value
+    std::vector<Rect> rects;
+    Rect bounds = {0, 0, -1, -1}; // of all rects, empty when x1 < x0
+    size_t applied = 0;
+    bool valuesChanged = false;   // some cell value changed, not only floors or doors
+    bool floorsChanged = false;   // some floor kind changed
+
+    void set(int x, int y, uint8_t value) { edits.push_back({x, y, EDIT_CELL, value}); }
+    void setFloor(int x, int y, uint8_t kind) { edits.push_back({x, y, EDIT_FLOOR, kind}); }
+    void setOpen(int x, int y, float fraction)
+    {
+        int v = fraction <= 0.f ? 0 : (fraction >= 1.f ? 255 : int(fraction * 255.f + 0.5f));
+        edits.push_back({x, y, EDIT_OPEN, (uint8_t)v});
+    }
+    size_t pending() const { return edits.size(); }
+
+    void apply(WorldMap &world);
+    size_t uploadCells() const;
+
+private:
+    enum { EDIT_CELL, EDIT_FLOOR, EDIT_OPEN };
+    struct Edit
+    {
+        int x, y;
+        uint8_t kind, value;
+    };
+
+    std::vector<Edit> edits;
+    std::vector<size_t> dirty;
+    std::vector<int> tileRect; // rect index per tile, -1 when untouched
+    std::vector<int> rectTile;
+};
+
+// edits outside the map are dropped
+void MapEdits::apply(WorldMap &world)
+{
+    ranges.clear();
+    scatter.clear();
+    rects.clear();
+    bounds = {0, 0, -1, -1};
+    dirty.clear();
+    applied = 0;
+    valuesChanged = false;
+    floorsChanged = false;
+
+    int tilesY = (world.h + MAP_EDIT_TILE - 1) >> MAP_EDIT_TILE_SHIFT;
+    size_t tiles = (size_t)((world.w + MAP_EDIT_TILE - 1) >> MAP_EDIT_TILE_SHIFT) * tilesY;
+    if (tileRect.size() != tiles)
+        tileRect.assign(tiles, -1);
+
+    for (size_t i = 0; i < edits.size(); i++)
+    {
+        const Edit &e = edits[i];
+        if (!world.inside(e.x, e.y))
+            continue;
+        size_t cell = (size_t)e.x * world.h + e.y;
+        if (e.kind == EDIT_CELL) {
+            valuesChanged |= world.get(e.x, e.y) != e.value;
+            world.set(e.x, e.y, e.value);
+        } else if (e.kind == EDIT_FLOOR) {
+            floorsChanged |= world.floors[cell] != e.value;
+            world.floors[cell] = e.value;
+        } else {
+            world.open[cell] = e.value;
+        }
+        dirty.push_back(cell);
+        applied++;
+
+        size_t tile = (size_t)(e.x >> MAP_EDIT_TILE_SHIFT) * tilesY + (e.y >> MAP_EDIT_TILE_SHIFT);
+        if (tileRect[tile] < 0) {
+            tileRect[tile] = (int)rects.size();
+            rectTile.push_back((int)tile);
+            rects.push_back({e.x, e.y, e.x, e.y});
+        } else {
+            Rect &r = rects[tileRect[tile]];
+            r.x0 = std::min(r.x0, e.x);
+            r.y0 = std::min(r.y0, e.y);
+            r.x1 = std::max(r.x1, e.x);
+            r.y1 = std::max(r.y1, e.y);
+        }
+    }
+    edits.clear();
+
+    for (size_t i = 0; i < rects.size(); i++)
+    {
+        const Rect &r = rects[i];
+        tileRect[rectTile[i]] = -1;
+        if (i == 0) {
+            bounds = r;
+        } else {
+            bounds.x0 = std::min(bounds.x0, r.x0);
+            bounds.y0 = std::min(bounds.y0, r.y0);
+            bounds.x1 = std::max(bounds.x1, r.x1);
+            bounds.y1 = std::max(bounds.y1, r.y1);
+        }
+    }
+    rectTile.clear();
+
+    std::sort(dirty.begin(), dirty.end());
+    dirty.erase(std::unique(dirty.begin(), dirty.end()), dirty.end());
+    for (size_t i = 0; i < dirty.size(); i++)
+    {
+        if (!ranges.empty() && dirty[i] <= ranges.back().first + ranges.back().count + mergeGap)
+            ranges.back().count = dirty[i] + 1 - ranges.back().first;
+        else
+            ranges.push_back({dirty[i], 1});
+    }
+
+    // past half of the map one upload of everything is cheaper
+    size_t total = (size_t)world.w * world.h;
+    if (uploadCells() * 2 > total) {
+        ranges.clear();
+        ranges.push_back({0, total});
+    } else if (ranges.size() > maxRanges) {
+        ranges.clear();
+        scatter.resize(dirty.size() * 2);
+        for (size_t i = 0; i < dirty.size(); i++)
+        {
+            scatter[i * 2] = (int)dirty[i];
+            scatter[i * 2 + 1] = world.exportCell(int(dirty[i] / world.h), int(dirty[i] % world.h));
+        }
+    }
+}
+
+size_t MapEdits::uploadCells() const
+{
+    size_t n = 0;
+    for (size_t i = 0; i < ranges.size(); i++)
+        n += ranges[i].count;
+    return n;
+}
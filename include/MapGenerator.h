@@ -0,0 +1,226 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+#include <algorithm>
+
+#include "WorldMap.h"
+#include "ThreadPool.h"
+
+// Deterministic seeded maps for benchmarks and stress tests. Every style is
+// a pure function of (seed, x, y) and the map size, built from hashes of
+// the cell or of the block around it, so any chunk of a 1M x 1M world can
+// be produced on its own, in any order, and always comes out the same:
+// generate() fills a whole WorldMap, generateRegion() streams a rect into
+// one and fillChunk() writes raw cell values for stores that are not a
+// WorldMap. density (0..1) is how much of the map blocks sight.
+//
+//  MAZE   binary tree maze on odd cells (perfect, every room reachable),
+//         low density knocks extra holes into the walls
+//  ROOMS  one room per GEN_ROOM_REGION block, L corridors to shared door
+//         points on the block borders; density shrinks the rooms
+//  ARENA  open floor with pillars on a GEN_PILLAR_BLOCK grid, density is
+//         the share of blocks with a pillar
+//  CITY   GEN_CITY_BLOCK blocks of buildings between 3 wide streets, low
+//         density adds alleys and courtyards
+
+enum MapStyle {
+    MAP_STYLE_MAZE = 0,
+    MAP_STYLE_ROOMS = 1,
+    MAP_STYLE_ARENA = 2,
+    MAP_STYLE_CITY = 3,
+};
+
+#define GEN_ROOM_REGION 32
+#define GEN_PILLAR_BLOCK 6
+#define GEN_CITY_BLOCK 16
+#define GEN_CITY_STREET 3
+
+class MapGenerator
+{
+private:
+    uint32_t hash(int x, int y, uint32_t salt) const
+    {
+        uint32_t h = seed ^ (salt * 0x9E3779B9u);
+        h ^= (uint32_t)x * 0x85EBCA6Bu;
+        h = (h ^ (h >> 15)) * 0x2C1B3C6Du;
+        h ^= (uint32_t)y * 0xC2B2AE35u;
+        h = (h ^ (h >> 13)) * 0x297A2D39u;
+        return h ^ (h >> 16);
+    }
+    // uniform in [0, 1)
+    float unit(int x, int y, uint32_t salt) const { return (hash(x, y, salt) >> 8) * (1.f / 16777216.f); }
+
+    uint8_t maze(int x, int y) const;
+    uint8_t rooms(int x, int y) const;
+    uint8_t arena(int x, int y) const;
+    uint8_t city(int x, int y) const;
+
+public:
+    MapStyle style = MAP_STYLE_MAZE;
+    uint32_t seed = 1;
+    float density = 0.5f;
+    int w = 0, h = 0;
+
+    MapGenerator() {}
+    MapGenerator(MapStyle _style, uint32_t _seed, int _w, int _h, float _density = 0.5f)
+        : style(_style), seed(_seed), density(_density), w(_w), h(_h) {}
+
+    // 0 open, otherwise the wall value; outside the map and its border are walls
+    uint8_t cell(int x, int y) const;
+
+    void fillChunk(int x0, int y0, int cw, int ch, uint8_t *out) const; // out[(x - x0) * ch + y - y0]
+    void generateRegion(WorldMap &world, int x0, int y0, int x1, int y1) const; // inclusive rect
+    void generate(WorldMap &world, ThreadPool *pool = NULL) const;
+};
+
+uint8_t MapGenerator::cell(int x, int y) const
+{
+    if (x <= 0 || y <= 0 || x >= w - 1 || y >= h - 1)
+        return 1;
+    switch (style) {
+        case MAP_STYLE_ROOMS: return rooms(x, y);
+        case MAP_STYLE_ARENA: return arena(x, y);
+        case MAP_STYLE_CITY: return city(x, y);
+        default: return maze(x, y);
+    }
+}
+
+uint8_t MapGenerator::maze(int x, int y) const
+{
+    // rooms at odd cells; each room opens north (+y) or east (+x), the last
+    // row only east and the last column only north
+    int roomsX = (w - 1) / 2, roomsY = (h - 1) / 2;
+    if (x > roomsX * 2 || y > roomsY * 2)
+        return 1;
+    bool oddX = x & 1, oddY = y & 1;
+    if (oddX && oddY)
+        return 0;
+    if (!oddX && !oddY)
+        return 1;
+
+    // the wall between room (i, j) and the next one along x or y
+    int i = oddX ? x / 2 : x / 2 - 1;
+    int j = oddY ? y / 2 : y / 2 - 1;
+    bool north;
+    if (i == roomsX - 1)
+        north = true;
+    else if (j == roomsY - 1)
+        north = false;
+    else
+        north = hash(i, j, 1) & 1;
+    if (north == oddX)
+        return 0;
+    return unit(x, y, 2) < (1.f - density) * 0.3f ? 0 : 1;
+}
+
+uint8_t MapGenerator::rooms(int x, int y) const
+{
+    const int R = GEN_ROOM_REGION;
+    int rx = x / R, ry = y / R;
+    int lx = x - rx * R, ly = y - ry * R;
+
+    // the room: size shrinks with density, placed inside a 2 cell margin
+    int maxSize = R - 4;
+    int minSize = 4;
+    float scale = 1.f - 0.7f * density;
+    int rw = minSize + int((maxSize - minSize) * scale * unit(rx, ry, 3));
+    int rh = minSize + int((maxSize - minSize) * scale * unit(rx, ry, 4));
+    int ox = 2 + int((maxSize - rw) * unit(rx, ry, 5));
+    int oy = 2 + int((maxSize - rh) * unit(rx, ry, 6));
+    if (lx >= ox && lx < ox + rw && ly >= oy && ly < oy + rh)
+        return 0;
+
+    // corridors from the room centre to the door points this block shares
+    // with its neighbours (hashed on the lower of the two blocks)
+    int cx = ox + rw / 2, cy = oy + rh / 2;
+    int regionsX = (w + R - 1) / R, regionsY = (h + R - 1) / R;
+    if (rx + 1 < regionsX) {
+        int door = 2 + int(hash(rx, ry, 7) % (R - 4));
+        if ((ly == door && lx >= cx) || (lx == cx && ly >= std::min(cy, door) && ly <= std::max(cy, door)))
+            return 0;
+    }
+    if (rx > 0) {
+        int door = 2 + int(hash(rx - 1, ry, 7) % (R - 4));
+        if ((ly == door && lx <= cx) || (lx == cx && ly >= std::min(cy, door) && ly <= std::max(cy, door)))
+            return 0;
+    }
+    if (ry + 1 < regionsY) {
+        int door = 2 + int(hash(rx, ry, 8) % (R - 4));
+        if ((lx == door && ly >= cy) || (ly == cy && lx >= std::min(cx, door) && lx <= std::max(cx, door)))
+            return 0;
+    }
+    if (ry > 0) {
+        int door = 2 + int(hash(rx, ry - 1, 8) % (R - 4));
+        if ((lx == door && ly <= cy) || (ly == cy && lx >= std::min(cx, door) && lx <= std::max(cx, door)))
+            return 0;
+    }
+    return 1;
+}
+
+uint8_t MapGenerator::arena(int x, int y) const
+{
+    const int P = GEN_PILLAR_BLOCK;
+    int bx = x / P, by = y / P;
+    if (unit(bx, by, 9) >= density)
+        return 0;
+    // 1 or 2 cells wide, always a free lane around it
+    int size = 1 + (hash(bx, by, 10) & 1);
+    int px = 1 + int(hash(bx, by, 11) % (P - 1 - size));
+    int py = 1 + int(hash(bx, by, 12) % (P - 1 - size));
+    int lx = x - bx * P, ly = y - by * P;
+    return lx >= px && lx < px + size && ly >= py && ly < py + size ? 2 : 0;
+}
+
+uint8_t MapGenerator::city(int x, int y) const
+{
+    const int B = GEN_CITY_BLOCK, S = GEN_CITY_STREET;
+    int bx = x / B, by = y / B;
+    int lx = x - bx * B, ly = y - by * B;
+    if (lx < S || ly < S)
+        return 0;
+
+    float open = 1.f - density;
+    // an alley across the block
+    if (unit(bx, by, 13) < open) {
+        int at = S + 1 + int(hash(bx, by, 14) % (B - S - 2));
+        if ((hash(bx, by, 15) & 1 ? lx : ly) == at)
+            return 0;
+    }
+    // a courtyard in the middle
+    if (unit(bx, by, 16) < open * 0.5f && lx >= S + 3 && ly >= S + 3 && lx < B - 3 && ly < B - 3)
+        return 0;
+    return 3;
+}
+
+void MapGenerator::fillChunk(int x0, int y0, int cw, int ch, uint8_t *out) const
+{
+    for (int x = 0; x < cw; x++)
+        for (int y = 0; y < ch; y++)
+            out[(size_t)x * ch + y] = cell(x0 + x, y0 + y);
+}
+
+void MapGenerator::generateRegion(WorldMap &world, int x0, int y0, int x1, int y1) const
+{
+    x0 = std::max(x0, 0);
+    y0 = std::max(y0, 0);
+    x1 = std::min(x1, world.w - 1);
+    y1 = std::min(y1, world.h - 1);
+    for (int x = x0; x <= x1; x++)
+        for (int y = y0; y <= y1; y++)
+            world.set(x, y, cell(x, y));
+}
+
+// rows along x go to different threads: a row's occupancy bits are whole
+// words of their own, so no two threads write the same word
+void MapGenerator::generate(WorldMap &world, ThreadPool *pool) const
+{
+    world.resize(w, h, world.layout);
+    if (!pool) {
+        generateRegion(world, 0, 0, w - 1, h - 1);
+        return;
+    }
+    pool->parallelFor(w, 16, [&](int begin, int end) {
+        generateRegion(world, begin, 0, end - 1, h - 1);
+    });
+}
@@ -0,0 +1,117 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+#include <algorithm>
+#include <unordered_map>
+
+// 8 bit palette textures and a colormap in the style of the old software
+// renderers. quantizeTexture() turns an RGB(A) image into palette indices
+// (median cut, at most 256 colours). ColorMap holds every palette colour
+// pre-shaded for COLORMAP_LIGHTS light levels x COLORMAP_FOGS fog levels,
+// so lighting and fog together are one table lookup per pixel.
+
+#define COLORMAP_LIGHTS 32
+#define COLORMAP_FOGS 32
+
+struct Palette
+{
+    uint32_t colors[256]; // packed like packRGBA
+    int count = 0;
+};
+
+// indices row major like data; palette gets the colours in use
+void quantizeTexture(const unsigned char *data, int w, int h, int channels, Palette &palette, std::vector<uint8_t> &indices)
+{
+    struct Box { int begin, end, range, shift; };
+    std::vector<uint32_t> pixels((size_t)w * h);
+    for (size_t i = 0; i < pixels.size(); i++)
+    {
+        const unsigned char *p = data + i * channels;
+        pixels[i] = p[0] | (p[1] << 8) | (p[2] << 16);
+    }
+    std::vector<uint32_t> sorted = pixels;
+    std::sort(sorted.begin(), sorted.end());
+    sorted.erase(std::unique(sorted.begin(), sorted.end()), sorted.end());
+
+    // widest channel of a box, measured once when the box is made
+    auto makeBox = [&](int begin, int end) {
+        Box box = {begin, end, 0, 0};
+        for (int shift = 0; shift < 24; shift += 8)
+        {
+            int lo = 255, hi = 0;
+            for (int i = begin; i < end; i++)
+            {
+                int v = (sorted[i] >> shift) & 0xFF;
+                lo = std::min(lo, v);
+                hi = std::max(hi, v);
+            }
+            if (hi - lo > box.range) {
+                box.range = hi - lo;
+                box.shift = shift;
+            }
+        }
+        return box;
+    };
+
+    // split the box with the widest channel at its median until there are
+    // 256 boxes or no box has two colours left
+    std::vector<Box> boxes;
+    boxes.push_back(makeBox(0, (int)sorted.size()));
+    while (boxes.size() < 256)
+    {
+        int best = -1;
+        for (int b = 0; b < (int)boxes.size(); b++)
+            if (boxes[b].range > 0 && (best < 0 || boxes[b].range > boxes[best].range))
+                best = b;
+        if (best < 0)
+            break;
+        Box box = boxes[best];
+        std::sort(sorted.begin() + box.begin, sorted.begin() + box.end, [&](uint32_t a, uint32_t b) {
+            return ((a >> box.shift) & 0xFF) < ((b >> box.shift) & 0xFF);
+        });
+        int mid = (box.begin + box.end) / 2;
+        boxes[best] = makeBox(box.begin, mid);
+        boxes.push_back(makeBox(mid, box.end));
+    }
+
+    palette.count = (int)boxes.size();
+    std::unordered_map<uint32_t, uint8_t> lookup;
+    for (int b = 0; b < palette.count; b++)
+    {
+        uint32_t r = 0, g = 0, bl = 0, n = boxes[b].end - boxes[b].begin;
+        for (int i = boxes[b].begin; i < boxes[b].end; i++)
+        {
+            r += sorted[i] & 0xFF;
+            g += (sorted[i] >> 8) & 0xFF;
+            bl += (sorted[i] >> 16) & 0xFF;
+            lookup[sorted[i]] = (uint8_t)b;
+        }
+        palette.colors[b] = n ? ((r / n) | ((g / n) << 8) | ((bl / n) << 16) | 0xFF000000u) : 0xFF000000u;
+    }
+    for (int b = palette.count; b < 256; b++)
+        palette.colors[b] = 0xFF000000u;
+
+    indices.resize(pixels.size());
+    for (size_t i = 0; i < pixels.size(); i++)
+        indices[i] = lookup[pixels[i]];
+}
+
+// rows are filled by CpuRenderer::buildColorMap() with the same shade and
+// fog steps as its RGBA path
+class ColorMap
+{
+public:
+    std::vector<uint32_t> table; // COLORMAP_LIGHTS * COLORMAP_FOGS rows of 256
+    uint32_t fog = 0;            // fog colour the table was built for
+
+    uint32_t *levelRow(int l, int f) { return table.data() + ((size_t)l * COLORMAP_FOGS + f) * 256; }
+
+    // light in [0, 255], fog t in [0, 256] as CpuRenderer::fogFloat()
+    const uint32_t *row(int light, int fogT) const
+    {
+        int l = (light * (COLORMAP_LIGHTS - 1) + 127) / 255;
+        int f = (fogT * (COLORMAP_FOGS - 1) + 128) / 256;
+        return table.data() + ((size_t)l * COLORMAP_FOGS + f) * 256;
+    }
+};
@@ -0,0 +1,13 @@
+#pragma once
+
+// Per frame render options shared by the compute shader and CpuRenderer.
+// Rays stop once the next cell boundary is further than maxDistance, so a
+// ray costs at most about maxDistance * (|rayDirX| + |rayDirY|) + 2 DDA
+// steps whatever the map looks like. Everything between fogStart and
+// maxDistance fades towards fogColor, which hides the cut.
+struct RenderSettings
+{
+    float maxDistance = 64.f;
+    float fogStart = 48.f;
+    float fogColor[3] = {0.f, 0.f, 0.f};
+};
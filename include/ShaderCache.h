@@ -0,0 +1,271 @@
+#pragma once
+
+#include <glad/glad.h>
+
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <filesystem>
+
+// Linked programs kept on disk as glGetProgramBinary blobs, one file per
+// program, keyed by a hash of its sources and the driver's vendor,
+// renderer and version strings, so a driver update or an edited shader
+// misses instead of loading a stale binary. A binary the driver refuses
+// anyway is dropped and the program is compiled from source. Mesa only
+// offers a binary format while its own shader cache is on; without one
+// this is a plain compile.
+//
+// begin() starts a program and finish() waits for it. Starting every
+// program before finishing the first lets a driver with
+// KHR_parallel_shader_compile (Mesa has it) compile them at once while the
+// caller keeps setting up buffers and textures in between.
+
+#define SHADER_CACHE_MAGIC 0x31435352u // "RSC1"
+#define GL_MAX_SHADER_COMPILER_THREADS_KHR_ALL 0xFFFFFFFFu
+
+typedef void (APIENTRYP PFNGLMAXSHADERCOMPILERTHREADSKHRPROC)(GLuint count);
+
+class ShaderCache
+{
+public:
+    struct Stage
+    {
+        GLenum type;
+        const std::string *source;
+    };
+
+private:
+    struct Program
+    {
+        std::string name;
+        GLuint program = 0;
+        std::vector<GLuint> shaders; // empty when it came from the cache
+        uint64_t key = 0;
+    };
+
+    std::string dir;
+    std::string driver;
+    std::vector<Program> programs;
+
+    uint64_t hash(const std::vector<Stage> &stages) const;
+    std::string path(const Program &p) const;
+    bool loadBinary(const Program &p);
+    void saveBinary(const Program &p);
+    static bool hasExtension(const char *name);
+
+public:
+    bool parallel = false; // the driver compiles in the background
+    bool binaries = false; // the driver has a binary format and dir is set
+
+    // stats
+    int loaded = 0, compiled = 0, rejected = 0;
+
+    // with a current context; dir empty disables the disk cache
+    void init(const std::string &_dir, void *(*getProc)(const char *));
+    int begin(const std::string &name, const std::vector<Stage> &stages); // a ticket for finish()
+    GLuint finish(int ticket);
+};
+
+bool ShaderCache::hasExtension(const char *name)
+{
+    GLint count = 0;
+    glGetIntegerv(GL_NUM_EXTENSIONS, &count);
+    for (GLint i = 0; i < count; i++)
+        if (std::string((const char *)glGetStringi(GL_EXTENSIONS, i)) == name)
+            return true;
+    return false;
+}
+
+void ShaderCache::init(const std::string &_dir, void *(*getProc)(const char *))
+{
+    dir = _dir;
+    driver = std::string((const char *)glGetString(GL_VENDOR)) + "\n" + (const char *)glGetString(GL_RENDERER) + "\n" +
+             (const char *)glGetString(GL_VERSION);
+
+    GLint formats = 0;
+    glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+    binaries = formats > 0 && !dir.empty();
+    if (binaries) {
+        std::error_code ec;
+        std::filesystem::create_directories(dir, ec);
+    }
+
+    PFNGLMAXSHADERCOMPILERTHREADSKHRPROC maxThreads = NULL;
+    if (getProc && (hasExtension("GL_KHR_parallel_shader_compile") || hasExtension("GL_ARB_parallel_shader_compile"))) {
+        maxThreads = (PFNGLMAXSHADERCOMPILERTHREADSKHRPROC)getProc("glMaxShaderCompilerThreadsKHR");
+        if (!maxThreads)
+            maxThreads = (PFNGLMAXSHADERCOMPILERTHREADSKHRPROC)getProc("glMaxShaderCompilerThreadsARB");
+    }
+    if (maxThreads)
+        maxThreads(GL_MAX_SHADER_COMPILER_THREADS_KHR_ALL);
+    parallel = maxThreads != NULL;
+}
+
+// FNV-1a over the driver strings, then every stage's type and source
+uint64_t ShaderCache::hash(const std::vector<Stage> &stages) const
+{
+    uint64_t h = 0xcbf29ce484222325ull;
+    auto add = [&](const char *p, size_t n) {
+        for (size_t i = 0; i < n; i++)
+            h = (h ^ (uint8_t)p[i]) * 0x100000001b3ull;
+    };
+    add(driver.data(), driver.size() + 1);
+    for (const Stage &s : stages)
+    {
+        add((const char *)&s.type, sizeof(s.type));
+        add(s.source->data(), s.source->size() + 1);
+    }
+    return h;
+}
+
+std::string ShaderCache::path(const Program &p) const
+{
+    char key[17];
+    snprintf(key, sizeof(key), "%016llx", (unsigned long long)p.key);
+    return dir + "/" + p.name + "-" + key + ".bin";
+}
+
+// file: magic, key, format, then the binary
+bool ShaderCache::loadBinary(const Program &p)
+{
+    std::ifstream file(path(p), std::ios::binary);
+    if (!file)
+        return false;
+    std::vector<char> data((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+    const size_t header = sizeof(uint32_t) + sizeof(uint64_t) + sizeof(GLenum);
+    if (data.size() <= header)
+        return false;
+    uint32_t magic;
+    uint64_t key;
+    GLenum format;
+    memcpy(&magic, data.data(), sizeof(magic));
+    memcpy(&key, data.data() + sizeof(magic), sizeof(key));
+    memcpy(&format, data.data() + sizeof(magic) + sizeof(key), sizeof(format));
+    if (magic != SHADER_CACHE_MAGIC || key != p.key)
+        return false;
+
+    glProgramBinary(p.program, format, data.data() + header, (GLsizei)(data.size() - header));
+    GLint ok = GL_FALSE;
+    glGetProgramiv(p.program, GL_LINK_STATUS, &ok);
+    if (ok != GL_TRUE) {
+        rejected++;
+        return false;
+    }
+    return true;
+}
+
+void ShaderCache::saveBinary(const Program &p)
+{
+    GLint length = 0;
+    glGetProgramiv(p.program, GL_PROGRAM_BINARY_LENGTH, &length);
+    if (length <= 0)
+        return;
+    std::vector<char> binary(length);
+    GLenum format = 0;
+    glGetProgramBinary(p.program, length, &length, &format, binary.data());
+
+    // written aside and renamed, so a crash never leaves half a binary
+    std::string target = path(p), tmp = target + ".tmp";
+    {
+        std::ofstream file(tmp, std::ios::binary);
+        uint32_t magic = SHADER_CACHE_MAGIC;
+        file.write((const char *)&magic, sizeof(magic));
+        file.write((const char *)&p.key, sizeof(p.key));
+        file.write((const char *)&format, sizeof(format));
+        file.write(binary.data(), length);
+        if (!file)
+            return;
+    }
+    std::error_code ec;
+    std::filesystem::rename(tmp, target, ec);
+    if (ec)
+        return;
+
+    // binaries of this program under older keys (edited sources, an old
+    // driver) can never load again
+    std::string prefix = p.name + "-";
+    std::string own = std::filesystem::path(target).filename().string();
+    for (const auto &entry : std::filesystem::directory_iterator(dir, ec))
+    {
+        std::string file = entry.path().filename().string();
+        if (file == own || file.size() != prefix.size() + 16 + 4 || file.compare(0, prefix.size(), prefix) != 0 ||
+            file.compare(file.size() - 4, 4, ".bin") != 0 ||
+            file.find_first_not_of("0123456789abcdef", prefix.size()) != file.size() - 4)
+            continue;
+        std::error_code removeError;
+        std::filesystem::remove(entry.path(), removeError);
+    }
+}
+
+int ShaderCache::begin(const std::string &name, const std::vector<Stage> &stages)
+{
+    Program p;
+    p.name = name;
+    p.program = glCreateProgram();
+    p.key = hash(stages);
+    if (binaries && loadBinary(p)) {
+        loaded++;
+        programs.push_back(p);
+        return (int)programs.size() - 1;
+    }
+
+    // glProgramBinary may have left it failed, start over clean
+    glDeleteProgram(p.program);
+    p.program = glCreateProgram();
+    if (binaries)
+        glProgramParameteri(p.program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+    for (const Stage &s : stages)
+    {
+        GLuint shader = glCreateShader(s.type);
+        const char *source = s.source->c_str();
+        glShaderSource(shader, 1, &source, NULL);
+        glCompileShader(shader);
+        glAttachShader(p.program, shader);
+        p.shaders.push_back(shader);
+    }
+    // status queries wait for the compile, so none here
+    glLinkProgram(p.program);
+    compiled++;
+    programs.push_back(p);
+    return (int)programs.size() - 1;
+}
+
+GLuint ShaderCache::finish(int ticket)
+{
+    Program &p = programs[ticket];
+    if (p.shaders.empty())
+        return p.program;
+
+    for (GLuint shader : p.shaders)
+    {
+        GLint ok;
+        glGetShaderiv(shader, GL_COMPILE_STATUS, &ok);
+        if (ok != GL_TRUE) {
+            GLchar infoLog[512];
+            glGetShaderInfoLog(shader, sizeof(infoLog), NULL, infoLog);
+            std::cerr << p.name << " derleme hatası: " << infoLog << std::endl;
+        }
+    }
+    GLint linked;
+    glGetProgramiv(p.program, GL_LINK_STATUS, &linked);
+    if (linked != GL_TRUE) {
+        GLchar infoLog[512];
+        glGetProgramInfoLog(p.program, sizeof(infoLog), NULL, infoLog);
+        std::cerr << p.name << " bağlama hatası: " << infoLog << std::endl;
+    } else if (binaries) {
+        saveBinary(p);
+    }
+    for (GLuint shader : p.shaders)
+    {
+        glDetachShader(p.program, shader);
+        glDeleteShader(shader);
+    }
+    p.shaders.clear();
+    return p.program;
+}
@@ -0,0 +1,220 @@
+#pragma once
+
+#include <cstdint>
+#include <cstdlib>
+#include <vector>
+#include <algorithm>
+
+#include "CpuRenderer.h"
+#include "ThreadPool.h"
+
+// Billboard pass of the CPU engine, run after CpuRenderer::render().
+//
+// 1. every sprite is projected in parallel and tested against the per bin
+//    maximum of the wall depth buffer, so sprites fully behind walls are
+//    dropped before they cost anything else
+// 2. survivors are bucketed (count, prefix sum, fill) into bins of
+//    binWidth screen columns; a sprite lands in each bin it overlaps
+// 3. bins are drawn in parallel, each one depth sorted on its own, so there
+//    is no global sort and no two threads write the same column
+
+struct Sprite
+{
+    float x, y;
+    int texture;
+    float scale = 1.f;
+};
+
+// transposed like CpuRenderer::texture, alpha 0 is transparent
+struct SpriteTexture
+{
+    int w, h;
+    std::vector<uint32_t> texels;
+};
+
+class SpriteRenderer
+{
+private:
+    ThreadPool *pool;
+
+    struct Projected
+    {
+        float depth;
+        int startX, endX;  // unclipped screen columns
+        int size;          // on screen width and height
+        int sprite;        // -1 when culled
+    };
+    std::vector<Projected> projected;
+    std::vector<float> binMaxDepth;
+    std::vector<int> binCount, binStart, binFill, binItems;
+
+    void drawBin(CpuRenderer &cpu, const std::vector<Sprite> &sprites, int bin);
+
+public:
+    int binWidth = 32;
+    std::vector<SpriteTexture> textures;
+
+    // stats of the last frame
+    int visible = 0, culledDepth = 0, culledView = 0;
+
+    SpriteRenderer(ThreadPool *_pool) : pool(_pool) {}
+
+    // 4 channels keep their alpha, 3 channels treat pure black as transparent
+    int addTexture(const unsigned char *data, int w, int h, int channels);
+    void render(CpuRenderer &cpu, const Camera &cam, const std::vector<Sprite> &sprites);
+};
+
+int SpriteRenderer::addTexture(const unsigned char *data, int w, int h, int channels)
+{
+    SpriteTexture tex;
+    tex.w = w;
+    tex.h = h;
+    tex.texels.resize((size_t)w * h);
+    for (int y = 0; y < h; y++)
+        for (int x = 0; x < w; x++)
+        {
+            const unsigned char *p = data + ((size_t)y * w + x) * channels;
+            uint32_t c = packRGBA(p[0], p[1], p[2]);
+            bool opaque = channels == 4 ? p[3] > 127 : (p[0] | p[1] | p[2]) != 0;
+            tex.texels[(size_t)x * h + y] = opaque ? c : 0;
+        }
+    textures.push_back(tex);
+    return (int)textures.size() - 1;
+}
+
+void SpriteRenderer::render(CpuRenderer &cpu, const Camera &cam, const std::vector<Sprite> &sprites)
+{
+    const int w = cpu.w, h = cpu.h;
+    const int bins = (w + binWidth - 1) / binWidth;
+    const int count = (int)sprites.size();
+
+    binMaxDepth.assign(bins, 0.f);
+    for (int x = 0; x < w; x++)
+        binMaxDepth[x / binWidth] = std::max(binMaxDepth[x / binWidth], cpu.zbuffer[x]);
+
+    float invDet = 1.0f / (cam.planeX * cam.dirY - cam.dirX * cam.planeY);
+    float maxDistance = cpu.frameSettings().maxDistance;
+
+    projected.resize(count);
+    pool->parallelFor(count, 1024, [&](int begin, int end) {
+        for (int i = begin; i < end; i++)
+        {
+            Projected &p = projected[i];
+            p.sprite = -1;
+            p.size = 0;
+
+            float spriteX = sprites[i].x - cam.posX;
+            float spriteY = sprites[i].y - cam.posY;
+            float transformX = invDet * (cam.dirY * spriteX - cam.dirX * spriteY);
+            float transformY = invDet * (-cam.planeY * spriteX + cam.planeX * spriteY);
+            if (transformY <= 0.1f || transformY >= maxDistance)
+                continue;
+
+            int screenX = int((w / 2) * (1 + transformX / transformY));
+            int size = abs(int(h / transformY * sprites[i].scale));
+            int startX = screenX - size / 2;
+            int endX = startX + size;
+            if (size == 0 || endX <= 0 || startX >= w)
+                continue;
+
+            p.depth = transformY;
+            p.startX = startX;
+            p.endX = endX;
+            p.size = size;
+
+            // early out: behind the farthest wall of every bin it touches
+            int b0 = std::max(startX, 0) / binWidth;
+            int b1 = (std::min(endX, w) - 1) / binWidth;
+            for (int b = b0; b <= b1; b++)
+                if (transformY < binMaxDepth[b]) {
+                    p.sprite = i;
+                    break;
+                }
+            if (p.sprite < 0)
+                p.size = -1; // marks a depth cull for the stats
+        }
+    });
+
+    // bucket the survivors, in sprite order so the result is deterministic
+    visible = culledDepth = culledView = 0;
+    binCount.assign(bins, 0);
+    for (int i = 0; i < count; i++)
+    {
+        const Projected &p = projected[i];
+        if (p.sprite < 0) {
+            if (p.size == -1) culledDepth++;
+            else              culledView++;
+            continue;
+        }
+        visible++;
+        for (int b = std::max(p.startX, 0) / binWidth; b <= (std::min(p.endX, w) - 1) / binWidth; b++)
+            binCount[b]++;
+    }
+    binStart.resize(bins + 1);
+    binStart[0] = 0;
+    for (int b = 0; b < bins; b++)
+        binStart[b + 1] = binStart[b] + binCount[b];
+    binItems.resize(binStart[bins]);
+    binFill.assign(binStart.begin(), binStart.end() - 1);
+    for (int i = 0; i < count; i++)
+    {
+        const Projected &p = projected[i];
+        if (p.sprite < 0)
+            continue;
+        for (int b = std::max(p.startX, 0) / binWidth; b <= (std::min(p.endX, w) - 1) / binWidth; b++)
+            binItems[binFill[b]++] = i;
+    }
+
+    pool->parallelFor(bins, 1, [&](int begin, int end) {
+        for (int b = begin; b < end; b++)
+            drawBin(cpu, sprites, b);
+    });
+}
+
+void SpriteRenderer::drawBin(CpuRenderer &cpu, const std::vector<Sprite> &sprites, int bin)
+{
+    int *items = binItems.data() + binStart[bin];
+    int n = binStart[bin + 1] - binStart[bin];
+
+    // far to near inside the bin only
+    std::sort(items, items + n, [&](int a, int b) {
+        if (projected[a].depth != projected[b].depth)
+            return projected[a].depth > projected[b].depth;
+        return a < b;
+    });
+
+    const int w = cpu.w, h = cpu.h;
+    const int x0 = bin * binWidth;
+    const int x1 = std::min(x0 + binWidth, w);
+    uint32_t *fb = cpu.framebuffer.data();
+
+    for (int k = 0; k < n; k++)
+    {
+        const Projected &p = projected[items[k]];
+        const SpriteTexture &tex = textures[sprites[p.sprite].texture];
+        int fog = cpu.fogAt(p.depth);
+
+        int drawStartY = -p.size / 2 + h / 2;
+        if (drawStartY < 0) drawStartY = 0;
+        int drawEndY = p.size / 2 + h / 2;
+        if (drawEndY >= h) drawEndY = h - 1;
+
+        for (int stripe = std::max(p.startX, x0); stripe < std::min(p.endX, x1); stripe++)
+        {
+            if (p.depth >= cpu.zbuffer[stripe])
+                continue;
+            int texX = (int)((int64_t)(stripe - p.startX) * tex.w / p.size);
+            const uint32_t *column = tex.texels.data() + (size_t)texX * tex.h;
+            for (int y = drawStartY; y < drawEndY; y++)
+            {
+                int d = y * 256 - h * 128 + p.size * 128;
+                int texY = (int)(((int64_t)d * tex.h) / p.size / 256);
+                if (texY < 0 || texY >= tex.h)
+                    continue;
+                uint32_t c = column[texY];
+                if (c)
+                    fb[(size_t)y * w + stripe] = fogMix(c, cpu.fogColor(), fog);
+            }
+        }
+    }
+}
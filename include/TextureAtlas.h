@@ -0,0 +1,93 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+// All surface textures as layers of one contiguous block, every layer the
+// same size (the first texture's, later ones are resampled nearest), plus
+// tables from cell value to wall layer and from floor kind to floor and
+// ceiling layer. The CPU engine
+// turns the table into texel offsets from one base pointer and the shader
+// gets the layers as one array texture, so hundreds of textures need no
+// rebinding and the hot loops pick a texture with a table load instead of
+// a branch.
+
+#define ATLAS_MAX_LAYERS 2048
+
+// how a wall lets rays through: masked walls have holes where the texel is
+// the key colour (magenta), translucent walls are blended by their alpha.
+// Rays keep going past both and the column is composited back to front.
+#define MATERIAL_OPAQUE 0
+#define MATERIAL_MASKED 1
+#define MATERIAL_TRANSLUCENT 2
+
+static inline bool maskKey(unsigned r, unsigned g, unsigned b)
+{
+    return r >= 240 && g <= 16 && b >= 240;
+}
+
+struct WallSurface
+{
+    uint16_t layer = 0;
+    uint8_t material = MATERIAL_OPAQUE;
+    uint8_t alpha = 255; // translucent walls only
+};
+
+struct FloorSurface
+{
+    uint16_t floor = 0, ceiling = 0;
+};
+
+class TextureAtlas
+{
+public:
+    int w = 0, h = 0, layers = 0;
+    std::vector<unsigned char> rgb; // layer after layer, each row major RGB8
+
+    // returns the layer id, -1 when the atlas is full
+    int add(const unsigned char *data, int _w, int _h, int channels);
+    const unsigned char *layer(int i) const { return rgb.data() + (size_t)i * w * h * 3; }
+};
+
+// solid cells pick their wall by cell value, open cells pick floor and
+// ceiling by their floor kind (WorldMap::floors)
+class TextureTable
+{
+public:
+    WallSurface walls[256];   // by cell value
+    FloorSurface floors[256]; // by floor kind
+
+    void setWall(uint8_t cell, uint16_t layer, uint8_t material = MATERIAL_OPAQUE, uint8_t alpha = 255)
+    {
+        walls[cell].layer = layer;
+        walls[cell].material = material;
+        walls[cell].alpha = alpha;
+    }
+    void setFloor(uint8_t kind, uint16_t floor, uint16_t ceiling)
+    {
+        floors[kind].floor = floor;
+        floors[kind].ceiling = ceiling;
+    }
+};
+
+int TextureAtlas::add(const unsigned char *data, int _w, int _h, int channels)
+{
+    if (layers >= ATLAS_MAX_LAYERS)
+        return -1;
+    if (layers == 0) {
+        w = _w;
+        h = _h;
+    }
+    rgb.resize((size_t)(layers + 1) * w * h * 3);
+    unsigned char *dst = rgb.data() + (size_t)layers * w * h * 3;
+    for (int y = 0; y < h; y++)
+        for (int x = 0; x < w; x++)
+        {
+            const unsigned char *p = data + ((size_t)(y * _h / h) * _w + x * _w / w) * channels;
+            unsigned char *q = dst + ((size_t)y * w + x) * 3;
+            q[0] = p[0];
+            q[1] = p[1];
+            q[2] = p[2];
+        }
+    return layers++;
+}
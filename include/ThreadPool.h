@@ -0,0 +1,119 @@
+#pragma once
+
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <atomic>
+#include <vector>
+
+// Fixed set of worker threads shared by the CPU engine. parallelFor() splits
+// [0, count) into chunks that workers (and the calling thread) pull from an
+// atomic counter, and returns when every chunk is done.
+class ThreadPool
+{
+private:
+    std::vector<std::thread> workers;
+    std::mutex mtx;
+    std::condition_variable wake, done;
+    bool quit = false;
+    unsigned generation = 0;
+    int busy = 0;
+
+    std::function<void(int, int)> job;
+    int jobCount = 0, jobChunk = 1;
+    std::atomic<int> next{0};
+
+    void workerLoop();
+    void runChunks();
+
+public:
+    ThreadPool(int threads = 0);
+    ~ThreadPool();
+
+    int size() const { return (int)workers.size() + 1; }
+    void parallelFor(int count, int chunk, const std::function<void(int, int)> &fn);
+};
+
+ThreadPool::ThreadPool(int threads)
+{
+    if (threads <= 0)
+        threads = (int)std::thread::hardware_concurrency();
+    if (threads <= 0)
+        threads = 1;
+    // the calling thread is one of the workers
+    for (int i = 1; i < threads; i++)
+        workers.emplace_back(&ThreadPool::workerLoop, this);
+}
+
+ThreadPool::~ThreadPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        quit = true;
+    }
+    wake.notify_all();
+    for (auto &t : workers)
+        t.join();
+}
+
+void ThreadPool::runChunks()
+{
+    while (true)
+    {
+        int begin = next.fetch_add(jobChunk);
+        if (begin >= jobCount)
+            break;
+        int end = begin + jobChunk < jobCount ? begin + jobChunk : jobCount;
+        job(begin, end);
+    }
+}
+
+void ThreadPool::workerLoop()
+{
+    unsigned seen = 0;
+    while (true)
+    {
+        {
+            std::unique_lock<std::mutex> lock(mtx);
+            wake.wait(lock, [&] { return quit || generation != seen; });
+            if (quit)
+                return;
+            seen = generation;
+        }
+        runChunks();
+        {
+            std::lock_guard<std::mutex> lock(mtx);
+            busy--;
+        }
+        done.notify_one();
+    }
+}
+
+void ThreadPool::parallelFor(int count, int chunk, const std::function<void(int, int)> &fn)
+{
+    if (count <= 0)
+        return;
+    if (chunk < 1)
+        chunk = 1;
+    if (workers.empty() || count <= chunk)
+    {
+        fn(0, count);
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        job = fn;
+        jobCount = count;
+        jobChunk = chunk;
+        next = 0;
+        busy = (int)workers.size();
+        generation++;
+    }
+    wake.notify_all();
+    runChunks();
+
+    std::unique_lock<std::mutex> lock(mtx);
+    done.wait(lock, [&] { return busy == 0; });
+}
@@ -0,0 +1,141 @@
+#pragma once
+
+#include <cstdint>
+#include <math.h>
+#include <vector>
+#include <memory>
+#include <algorithm>
+#include <unordered_map>
+
+#include "WorldMap.h"
+#include "Dda.h"
+
+// Exact visible region around a point, for fog of war and 2D light shadows.
+// Angular sweep: every wall corner within `radius` gets three rays (on it
+// and a hair to each side, so the sweep slips past silhouette corners),
+// plus a ring of rays that close the polygon over open ground. Rays are the
+// renderer's occupancy DDA with unit length directions, so the hit distance
+// is euclidean. Vertices come out sorted by angle around the origin.
+
+struct VisibilityPolygon
+{
+    float originX, originY;
+    std::vector<float> xs, ys;
+    int minX, minY, maxX, maxY; // cells covered by the polygon's bounding box
+
+    bool contains(float px, float py) const;
+};
+
+bool VisibilityPolygon::contains(float px, float py) const
+{
+    bool inside = false;
+    size_t n = xs.size();
+    for (size_t i = 0, j = n - 1; i < n; j = i++)
+        if ((ys[i] > py) != (ys[j] > py) && px < (xs[j] - xs[i]) * (py - ys[i]) / (ys[j] - ys[i]) + xs[i])
+            inside = !inside;
+    return inside;
+}
+
+#define VISIBILITY_RING_RAYS 64
+#define VISIBILITY_EPS 1e-4f
+
+void computeVisibility(const WorldMap &world, float originX, float originY, float radius, VisibilityPolygon &poly)
+{
+    std::vector<float> angles;
+    for (int i = 0; i < VISIBILITY_RING_RAYS; i++)
+        angles.push_back(i * 6.2831853f / VISIBILITY_RING_RAYS);
+
+    // lattice points where the solid cells around them form a corner: one or
+    // three of the four solid, or two on a diagonal
+    int r = (int)ceilf(radius);
+    int x0 = std::max(int(originX) - r, 1), x1 = std::min(int(originX) + r + 1, world.w - 1);
+    int y0 = std::max(int(originY) - r, 1), y1 = std::min(int(originY) + r + 1, world.h - 1);
+    for (int x = x0; x <= x1; x++)
+        for (int y = y0; y <= y1; y++)
+        {
+            bool a = world.solid(x - 1, y - 1), b = world.solid(x, y - 1);
+            bool c = world.solid(x - 1, y), d = world.solid(x, y);
+            int solid = a + b + c + d;
+            if (solid == 1 || solid == 3 || (solid == 2 && a == d))
+            {
+                float dx = x - originX, dy = y - originY;
+                if (dx * dx + dy * dy > radius * radius)
+                    continue;
+                float angle = atan2f(dy, dx);
+                angles.push_back(angle - VISIBILITY_EPS);
+                angles.push_back(angle);
+                angles.push_back(angle + VISIBILITY_EPS);
+            }
+        }
+
+    for (float &a : angles)
+        if (a < 0)
+            a += 6.2831853f;
+    std::sort(angles.begin(), angles.end());
+
+    poly.originX = originX;
+    poly.originY = originY;
+    poly.xs.clear();
+    poly.ys.clear();
+    poly.minX = poly.maxX = int(originX);
+    poly.minY = poly.maxY = int(originY);
+    for (float a : angles)
+    {
+        float dirX = cosf(a), dirY = sinf(a);
+        RayHit hit = castRayOccupancy(world, originX, originY, dirX, dirY, radius);
+        float dist = std::min(hit.perpWallDist, radius);
+        float px = originX + dirX * dist, py = originY + dirY * dist;
+        poly.xs.push_back(px);
+        poly.ys.push_back(py);
+        poly.minX = std::min(poly.minX, int(floorf(px)) - 1);
+        poly.minY = std::min(poly.minY, int(floorf(py)) - 1);
+        poly.maxX = std::max(poly.maxX, int(floorf(px)) + 1);
+        poly.maxY = std::max(poly.maxY, int(floorf(py)) + 1);
+    }
+}
+
+// Polygons cached per origin cell (computed from the cell centre). A map
+// edit only drops the entries whose bounding box contains an edited cell:
+// a wall added or removed outside that box can neither block nor uncover
+// anything the polygon reaches. get() hands out shared pointers, so a
+// polygon stays valid for its holder after the cache drops it.
+class VisibilityCache
+{
+private:
+    std::unordered_map<int64_t, std::shared_ptr<const VisibilityPolygon>> entries;
+
+public:
+    float radius = 32.f;
+    size_t maxEntries = 4096; // whole cache is dropped past this
+
+    std::shared_ptr<const VisibilityPolygon> get(const WorldMap &world, int cellX, int cellY);
+    void onCellsChanged(int x0, int y0, int x1, int y1); // inclusive cell rect
+    void clear() { entries.clear(); }
+    size_t size() const { return entries.size(); }
+};
+
+std::shared_ptr<const VisibilityPolygon> VisibilityCache::get(const WorldMap &world, int cellX, int cellY)
+{
+    int64_t key = (int64_t)cellX * world.h + cellY;
+    auto it = entries.find(key);
+    if (it != entries.end())
+        return it->second;
+    if (entries.size() >= maxEntries)
+        entries.clear();
+    std::shared_ptr<VisibilityPolygon> poly = std::make_shared<VisibilityPolygon>();
+    computeVisibility(world, cellX + 0.5f, cellY + 0.5f, radius, *poly);
+    entries[key] = poly;
+    return poly;
+}
+
+void VisibilityCache::onCellsChanged(int x0, int y0, int x1, int y1)
+{
+    for (auto it = entries.begin(); it != entries.end();)
+    {
+        const VisibilityPolygon &p = *it->second;
+        if (x1 < p.minX || x0 > p.maxX || y1 < p.minY || y0 > p.maxY)
+            ++it;
+        else
+            it = entries.erase(it);
+    }
+}
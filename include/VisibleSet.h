@@ -0,0 +1,120 @@
+#pragma once
+
+#include <cstdint>
+#include <atomic>
+#include <vector>
+#include <algorithm>
+
+#include "WorldMap.h"
+
+// Per frame output of the CPU traversal: every cell a ray entered (one bit
+// per cell, same bit order as WorldMap::occupancy) and the wall faces that
+// ended up on screen. Sprite culling, AI awareness, the automap and network
+// interest management read this instead of casting their own rays.
+//
+// Columns run on several threads, so bits are set with an atomic OR that is
+// skipped when the bits are already there (neighbouring rays mostly are).
+// The column that turns a word non zero remembers it, so the next frame
+// clears only the words that were touched.
+
+// face of the cell that was hit: 0 its -x side, 1 +x, 2 -y, 3 +y
+struct VisibleFace
+{
+    int x, y;
+    int face;
+
+    bool operator<(const VisibleFace &o) const
+    {
+        if (x != o.x) return x < o.x;
+        if (y != o.y) return y < o.y;
+        return face < o.face;
+    }
+    bool operator==(const VisibleFace &o) const { return x == o.x && y == o.y && face == o.face; }
+};
+
+class VisibleSet
+{
+public:
+    int w = 0, h = 0;
+    size_t rowBits = 0;
+    std::vector<std::atomic<uint64_t>> bits;
+    std::vector<std::vector<uint32_t>> touched; // words first set by each column
+    std::vector<VisibleFace> columnFaces;       // hit face per column, x = -1 on a miss
+    std::vector<VisibleFace> faces;             // deduplicated, filled by finish()
+
+    void begin(const WorldMap &world, int columns);
+    void finish();
+
+    bool visible(int x, int y) const
+    {
+        size_t bit = (size_t)x * rowBits + y;
+        return (bits[bit >> 6].load(std::memory_order_relaxed) >> (bit & 63)) & 1;
+    }
+
+    void mark(int column, size_t word, uint64_t mask)
+    {
+        std::atomic<uint64_t> &a = bits[word];
+        if ((a.load(std::memory_order_relaxed) & mask) == mask)
+            return;
+        if (a.fetch_or(mask, std::memory_order_relaxed) == 0)
+            touched[column].push_back((uint32_t)word);
+    }
+};
+
+// clears what the last frame set, or reallocates when the map changed size
+void VisibleSet::begin(const WorldMap &world, int columns)
+{
+    size_t words = ((size_t)world.w * world.occRowBits) >> 6;
+    if (world.w != w || world.h != h || bits.size() != words)
+    {
+        w = world.w;
+        h = world.h;
+        rowBits = world.occRowBits;
+        bits = std::vector<std::atomic<uint64_t>>(words);
+        for (auto &b : bits)
+            b.store(0, std::memory_order_relaxed);
+        for (auto &t : touched)
+            t.clear();
+    }
+    else
+    {
+        for (auto &t : touched)
+        {
+            for (uint32_t word : t)
+                bits[word].store(0, std::memory_order_relaxed);
+            t.clear();
+        }
+    }
+    touched.resize(columns);
+    columnFaces.resize(columns);
+}
+
+void VisibleSet::finish()
+{
+    faces.clear();
+    for (const VisibleFace &f : columnFaces)
+        if (f.x >= 0 && (faces.empty() || !(faces.back() == f)))
+            faces.push_back(f);
+    std::sort(faces.begin(), faces.end());
+    faces.erase(std::unique(faces.begin(), faces.end()), faces.end());
+}
+
+// traversal visitor writing into a VisibleSet for one column
+struct CellMarker
+{
+    VisibleSet *set;
+    int column;
+
+    void cell(long long bit)
+    {
+        set->mark(column, (size_t)(bit >> 6), 1ull << (bit & 63));
+    }
+    void run(long long bit, int n, int stepY)
+    {
+        int b = (int)(bit & 63);
+        uint64_t ones = (1ull << n) - 1; // n < 64, runs stay inside the word
+        uint64_t mask = stepY > 0 ? ones << (b + 1) : ones << (b - n);
+        set->mark(column, (size_t)(bit >> 6), mask);
+    }
+    bool through(int mapX, int mapY, int side, float dist, uint8_t cell) { (void)mapX; (void)mapY; (void)side; (void)dist; (void)cell; return false; }
+};
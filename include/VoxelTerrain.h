@@ -0,0 +1,159 @@
+#pragma once
+
+#include <cstdint>
+#include <math.h>
+#include <vector>
+
+#include "CpuRenderer.h"
+#include "ThreadPool.h"
+
+// Second column engine: "voxel space" heightmap terrain. Every screen
+// column walks its ray over the heightmap front to back, projects the
+// height of each sample and fills only the rows above the highest one
+// drawn so far (a y-buffer of one int per column), so every pixel is
+// written once. The step along the ray grows with distance (lodFactor),
+// far terrain is sampled coarser. Draws into a CpuRenderer's framebuffer
+// on the same pool, with the same fog settings.
+
+// colour in the low 24 bits and height in the top 8, so one sample is one load
+class Terrain
+{
+public:
+    int shift = 0, size = 0, mask = 0; // size is 1 << shift, the map wraps
+    std::vector<uint32_t> texels;      // x * size + y
+
+    uint32_t at(int x, int y) const { return texels[((size_t)(x & mask) << shift) | (size_t)(y & mask)]; }
+    int heightAt(float x, float y) const { return at(int(floorf(x)), int(floorf(y))) >> 24; }
+
+    // fractal value noise heights, coloured by height and lit by slope
+    void generate(int _shift, uint32_t seed, ThreadPool *pool);
+};
+
+static inline float terrainHash(int x, int y, uint32_t seed)
+{
+    uint32_t h = (uint32_t)x * 374761393u + (uint32_t)y * 668265263u + seed * 2246822519u;
+    h = (h ^ (h >> 13)) * 1274126177u;
+    return ((h ^ (h >> 16)) & 0xFFFF) / 65535.f;
+}
+
+void Terrain::generate(int _shift, uint32_t seed, ThreadPool *pool)
+{
+    shift = _shift;
+    size = 1 << shift;
+    mask = size - 1;
+    texels.assign((size_t)size * size, 0);
+    std::vector<float> height((size_t)size * size);
+
+    // octaves from 1/4 of the map down to 4 cells, each wrapping
+    pool->parallelFor(size, 16, [&](int begin, int end) {
+        for (int x = begin; x < end; x++)
+            for (int y = 0; y < size; y++)
+            {
+                float sum = 0, amp = 1, norm = 0;
+                for (int period = size / 4; period >= 4; period /= 2)
+                {
+                    int cells = size / period;
+                    float fx = (float)x / period, fy = (float)y / period;
+                    int x0 = int(fx), y0 = int(fy);
+                    float tx = fx - x0, ty = fy - y0;
+                    tx = tx * tx * (3 - 2 * tx);
+                    ty = ty * ty * (3 - 2 * ty);
+                    int x1 = (x0 + 1) % cells, y1 = (y0 + 1) % cells;
+                    float a = terrainHash(x0, y0, seed + period), b = terrainHash(x1, y0, seed + period);
+                    float c = terrainHash(x0, y1, seed + period), d = terrainHash(x1, y1, seed + period);
+                    sum += amp * ((a + (b - a) * tx) + ((c + (d - c) * tx) - (a + (b - a) * tx)) * ty);
+                    norm += amp;
+                    amp *= 0.5f;
+                }
+                float v = sum / norm;
+                height[(size_t)x * size + y] = v * v * 255.f;
+            }
+    });
+
+    pool->parallelFor(size, 16, [&](int begin, int end) {
+        for (int x = begin; x < end; x++)
+            for (int y = 0; y < size; y++)
+            {
+                float hgt = height[(size_t)x * size + y];
+                float slope = hgt - height[(size_t)((x + 1) & mask) * size + y];
+                float r, g, b;
+                if (hgt < 30)       { r = 40;  g = 70;  b = 160; hgt = 30; slope = 0; } // water is flat
+                else if (hgt < 40)  { r = 190; g = 180; b = 120; }
+                else if (hgt < 110) { r = 60;  g = 130; b = 50; }
+                else if (hgt < 170) { r = 110; g = 100; b = 90; }
+                else                { r = 235; g = 235; b = 240; }
+                float lit = 1.f + slope * 0.08f;
+                lit = lit < 0.4f ? 0.4f : (lit > 1.4f ? 1.4f : lit);
+                uint32_t R = (uint32_t)fminf(r * lit, 255.f), G = (uint32_t)fminf(g * lit, 255.f), B = (uint32_t)fminf(b * lit, 255.f);
+                texels[(size_t)x * size + y] = R | (G << 8) | (B << 16) | ((uint32_t)hgt << 24);
+            }
+    });
+}
+
+class VoxelRenderer
+{
+private:
+    ThreadPool *pool;
+    std::vector<int> columnSamples;
+
+public:
+    float cameraHeight = 150.f; // terrain units, heights are 0..255
+    float horizon = 0.f;        // pitch, rows above the screen centre
+    float heightScale = 240.f;  // rows for one terrain unit at distance 1
+    float lodFactor = 0.01f;    // step = max(1, distance * lodFactor)
+
+    // stats of the last frame
+    long long samples = 0;
+
+    VoxelRenderer(ThreadPool *_pool) : pool(_pool) {}
+
+    void render(CpuRenderer &cpu, const Terrain &terrain, const Camera &cam, const RenderSettings &settings);
+};
+
+void VoxelRenderer::render(CpuRenderer &cpu, const Terrain &terrain, const Camera &cam, const RenderSettings &settings)
+{
+    cpu.beginFrame(settings);
+    const int w = cpu.w, h = cpu.h;
+    const float horizonRow = h * 0.5f - horizon;
+    const float maxDist = cpu.frameSettings().maxDistance;
+    uint32_t *fb = cpu.framebuffer.data();
+    columnSamples.assign(w, 0);
+
+    pool->parallelFor(w, cpu.columnChunk, [&](int begin, int end) {
+        for (int x = begin; x < end; x++)
+        {
+            float cameraX = 2 * x / float(w) - 1;
+            float rayDirX = cam.dirX + cam.planeX * cameraX;
+            float rayDirY = cam.dirY + cam.planeY * cameraX;
+
+            int ybuf = h; // rows [ybuf, h) are drawn
+            int n = 0;
+            float z = 1.f;
+            while (z < maxDist && ybuf > 0)
+            {
+                uint32_t t = terrain.at(int(floorf(cam.posX + rayDirX * z)), int(floorf(cam.posY + rayDirY * z)));
+                n++;
+                int y = int(horizonRow + (cameraHeight - (float)(t >> 24)) * heightScale / z);
+                if (y < 0)
+                    y = 0;
+                if (y < ybuf)
+                {
+                    uint32_t c = fogMix(t | 0xFF000000u, cpu.fogColor(), cpu.fogAt(z));
+                    for (int r = y; r < ybuf; r++)
+                        fb[(size_t)r * w + x] = c;
+                    ybuf = y;
+                }
+                float step = z * lodFactor;
+                z += step > 1.f ? step : 1.f;
+            }
+            for (int r = 0; r < ybuf; r++)
+                fb[(size_t)r * w + x] = cpu.fogColor();
+            cpu.zbuffer[x] = maxDist;
+            columnSamples[x] = n;
+        }
+    });
+
+    samples = 0;
+    for (int x = 0; x < w; x++)
+        samples += columnSamples[x];
+}
@@ -0,0 +1,284 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+#include <utility>
+#include <algorithm>
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+// Cell ordering of the map store. ROW is the original worldMap[x * h + y]
+// order, TILED keeps 8x8 blocks in one 64 byte cache line and MORTON
+// interleaves the x/y bits so both axes stay close in memory.
+enum MapLayout {
+    MAP_LAYOUT_ROW = 0,
+    MAP_LAYOUT_TILED = 1,
+    MAP_LAYOUT_MORTON = 2,
+};
+
+#define MAP_TILE_SHIFT 3
+#define MAP_TILE_SIZE (1 << MAP_TILE_SHIFT)
+#define MAP_TILE_MASK (MAP_TILE_SIZE - 1)
+
+// Layout policies. index() gives the cell address, stepX/stepY move an
+// address one cell along an axis without recomputing it from scratch.
+// x is the slow axis, y the fast one, same as the shader.
+struct RowLayout
+{
+    size_t strideX;
+
+    size_t index(int x, int y) const { return (size_t)x * strideX + y; }
+    size_t stepX(size_t idx, int x, int s) const { (void)x; return s > 0 ? idx + strideX : idx - strideX; }
+    size_t stepY(size_t idx, int y, int s) const { (void)y; return idx + s; }
+};
+
+struct TiledLayout
+{
+    size_t tileStrideX; // bytes between two tiles along x
+
+    size_t index(int x, int y) const
+    {
+        size_t tile = (size_t)(x >> MAP_TILE_SHIFT) * tileStrideX + ((size_t)(y >> MAP_TILE_SHIFT) << (2 * MAP_TILE_SHIFT));
+        return tile | ((x & MAP_TILE_MASK) << MAP_TILE_SHIFT) | (y & MAP_TILE_MASK);
+    }
+    size_t stepX(size_t idx, int x, int s) const
+    {
+        if (s > 0)
+            return (x & MAP_TILE_MASK) != MAP_TILE_MASK ? idx + MAP_TILE_SIZE : idx + tileStrideX - MAP_TILE_MASK * MAP_TILE_SIZE;
+        return (x & MAP_TILE_MASK) != 0 ? idx - MAP_TILE_SIZE : idx - tileStrideX + MAP_TILE_MASK * MAP_TILE_SIZE;
+    }
+    size_t stepY(size_t idx, int y, int s) const
+    {
+        const size_t tileBytes = MAP_TILE_SIZE * MAP_TILE_SIZE;
+        if (s > 0)
+            return (y & MAP_TILE_MASK) != MAP_TILE_MASK ? idx + 1 : idx + tileBytes - MAP_TILE_MASK;
+        return (y & MAP_TILE_MASK) != 0 ? idx - 1 : idx - tileBytes + MAP_TILE_MASK;
+    }
+};
+
+struct MortonLayout
+{
+    // x lives in the odd bits, y in the even bits
+    static const uint64_t xMask = 0xAAAAAAAAAAAAAAAAull;
+    static const uint64_t yMask = 0x5555555555555555ull;
+
+    static uint64_t spread(uint32_t v)
+    {
+        uint64_t r = v;
+        r = (r | (r << 16)) & 0x0000FFFF0000FFFFull;
+        r = (r | (r << 8)) & 0x00FF00FF00FF00FFull;
+        r = (r | (r << 4)) & 0x0F0F0F0F0F0F0F0Full;
+        r = (r | (r << 2)) & 0x3333333333333333ull;
+        r = (r | (r << 1)) & 0x5555555555555555ull;
+        return r;
+    }
+
+    size_t index(int x, int y) const { return (size_t)((spread((uint32_t)x) << 1) | spread((uint32_t)y)); }
+    // add/sub one on the masked bits only, the carry ripples through the gaps
+    size_t stepX(size_t idx, int x, int s) const
+    {
+        (void)x;
+        uint64_t m = idx;
+        uint64_t xs = s > 0 ? ((m | yMask) + 1) & xMask : ((m & xMask) - 1) & xMask;
+        return (size_t)(xs | (m & yMask));
+    }
+    size_t stepY(size_t idx, int y, int s) const
+    {
+        (void)y;
+        uint64_t m = idx;
+        uint64_t ys = s > 0 ? ((m | xMask) + 1) & yMask : ((m & yMask) - 1) & yMask;
+        return (size_t)(ys | (m & xMask));
+    }
+};
+
+// v must be non zero
+static inline int ctz64(uint64_t v)
+{
+#ifdef _MSC_VER
+    unsigned long r;
+    _BitScanForward64(&r, v);
+    return (int)r;
+#else
+    return __builtin_ctzll(v);
+#endif
+}
+
+static inline int clz64(uint64_t v)
+{
+#ifdef _MSC_VER
+    unsigned long r;
+    _BitScanReverse64(&r, v);
+    return 63 - (int)r;
+#else
+    return __builtin_clzll(v);
+#endif
+}
+
+// Thin wall cell values: a plane across the cell instead of the whole cell.
+// THIN_X planes sit at x = cell x + offset and are hit like x sides, THIN_Y
+// the same in y. Each cell keeps an open fraction, the panel covers
+// [open, 1) along the plane, so a door slides open towards 0. The cell stays
+// solid in the occupancy plane; the traversal tests the plane on the hit.
+#define THIN_NONE 0
+#define THIN_X 1
+#define THIN_Y 2
+
+struct ThinWall
+{
+    uint8_t axis = THIN_NONE;
+    float offset = 0.5f;
+};
+
+// Besides the material grid (cells, in the chosen layout) the store keeps a
+// 1 bit per cell occupancy plane. Traversal only touches the plane until it
+// finds a solid cell; the material byte is read once, on the hit. Plane bits
+// are row ordered: bit x * occRowBits + y, rows padded to whole words.
+class WorldMap
+{
+private:
+    size_t storageSize() const;
+
+public:
+    int w = 0, h = 0; // w cells along x, h cells along y
+    MapLayout layout = MAP_LAYOUT_ROW;
+    std::vector<uint8_t> cells;
+    std::vector<uint64_t> occupancy;
+    size_t occRowBits = 0;
+    std::vector<uint8_t> floors; // floor kind per cell at x * h + y, picks floor and ceiling textures
+    std::vector<uint8_t> open;   // open fraction * 255 of thin wall cells, x * h + y
+    ThinWall thin[256];          // per cell value
+
+    RowLayout row;
+    TiledLayout tiled;
+    MortonLayout morton;
+
+    WorldMap() {}
+    WorldMap(int _w, int _h, MapLayout _layout = MAP_LAYOUT_ROW);
+
+    void resize(int _w, int _h, MapLayout _layout);
+    void load(const int *src, int _w, int _h); // row major ints, like `map`
+    void setLayout(MapLayout _layout);
+    std::vector<int> exportRowMajor() const;   // GPU upload order, cell | floor kind << 8 | open << 16
+    int exportCell(int x, int y) const { return get(x, y) | (floorKind(x, y) << 8) | (open[(size_t)x * h + y] << 16); }
+
+    bool inside(int x, int y) const { return (unsigned)x < (unsigned)w && (unsigned)y < (unsigned)h; }
+    size_t index(int x, int y) const;
+    uint8_t get(int x, int y) const { return cells[index(x, y)]; }
+    void set(int x, int y, uint8_t v);
+    uint8_t floorKind(int x, int y) const { return floors[(size_t)x * h + y]; }
+    void setFloor(int x, int y, uint8_t kind) { floors[(size_t)x * h + y] = kind; }
+
+    void setThin(uint8_t value, uint8_t axis, float offset = 0.5f)
+    {
+        thin[value].axis = axis;
+        thin[value].offset = offset;
+    }
+    float openAt(int x, int y) const { return open[(size_t)x * h + y] * (1.f / 255.f); }
+    void setOpen(int x, int y, float fraction)
+    {
+        open[(size_t)x * h + y] = (uint8_t)(fraction <= 0.f ? 0 : (fraction >= 1.f ? 255 : int(fraction * 255.f + 0.5f)));
+    }
+    // a thin wall cell open far enough to walk through
+    bool passable(int x, int y) const { return thin[get(x, y)].axis != THIN_NONE && open[(size_t)x * h + y] >= 230; }
+
+    size_t occBit(int x, int y) const { return (size_t)x * occRowBits + y; }
+    bool solid(int x, int y) const
+    {
+        size_t bit = occBit(x, y);
+        return (occupancy[bit >> 6] >> (bit & 63)) & 1;
+    }
+};
+
+WorldMap::WorldMap(int _w, int _h, MapLayout _layout)
+{
+    resize(_w, _h, _layout);
+}
+
+size_t WorldMap::storageSize() const
+{
+    switch (layout) {
+        case MAP_LAYOUT_TILED:
+        {
+            size_t tx = (w + MAP_TILE_MASK) >> MAP_TILE_SHIFT;
+            size_t ty = (h + MAP_TILE_MASK) >> MAP_TILE_SHIFT;
+            return tx * ty * MAP_TILE_SIZE * MAP_TILE_SIZE;
+        }
+        case MAP_LAYOUT_MORTON:
+        {
+            // morton needs a power of two square
+            size_t side = 1;
+            while (side < (size_t)w || side < (size_t)h)
+                side <<= 1;
+            return side * side;
+        }
+        default:
+            return (size_t)w * h;
+    }
+}
+
+void WorldMap::resize(int _w, int _h, MapLayout _layout)
+{
+    w = _w;
+    h = _h;
+    layout = _layout;
+    row.strideX = h;
+    tiled.tileStrideX = (size_t)((h + MAP_TILE_MASK) >> MAP_TILE_SHIFT) * MAP_TILE_SIZE * MAP_TILE_SIZE;
+    cells.assign(storageSize(), 0);
+    occRowBits = (size_t)((h + 63) >> 6) << 6;
+    occupancy.assign(((size_t)w * occRowBits) >> 6, 0);
+    floors.assign((size_t)w * h, 0);
+    open.assign((size_t)w * h, 0);
+}
+
+void WorldMap::set(int x, int y, uint8_t v)
+{
+    cells[index(x, y)] = v;
+    size_t bit = occBit(x, y);
+    if (v)
+        occupancy[bit >> 6] |= 1ull << (bit & 63);
+    else
+        occupancy[bit >> 6] &= ~(1ull << (bit & 63));
+}
+
+void WorldMap::load(const int *src, int _w, int _h)
+{
+    resize(_w, _h, layout);
+    for (int x = 0; x < w; x++)
+        for (int y = 0; y < h; y++)
+            set(x, y, (uint8_t)src[x * h + y]);
+}
+
+void WorldMap::setLayout(MapLayout _layout)
+{
+    if (_layout == layout)
+        return;
+    WorldMap tmp(w, h, _layout);
+    for (int x = 0; x < w; x++)
+        for (int y = 0; y < h; y++)
+            tmp.set(x, y, get(x, y));
+    tmp.floors = floors;
+    tmp.open = open;
+    std::copy(thin, thin + 256, tmp.thin);
+    *this = std::move(tmp);
+}
+
+std::vector<int> WorldMap::exportRowMajor() const
+{
+    std::vector<int> out((size_t)w * h);
+    for (int x = 0; x < w; x++)
+        for (int y = 0; y < h; y++)
+            out[(size_t)x * h + y] = exportCell(x, y);
+    return out;
+}
+
+size_t WorldMap::index(int x, int y) const
+{
+    switch (layout) {
+        case MAP_LAYOUT_TILED: return tiled.index(x, y);
+        case MAP_LAYOUT_MORTON: return morton.index(x, y);
+        default: return row.index(x, y);
+    }
+}
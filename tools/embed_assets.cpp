@@ -0,0 +1,90 @@
+// Build step: writes a header with the given assets as constexpr byte
+// arrays (see include/Assets.h). Text files are copied as is plus a
+// terminating 0, .png files are decoded here, flipped the way the game
+// loads them, so the binary never opens or decodes them at startup.
+// usage: embed_assets <output header> <asset dir> <name>...
+
+#define STB_IMAGE_IMPLEMENTATION
+#include "stb_image.h"
+
+#include <cstdio>
+#include <string>
+#include <vector>
+#include <fstream>
+#include <sstream>
+#include <iostream>
+
+static bool endsWith(const std::string &s, const char *suffix)
+{
+    std::string t(suffix);
+    return s.size() >= t.size() && s.compare(s.size() - t.size(), t.size(), t) == 0;
+}
+
+static void writeBytes(std::ostream &out, const unsigned char *data, size_t size)
+{
+    char buf[8];
+    for (size_t i = 0; i < size; i++)
+    {
+        snprintf(buf, sizeof(buf), "%u,", data[i]);
+        out << buf << ((i & 31) == 31 ? "\n" : "");
+    }
+}
+
+int main(int argc, char **argv)
+{
+    if (argc < 3) {
+        std::cerr << "usage: embed_assets <output header> <asset dir> <name>..." << std::endl;
+        return 1;
+    }
+    std::string dir = argv[2];
+    std::ostringstream out;
+    out << "// generated by tools/embed_assets.cpp from " << dir << ", do not edit\n";
+    out << "#pragma once\n\n";
+
+    std::ostringstream table;
+    int count = 0;
+    stbi_set_flip_vertically_on_load(true);
+    for (int i = 3; i < argc; i++, count++)
+    {
+        std::string name = argv[i];
+        std::string path = dir + "/" + name;
+        int w = 0, h = 0, channels = 0;
+        std::vector<unsigned char> bytes;
+        if (endsWith(name, ".png")) {
+            unsigned char *pixels = stbi_load(path.c_str(), &w, &h, &channels, 0);
+            if (!pixels) {
+                std::cerr << "embed_assets: can not decode " << path << ": " << stbi_failure_reason() << std::endl;
+                return 1;
+            }
+            bytes.assign(pixels, pixels + (size_t)w * h * channels);
+            stbi_image_free(pixels);
+        } else {
+            std::ifstream file(path, std::ios::binary);
+            if (!file) {
+                std::cerr << "embed_assets: can not open " << path << std::endl;
+                return 1;
+            }
+            bytes.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+        }
+        size_t size = bytes.size();
+        bytes.push_back(0);
+
+        out << "constexpr unsigned char embedded_asset_" << count << "[] = {\n";
+        writeBytes(out, bytes.data(), bytes.size());
+        out << "};\n\n";
+        table << "    {\"" << name << "\", embedded_asset_" << count << ", " << size << ", " << w << ", " << h << ", "
+              << channels << "},\n";
+    }
+    out << "constexpr EmbeddedAsset embeddedAssets[] = {\n" << table.str() << "};\n";
+    out << "constexpr int embeddedAssetCount = " << count << ";\n";
+
+    // only touch the header when it changes
+    std::string text = out.str();
+    std::ifstream old(argv[1], std::ios::binary);
+    if (old && std::string(std::istreambuf_iterator<char>(old), std::istreambuf_iterator<char>()) == text)
+        return 0;
+    old.close();
+    std::ofstream file(argv[1], std::ios::binary);
+    file << text;
+    return file ? 0 : 1;
+}